@@ -0,0 +1,146 @@
+#include <assert.h>
+#include <string.h>
+
+#include "byte_ring.h"
+
+void byte_ring_init(struct byte_ring *r, void *storage, size_t size, size_t guard) {
+	r->buf = (uint8_t *)storage + guard;
+	r->size = size;
+	r->guard = guard;
+	atomic_init(&r->head, 0);
+	atomic_init(&r->tail, 0);
+	r->mirrored = 0;
+	atomic_init(&r->cut_at, 0);
+	atomic_init(&r->cut, 0);
+	atomic_init(&r->producer, NULL);
+	atomic_init(&r->consumer, NULL);
+}
+
+/* the positions go around twice the size, so that a full ring and an empty one look different, and any size works */
+static size_t byte_ring__advance(const struct byte_ring *r, size_t pos, size_t bytes) {
+	pos += bytes;
+	return pos >= 2 * r->size ? pos - 2 * r->size : pos;
+}
+
+static size_t byte_ring__fill(const struct byte_ring *r, size_t head, size_t tail) {
+	return head >= tail ? head - tail : head + 2 * r->size - tail;
+}
+
+/* same handshake as slot_queue: the waiting side publishes its handle before checking the positions, and the other side
+ * reads it after updating them */
+static void byte_ring__wake(_Atomic(TaskHandle_t) *task) {
+	TaskHandle_t handle = atomic_load(task);
+	if (handle != NULL)
+		xTaskNotifyGive(handle);
+}
+
+uint8_t *byte_ring_reserve(struct byte_ring *r, size_t min_free, size_t *len, TickType_t ticks_to_wait) {
+	size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+	size_t free;
+
+	assert(min_free > 0 && min_free <= r->size);
+	atomic_store(&r->producer, xTaskGetCurrentTaskHandle());
+	while ((free = r->size - byte_ring__fill(r, head, atomic_load(&r->tail))) < min_free) {
+		if (ulTaskNotifyTake(pdTRUE, ticks_to_wait) == 0)
+			return NULL;
+	}
+
+	size_t offset = head % r->size;
+	*len = free < r->size - offset ? free : r->size - offset;
+	return r->buf + offset;
+}
+
+void byte_ring_commit(struct byte_ring *r, size_t bytes) {
+	size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+
+	atomic_store(&r->head, byte_ring__advance(r, head, bytes));
+	byte_ring__wake(&r->consumer);
+}
+
+void byte_ring_last(const struct byte_ring *r, uint8_t *buf, size_t bytes) {
+	size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+
+	assert(bytes <= r->size);
+	size_t offset = (head + 2 * r->size - bytes) % r->size, before_wrap = r->size - offset;
+	if (bytes <= before_wrap) {
+		memcpy(buf, r->buf + offset, bytes);
+	} else {
+		memcpy(buf, r->buf + offset, before_wrap);
+		memcpy(buf + before_wrap, r->buf, bytes - before_wrap);
+	}
+}
+
+/* the consumer looks at cut after loading head: if it sees data committed after the cut, it sees the cut too */
+int byte_ring_cut(struct byte_ring *r) {
+	if (atomic_load(&r->cut))
+		return 0;
+	atomic_store(&r->cut_at, atomic_load_explicit(&r->head, memory_order_relaxed));
+	atomic_store(&r->cut, 1);
+	return 1;
+}
+
+int byte_ring_wait(struct byte_ring *r, size_t bytes, TickType_t ticks_to_wait) {
+	size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+
+	if (bytes > r->size)
+		bytes = r->size;
+	atomic_store(&r->consumer, xTaskGetCurrentTaskHandle());
+	while (byte_ring__fill(r, atomic_load(&r->head), tail) < bytes) {
+		if (ulTaskNotifyTake(pdTRUE, ticks_to_wait) == 0)
+			return 0;
+	}
+	return 1;
+}
+
+const uint8_t *byte_ring_peek(struct byte_ring *r, size_t want, size_t *len) {
+	size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+	size_t fill = byte_ring__fill(r, atomic_load(&r->head), tail);
+	if (atomic_load(&r->cut)) {
+		size_t to_cut = byte_ring__fill(r, atomic_load(&r->cut_at), tail);
+		fill = to_cut < fill ? to_cut : fill;
+	}
+	size_t offset = tail % r->size, before_wrap = r->size - offset;
+
+	assert(want <= r->guard);
+
+	/* all in one piece, or enough of it before the wrap */
+	*len = fill <= before_wrap ? fill : before_wrap;
+	if (fill <= before_wrap || (!r->mirrored && before_wrap >= want))
+		return r->buf + offset;
+
+	/* the producer never writes the guard, so the copy stays good until the wrap has been consumed */
+	if (!r->mirrored) {
+		memcpy(r->buf - before_wrap, r->buf + offset, before_wrap);
+		r->mirrored = 1;
+	}
+	*len = fill;
+	return r->buf - before_wrap;
+}
+
+void byte_ring_consume(struct byte_ring *r, size_t bytes) {
+	size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+
+	assert(bytes <= byte_ring__fill(r, atomic_load(&r->head), tail));
+	if (tail % r->size + bytes >= r->size)
+		r->mirrored = 0;  /* past the wrap */
+	atomic_store(&r->tail, byte_ring__advance(r, tail, bytes));
+	byte_ring__wake(&r->producer);
+}
+
+int byte_ring_skip_cut(struct byte_ring *r) {
+	size_t len;
+
+	if (!atomic_load(&r->cut))
+		return 0;
+	byte_ring_peek(r, r->guard, &len);
+	if (len != byte_ring__fill(r, atomic_load(&r->cut_at), atomic_load_explicit(&r->tail, memory_order_relaxed)))
+		return 0;  /* the span stops short of the cut, at the wrap */
+
+	byte_ring_consume(r, len);
+	atomic_store(&r->cut, 0);
+	return 1;
+}
+
+size_t byte_ring_fill(struct byte_ring *r) {
+	return byte_ring__fill(r, atomic_load(&r->head), atomic_load(&r->tail));
+}
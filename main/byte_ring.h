@@ -0,0 +1,63 @@
+#ifndef GAGA_BYTE_RING_H
+#define GAGA_BYTE_RING_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/* single-producer/single-consumer byte stream ring, the byte-sized counterpart of slot_queue: the producer reserves room
+ * and writes straight into it (e.g. the HTTP client reads into it) and commits it, the consumer reads spans in place and
+ * consumes them. no copies in or out, no locks; a side that has to wait sleeps on its task notification.
+ * the consumer needs contiguous spans (a whole frame, for minimp3), so there are guard bytes right in front of the ring:
+ * when the unread data wraps around and fewer bytes of it than the consumer asks for are left before the end, those are
+ * copied into the guard, where they run straight into the rest at the start of the ring. that's the only copy, and only
+ * of the few bytes at the wrap, once per lap (the guard is sized for the most the consumer ever asks for, e.g. enough to
+ * synchronize on, but a consumer asking for a frame at a time only has a frame's worth copied).
+ * the producer can also mark where the stream was cut (e.g. it carries on from another server): the consumer's spans
+ * stop there, until it skips what's left before the cut. */
+struct byte_ring {
+	uint8_t *buf;  /* size bytes, right after the guard */
+	size_t size;
+	size_t guard;
+	atomic_size_t head;  /* write position in [0, 2 * size), only written by the producer */
+	atomic_size_t tail;  /* read position in [0, 2 * size), only written by the consumer */
+	int mirrored;  /* consumer only: the unread bytes before the wrap are in the guard too */
+	atomic_size_t cut_at;  /* position of the cut, only valid while cut is set */
+	atomic_int cut;  /* set by the producer, cleared by the consumer once it has skipped to the cut */
+	_Atomic(TaskHandle_t) producer;
+	_Atomic(TaskHandle_t) consumer;
+};
+
+/* storage must be guard + size bytes */
+void byte_ring_init(struct byte_ring *r, void *storage, size_t size, size_t guard);
+
+/* producer side: wait for at least min_free bytes of room, and get the contiguous part of it (*len bytes, which is less
+ * than min_free only if the room wraps around). NULL on timeout */
+uint8_t *byte_ring_reserve(struct byte_ring *r, size_t min_free, size_t *len, TickType_t ticks_to_wait);
+void byte_ring_commit(struct byte_ring *r, size_t bytes);
+
+/* producer side: copy the last bytes committed to buf (there must have been that many), e.g. to find where the stream
+ * had got to. consumed or not, they're still there until the producer writes over them */
+void byte_ring_last(const struct byte_ring *r, uint8_t *buf, size_t bytes);
+
+/* producer side: what's committed from now on doesn't follow on from what was committed so far. there can only be one
+ * cut at a time: returns 0 (and doesn't mark anything) if the consumer hasn't got to the last one yet */
+int byte_ring_cut(struct byte_ring *r);
+
+/* consumer side: wait until at least bytes are in (or the ring is full), 0 on timeout */
+int byte_ring_wait(struct byte_ring *r, size_t bytes, TickType_t ticks_to_wait);
+
+/* the unread data in one piece, at least min(fill, want) bytes of it (want is at most the guard), but never past a cut,
+ * without waiting. it stays valid until consumed */
+const uint8_t *byte_ring_peek(struct byte_ring *r, size_t want, size_t *len);
+void byte_ring_consume(struct byte_ring *r, size_t bytes);
+
+/* if the span byte_ring_peek() returns runs up to a cut, consume it and get past the cut, returning 1. 0 otherwise */
+int byte_ring_skip_cut(struct byte_ring *r);
+
+/* number of committed bytes not yet consumed */
+size_t byte_ring_fill(struct byte_ring *r);
+
+#endif //GAGA_BYTE_RING_H
@@ -0,0 +1,61 @@
+#include "drift.h"
+
+/* the level changes by 1e-3 ms per second for each ppm of difference between the clocks, which with these gains makes
+ * for a natural period of about 45 minutes, damping 0.67. that's slow on purpose: the drift itself is constant, and a
+ * lazy loop doesn't chase network hiccups */
+#define DRIFT_KP 3.0f
+#define DRIFT_KI 0.005f
+#define DRIFT_MAX_STEP_PPM 2.0f
+#define DRIFT_TAU_S 30.0f
+#define DRIFT_SETTLE_S 20.0f
+
+static float drift__clamp(float x, float limit) {
+	return x > limit ? limit : x < -limit ? -limit : x;
+}
+
+void drift_init(struct drift_ctl *d, float max_ppm) {
+	d->kp = DRIFT_KP;
+	d->ki = DRIFT_KI;
+	d->max_ppm = max_ppm;
+	d->max_step_ppm = DRIFT_MAX_STEP_PPM;
+	d->tau_s = DRIFT_TAU_S;
+	d->settle_s = DRIFT_SETTLE_S;
+	d->integral = 0;
+	d->ppm = 0;
+	drift_restart(d);
+}
+
+void drift_restart(struct drift_ctl *d) {
+	d->running_s = 0;
+	d->level = -1;
+	d->setpoint = -1;
+	/* the integral term is the clocks' difference, that's still valid; the rest starts over */
+	d->integral = d->ppm;
+}
+
+float drift_update(struct drift_ctl *d, float level_ms, float dt_s) {
+	if (dt_s <= 0)
+		return d->ppm;
+
+	/* first order low pass */
+	if (d->level < 0)
+		d->level = level_ms;
+	else
+		d->level += (level_ms - d->level) * (dt_s / (d->tau_s + dt_s));
+	d->running_s += dt_s;
+
+	/* hold the correction until the buffer has settled, then hold that level */
+	if (d->setpoint < 0) {
+		if (d->running_s < d->settle_s)
+			return d->ppm;
+		d->setpoint = d->level;
+	}
+
+	float error = d->level - d->setpoint;  /* too much buffered: play faster */
+	d->integral = drift__clamp(d->integral + d->ki * error * dt_s, d->max_ppm);  /* clamped, so it can't wind up */
+	float target = drift__clamp(d->kp * error + d->integral, d->max_ppm);
+
+	float step = d->max_step_ppm * dt_s;
+	d->ppm += drift__clamp(target - d->ppm, step);
+	return d->ppm;
+}
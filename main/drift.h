@@ -0,0 +1,36 @@
+#ifndef GAGA_DRIFT_H
+#define GAGA_DRIFT_H
+
+#include <stdint.h>
+
+/* clock drift compensation. the server's encoder and our i2s run on different crystals, so over hours the buffered
+ * stream slowly grows or shrinks. this is a PI controller which watches how much is buffered and tells how much faster
+ * (positive) or slower to run the audio clock, in ppm, to keep that where it was when playback settled.
+ * it knows nothing about the hardware, so it can be run on the host against a simulated stream (offline/sim_drift.c) */
+struct drift_ctl {
+	/* tuning, set by drift_init() and free to be changed after */
+	float kp;  /* ppm per ms of error */
+	float ki;  /* ppm per ms of error, per second */
+	float max_ppm;  /* correction limit, both ways */
+	float max_step_ppm;  /* how much the correction can change per second */
+	float tau_s;  /* time constant of the level filter: network bursts shouldn't move the clock */
+	float settle_s;  /* how long to wait after a (re)start before picking the setpoint */
+
+	/* state */
+	float level;  /* filtered buffer level (ms) */
+	float setpoint;  /* level to hold (ms) */
+	float integral;
+	float ppm;  /* current correction */
+	float running_s;  /* time since the last (re)start */
+};
+
+void drift_init(struct drift_ctl *d, float max_ppm);
+
+/* the stream restarted (e.g. resync, reconnection): the buffer level starts over, so pick a new setpoint once it has
+ * settled again. the correction itself is kept, as the clocks haven't changed */
+void drift_restart(struct drift_ctl *d);
+
+/* feeds the buffered amount (ms of audio) dt_s seconds after the last call, and returns the new correction (ppm) */
+float drift_update(struct drift_ctl *d, float level_ms, float dt_s);
+
+#endif //GAGA_DRIFT_H
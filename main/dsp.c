@@ -0,0 +1,244 @@
+#include <math.h>
+#include <string.h>
+
+#include "dsp.h"
+
+#if defined(ESP_PLATFORM)
+#include <esp_cpu.h>
+#define DSP_CYCLES() ((uint32_t)esp_cpu_get_cycle_count())
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define DSP_CYCLES() ((uint32_t)__rdtsc())
+#else
+#define DSP_CYCLES() 0u
+#endif
+
+#define DSP_COEF_BITS 28
+#define DSP_FRAC_BITS 8
+
+static const char *const dsp__stage_names[DSP_STAGES] = {"gain", "eq", "limiter"};
+
+static int16_t dsp__saturate(int32_t x) {
+	return (int16_t)(x > 32767 ? 32767 : x < -32768 ? -32768 : x);
+}
+
+static int32_t dsp__coef(double c, double a0) {
+	return (int32_t)lrint(c / a0 * (1 << DSP_COEF_BITS));
+}
+
+void dsp_biquad_design(struct dsp_biquad *q, uint32_t hz) {
+	double b0 = 1, b1 = 0, b2 = 0, a0 = 1, a1 = 0, a2 = 0;
+
+	if (q->freq > 0 && q->freq < 0.45 * hz) {
+		double w0 = 2 * M_PI * q->freq / hz, cosw = cos(w0), alpha = sin(w0) / (2 * q->q);
+		double a = pow(10, q->gain_db / 40);
+
+		switch (q->type) {
+		case DSP_HIGHPASS:
+			b0 = b2 = (1 + cosw) / 2;
+			b1 = -(1 + cosw);
+			a0 = 1 + alpha;
+			a1 = -2 * cosw;
+			a2 = 1 - alpha;
+			break;
+		case DSP_LOWPASS:
+			b0 = b2 = (1 - cosw) / 2;
+			b1 = 1 - cosw;
+			a0 = 1 + alpha;
+			a1 = -2 * cosw;
+			a2 = 1 - alpha;
+			break;
+		case DSP_PEAK:
+			b0 = 1 + alpha * a;
+			b1 = -2 * cosw;
+			b2 = 1 - alpha * a;
+			a0 = 1 + alpha / a;
+			a1 = -2 * cosw;
+			a2 = 1 - alpha / a;
+			break;
+		case DSP_HIGHSHELF:
+			b0 = a * ((a + 1) + (a - 1) * cosw + 2 * sqrt(a) * alpha);
+			b1 = -2 * a * ((a - 1) + (a + 1) * cosw);
+			b2 = a * ((a + 1) + (a - 1) * cosw - 2 * sqrt(a) * alpha);
+			a0 = (a + 1) - (a - 1) * cosw + 2 * sqrt(a) * alpha;
+			a1 = 2 * ((a - 1) - (a + 1) * cosw);
+			a2 = (a + 1) - (a - 1) * cosw - 2 * sqrt(a) * alpha;
+			break;
+		}
+	}
+	q->b0 = dsp__coef(b0, a0);
+	q->b1 = dsp__coef(b1, a0);
+	q->b2 = dsp__coef(b2, a0);
+	q->a1 = dsp__coef(a1, a0);
+	q->a2 = dsp__coef(a2, a0);
+}
+
+void dsp_init(struct dsp *d, uint32_t hz) {
+	memset(d, 0, sizeof(*d));
+	for (int i = 0; i <= DSP_LOOKAHEAD_CHUNKS; i++)
+		d->required[i] = 32768;
+	d->limiter_gain = 32768;
+	d->hz = hz;
+	dsp_set_gain(d, 0);
+	d->gain = d->gain_target;
+	d->boost = d->boost_target;
+	dsp_set_limiter(d, 0, 200);  /* which designs everything for hz */
+}
+
+void dsp_set_rate(struct dsp *d, uint32_t hz) {
+	d->hz = hz;
+	for (int i = 0; i < d->nbiquads; i++)
+		dsp_biquad_design(&d->biquads[i], hz);
+	/* from no gain at all back to unity over release_ms */
+	d->release = (int32_t)(32768.0 * DSP_CHUNK / (d->release_ms / 1000 * hz)) + 1;
+}
+
+void dsp_set_gain(struct dsp *d, float db) {
+	double gain = pow(10, db / 20);
+
+	/* 16 times (+24 dB) is as far as a sample can be boosted in 32 bits */
+	d->gain_target = (int32_t)lrint((gain < 1 ? gain : 1) * (4096 >> DSP_HEADROOM_SHIFT));
+	d->boost_target = gain > 1 ? (int32_t)lrint(gain < 16 ? gain * 4096 : 65535) : 4096;
+}
+
+int dsp_add_biquad(struct dsp *d, int type, float freq, float q, float gain_db) {
+	if (d->nbiquads == DSP_MAX_BIQUADS)
+		return -1;
+
+	struct dsp_biquad *bq = &d->biquads[d->nbiquads++];
+	memset(bq, 0, sizeof(*bq));
+	bq->type = type;
+	bq->freq = freq;
+	bq->q = q;
+	bq->gain_db = gain_db;
+	dsp_biquad_design(bq, d->hz);
+	return 0;
+}
+
+void dsp_set_limiter(struct dsp *d, float threshold_dbfs, float release_ms) {
+	d->limiter_dbfs = threshold_dbfs;
+	d->release_ms = release_ms;
+	d->threshold = (int32_t)lrint(32767 * pow(10, threshold_dbfs / 20));
+	if (d->threshold > 32767)
+		d->threshold = 32767;
+	dsp_set_rate(d, d->hz);
+}
+
+/* order doesn't matter within a chunk: a plain loop, for the compiler to vectorize where it can. the gain steps from
+ * one chunk to the next when it's on its way to a new target, by less than the gain change over the whole block */
+static void dsp__gain(struct dsp *d, int16_t *buf, size_t n) {
+	int32_t from = d->gain, to = d->gain_target, chunks = (int32_t)(n / DSP_CHUNK);
+
+	for (int32_t c = 0; c < chunks; c++) {
+		int16_t *x = buf + c * DSP_CHUNK;
+		int32_t gain = from + (to - from) * (c + 1) / chunks;
+		for (int k = 0; k < DSP_CHUNK; k++)
+			x[k] = dsp__saturate((x[k] * gain + (1 << 11)) >> 12);
+	}
+	d->gain = to;
+}
+
+/* direct form I, one stage at a time over the whole block with its state in registers. the state keeps 8 fractional
+ * bits, and what the output is rounded off by goes into the next one (error feedback): low cutoffs put the poles very
+ * close to the unit circle, where the rounding noise would otherwise be amplified a lot */
+static void dsp__biquad(struct dsp_biquad *q, int16_t *buf, size_t n, int swap) {
+	int64_t b0 = q->b0, b1 = q->b1, b2 = q->b2, a1 = q->a1, a2 = q->a2;
+	int32_t x1 = q->x1, x2 = q->x2, y1 = q->y1, y2 = q->y2, err = q->err;
+
+	for (size_t i = 0; i < n; i++) {
+		int16_t *p = buf + (i ^ swap);
+		int32_t x = (int32_t)*p << DSP_FRAC_BITS;
+		int64_t acc = b0 * x + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2 + err;
+		int32_t y = (int32_t)(acc >> DSP_COEF_BITS);
+
+		err = (int32_t)(acc - ((int64_t)y << DSP_COEF_BITS));
+		x2 = x1;
+		x1 = x;
+		y2 = y1;
+		y1 = y;
+		*p = dsp__saturate((y + (1 << (DSP_FRAC_BITS - 1))) >> DSP_FRAC_BITS);
+	}
+	q->x1 = x1;
+	q->x2 = x2;
+	q->y1 = y1;
+	q->y2 = y2;
+	q->err = err;
+}
+
+/* the samples go through a delay of DSP_LOOKAHEAD_CHUNKS chunks, boosted on the way in, and the limiter sees each chunk
+ * as it goes in: by the time it comes out, the gain has been ramped down far enough for its peak to fit under the
+ * threshold. the gain is worked out once per chunk, and interpolated linearly in between, so it never steps */
+static void dsp__limiter(struct dsp *d, int16_t *buf, size_t n) {
+	int32_t *required = d->required;
+	int32_t from = d->boost, to = d->boost_target, chunks = (int32_t)(n / DSP_CHUNK);
+	int swap = d->swap;
+
+	for (size_t c = 0; c < n; c += DSP_CHUNK) {
+		int16_t *x = buf + c;
+		int32_t *slot = d->delay + d->slot * DSP_CHUNK;
+		int32_t boost = from + (to - from) * (int32_t)(c / DSP_CHUNK + 1) / chunks;
+
+		/* the new chunk's peak, boosted, once back up to full level (which may take 32 bits). the chunk holds whole
+		 * pairs, so swap doesn't matter */
+		uint32_t peak = 0;
+		int32_t in[DSP_CHUNK];
+		for (int k = 0; k < DSP_CHUNK; k++) {
+			in[k] = (x[k] * boost + (1 << 11)) >> 12;
+			uint32_t a = (uint32_t)(in[k] < 0 ? -in[k] : in[k]);
+			peak = a > peak ? a : peak;
+		}
+		peak <<= DSP_HEADROOM_SHIFT;
+		memmove(required, required + 1, DSP_LOOKAHEAD_CHUNKS * sizeof(int32_t));
+		required[DSP_LOOKAHEAD_CHUNKS] = peak > (uint32_t)d->threshold ?
+		                                 (int32_t)((uint32_t)d->threshold * 32768 / peak) : 32768;
+
+		/* required[0] is the chunk coming out now, and the gain is already down to it. it can come back up a little by
+		 * the end of it, but no further than a straight line to any of the chunks after it allows */
+		int32_t g0 = d->limiter_gain, g1 = g0 + d->release;
+		if (g1 > 32768)
+			g1 = 32768;
+		if (required[0] < g1)
+			g1 = required[0];
+		for (int m = 1; m <= DSP_LOOKAHEAD_CHUNKS; m++) {
+			if (required[m] < g1) {
+				int32_t ramp = g0 - (g0 - required[m]) / m;
+				if (ramp < g1)
+					g1 = ramp;
+			}
+		}
+		if (g0 < 32768)
+			d->stats.limited++;
+
+		for (int k = 0; k < DSP_CHUNK; k++) {
+			int16_t *p = x + (k ^ swap);
+			int32_t g = g0 + (((g1 - g0) * k) >> DSP_CHUNK_BITS);
+			int64_t out = ((int64_t)slot[k] * g) >> (15 - DSP_HEADROOM_SHIFT);
+
+			slot[k] = in[k ^ swap];
+			*p = (int16_t)(out > 32767 ? 32767 : out < -32768 ? -32768 : out);
+		}
+		d->limiter_gain = g1;
+		d->slot = (d->slot + 1) % DSP_LOOKAHEAD_CHUNKS;
+	}
+	d->boost = to;
+}
+
+void dsp_process(struct dsp *d, int16_t *buf, size_t n) {
+	uint32_t t0 = DSP_CYCLES();
+	dsp__gain(d, buf, n);
+	uint32_t t1 = DSP_CYCLES();
+	for (int i = 0; i < d->nbiquads; i++)
+		dsp__biquad(&d->biquads[i], buf, n, d->swap);
+	uint32_t t2 = DSP_CYCLES();
+	dsp__limiter(d, buf, n);
+	uint32_t t3 = DSP_CYCLES();
+
+	d->stats.samples += n;
+	d->stats.cycles[DSP_STAGE_GAIN] += t1 - t0;
+	d->stats.cycles[DSP_STAGE_EQ] += t2 - t1;
+	d->stats.cycles[DSP_STAGE_LIMITER] += t3 - t2;
+}
+
+const char *dsp_stage_name(int stage) {
+	return stage >= 0 && stage < DSP_STAGES ? dsp__stage_names[stage] : "?";
+}
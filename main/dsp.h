@@ -0,0 +1,89 @@
+#ifndef GAGA_DSP_H
+#define GAGA_DSP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* fixed point processing chain for 16 bit mono samples, run in place on each granule between the synthesis and the
+ * sink: gain, a cascade of biquads (e.g. to cut the bass the speaker can't take, and lift the presence range), and a
+ * look-ahead peak limiter. the samples travel DSP_HEADROOM_SHIFT bits down between the stages, so that EQ boosts up
+ * to that much don't clip before the limiter gets to them; the limiter brings them back up. gain above unity (e.g.
+ * loudness makeup for a quiet station) would use that headroom up, so the gain stage only ever cuts: the limiter
+ * applies the rest as the samples go into its delay, in 32 bits, where it sees the peaks before anything clips */
+#define DSP_MAX_BIQUADS 4
+#define DSP_HEADROOM_SHIFT 1
+#define DSP_CHUNK_BITS 4
+#define DSP_CHUNK (1 << DSP_CHUNK_BITS)  /* the limiter works out its gain once per chunk, and ramps it in between */
+#define DSP_LOOKAHEAD_CHUNKS 4
+#define DSP_DELAY (DSP_CHUNK * DSP_LOOKAHEAD_CHUNKS)  /* samples of latency the limiter adds */
+
+/* biquad types, RBJ cookbook style */
+#define DSP_HIGHPASS 0
+#define DSP_LOWPASS 1
+#define DSP_PEAK 2  /* gain_db at freq, bandwidth set by q */
+#define DSP_HIGHSHELF 3  /* gain_db above freq */
+
+/* stages, for the cycle counts */
+#define DSP_STAGE_GAIN 0
+#define DSP_STAGE_EQ 1
+#define DSP_STAGE_LIMITER 2
+#define DSP_STAGES 3
+
+struct dsp_biquad {
+	int type;
+	float freq, q, gain_db;
+	int32_t b0, b1, b2, a1, a2;  /* Q28 */
+	int32_t x1, x2, y1, y2;  /* past samples, with 8 fractional bits */
+	int32_t err;  /* what the last output was rounded off by, fed back into the next one */
+};
+
+/* running counts since dsp_init(), for profiling */
+struct dsp_stats {
+	uint64_t samples;
+	uint64_t cycles[DSP_STAGES];  /* CPU cycles spent in each stage */
+	uint32_t limited;  /* chunks the limiter turned down */
+};
+
+struct dsp {
+	int swap;  /* 1: every two samples are swapped around, like mp3dec_layout_t.swap */
+	uint32_t hz;
+	int32_t gain, gain_target;  /* Q12, headroom included, unity at most: ramped to the target over the next block */
+	int32_t boost, boost_target;  /* Q12, the gain above unity, applied by the limiter. same ramp */
+	int nbiquads;
+	struct dsp_biquad biquads[DSP_MAX_BIQUADS];
+	float limiter_dbfs, release_ms;
+	int32_t threshold;  /* highest output sample */
+	int32_t release;  /* how much the limiter's gain can come back up per chunk, Q15 */
+	int32_t limiter_gain;  /* Q15, at the start of the next chunk out of the delay */
+	int32_t required[DSP_LOOKAHEAD_CHUNKS + 1];  /* most gain each chunk in the delay (and the new one) can take, Q15 */
+	int slot;  /* oldest chunk in the delay */
+	int32_t delay[DSP_DELAY];  /* boosted, so past int16 */
+	struct dsp_stats stats;
+};
+
+/* a flat chain: unity gain, no biquads, and the limiter at full scale */
+void dsp_init(struct dsp *d, uint32_t hz);
+
+/* designs the filters for another sample rate, keeping their state. float maths: not something to do every block */
+void dsp_set_rate(struct dsp *d, uint32_t hz);
+
+/* the gain is ramped there over the next block, a chunk at a time, so it can be changed as often as needed. up to
+ * +24 dB, more is capped */
+void dsp_set_gain(struct dsp *d, float db);
+
+/* appends a biquad to the cascade, returns -1 if there's no room left. filters at or above 0.45 times the sample rate
+ * pass everything through */
+int dsp_add_biquad(struct dsp *d, int type, float freq, float q, float gain_db);
+
+/* works out a biquad's coefficients from its type, freq, q and gain_db, for sample rate hz */
+void dsp_biquad_design(struct dsp_biquad *q, uint32_t hz);
+
+/* peaks are held at or below threshold_dbfs, and the gain comes back up to unity over release_ms */
+void dsp_set_limiter(struct dsp *d, float threshold_dbfs, float release_ms);
+
+/* processes n samples in place. n must be a multiple of DSP_CHUNK (and a granule is, at any output rate) */
+void dsp_process(struct dsp *d, int16_t *buf, size_t n);
+
+const char *dsp_stage_name(int stage);
+
+#endif //GAGA_DSP_H
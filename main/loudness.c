@@ -0,0 +1,143 @@
+#include <math.h>
+#include <string.h>
+
+#include "loudness.h"
+
+/* the K-weighting curve, as RBJ biquads: at 48 kHz these are within a hair of the coefficients in BS.1770 */
+#define LOUDNESS_SHELF_HZ 1681.97f
+#define LOUDNESS_SHELF_Q 0.70718f
+#define LOUDNESS_SHELF_DB 4.0f
+#define LOUDNESS_HIGHPASS_HZ 38.135f
+#define LOUDNESS_HIGHPASS_Q 0.50033f
+
+#define LOUDNESS_SLEW_DB 0.5f
+#define LOUDNESS_FAST_SLEW_DB 6.0f
+#define LOUDNESS_MAX_CUT_DB 24.0f
+
+static float loudness__lufs(float mean_square) {
+	return -0.691f + 10 * log10f(mean_square + 1e-12f);
+}
+
+void loudness_init(struct loudness *l, uint32_t hz, float target, float max_gain_db) {
+	memset(l, 0, sizeof(*l));
+	l->target = target;
+	l->max_gain_db = max_gain_db;
+	l->max_cut_db = LOUDNESS_MAX_CUT_DB;
+	l->slew_db = LOUDNESS_SLEW_DB;
+	l->fast_slew_db = LOUDNESS_FAST_SLEW_DB;
+
+	l->shelf.type = DSP_HIGHSHELF;
+	l->shelf.freq = LOUDNESS_SHELF_HZ;
+	l->shelf.q = LOUDNESS_SHELF_Q;
+	l->shelf.gain_db = LOUDNESS_SHELF_DB;
+	l->highpass.type = DSP_HIGHPASS;
+	l->highpass.freq = LOUDNESS_HIGHPASS_HZ;
+	l->highpass.q = LOUDNESS_HIGHPASS_Q;
+	loudness_set_rate(l, hz);
+	loudness_restart(l);
+}
+
+void loudness_set_rate(struct loudness *l, uint32_t hz) {
+	l->hz = hz;
+	l->block_len = hz * LOUDNESS_BLOCK_MS / 1000;
+	dsp_biquad_design(&l->shelf, hz);
+	dsp_biquad_design(&l->highpass, hz);
+}
+
+void loudness_restart(struct loudness *l) {
+	l->energy = 0;
+	l->block_samples = 0;
+	l->next = 0;
+	l->filled = 0;
+	l->lufs = LOUDNESS_ABSOLUTE_GATE - 1;
+}
+
+/* mean square of the blocks above the gate, 0 if there are none */
+static float loudness__gated_mean(const struct loudness *l, float gate) {
+	float sum = 0;
+	int count = 0;
+	for (int i = 0; i < l->filled; i++) {
+		if (loudness__lufs(l->blocks[i]) > gate) {
+			sum += l->blocks[i];
+			count++;
+		}
+	}
+	return count ? sum / count : 0;
+}
+
+/* a block has been summed up: update the loudness, and move the gain towards what it takes to hit the target */
+static int loudness__block_done(struct loudness *l) {
+	l->blocks[l->next] = (float)((double)l->energy / 65536 / l->block_samples / (32768.0 * 32768.0));
+	l->next = (l->next + 1) % LOUDNESS_WINDOW_BLOCKS;
+	if (l->filled < LOUDNESS_WINDOW_BLOCKS)
+		l->filled++;
+	l->energy = 0;
+	l->block_samples = 0;
+
+	float ungated = loudness__gated_mean(l, LOUDNESS_ABSOLUTE_GATE);
+	if (ungated == 0) {
+		l->lufs = LOUDNESS_ABSOLUTE_GATE - 1;
+		return 0;  /* silence: leave the gain where it is */
+	}
+	l->lufs = loudness__lufs(loudness__gated_mean(l, loudness__lufs(ungated) + LOUDNESS_RELATIVE_GATE));
+
+	float want = l->target - l->lufs;
+	want = want > l->max_gain_db ? l->max_gain_db : want < -l->max_cut_db ? -l->max_cut_db : want;
+	float slew = (l->filled < LOUDNESS_WINDOW_BLOCKS ? l->fast_slew_db : l->slew_db) * LOUDNESS_BLOCK_MS / 1000;
+	float step = want - l->gain_db;
+	step = step > slew ? slew : step < -slew ? -slew : step;
+	l->gain_db += step;
+	return step != 0;
+}
+
+/* the two biquads in a row, per sample, like dsp.c does them (error feedback included: the highpass' poles are right
+ * next to the unit circle, and a plain truncation there would add a sizeable DC offset), but without rounding back to
+ * 16 bits in between, as the output is only summed up */
+int loudness_update(struct loudness *l, const int16_t *buf, size_t n, int swap) {
+	const struct dsp_biquad *s = &l->shelf, *h = &l->highpass;
+	int64_t sb0 = s->b0, sb1 = s->b1, sb2 = s->b2, sa1 = s->a1, sa2 = s->a2;
+	int64_t hb0 = h->b0, hb1 = h->b1, hb2 = h->b2, ha1 = h->a1, ha2 = h->a2;
+	int32_t sx1 = s->x1, sx2 = s->x2, sy1 = s->y1, sy2 = s->y2, hy1 = h->y1, hy2 = h->y2, serr = s->err, herr = h->err;
+	int64_t energy = l->energy;
+	uint32_t block_samples = l->block_samples;
+	int changed = 0;
+
+	for (size_t i = 0; i < n; i++) {
+		int32_t x = (int32_t)buf[i ^ swap] << 8;
+		int64_t acc = sb0 * x + sb1 * sx1 + sb2 * sx2 - sa1 * sy1 - sa2 * sy2 + serr;
+		int32_t y = (int32_t)(acc >> 28);
+		serr = (int32_t)(acc - ((int64_t)y << 28));
+		acc = hb0 * y + hb1 * sy1 + hb2 * sy2 - ha1 * hy1 - ha2 * hy2 + herr;
+		int32_t z = (int32_t)(acc >> 28);
+		herr = (int32_t)(acc - ((int64_t)z << 28));
+
+		/* the highpass' input is the shelf's output, so its past inputs are the shelf's past outputs */
+		sx2 = sx1;
+		sx1 = x;
+		sy2 = sy1;
+		sy1 = y;
+		hy2 = hy1;
+		hy1 = z;
+		energy += (int64_t)z * z;
+
+		if (++block_samples == l->block_len) {
+			l->energy = energy;
+			l->block_samples = block_samples;
+			changed |= loudness__block_done(l);
+			energy = 0;
+			block_samples = 0;
+		}
+	}
+
+	l->shelf.x1 = sx1;
+	l->shelf.x2 = sx2;
+	l->shelf.y1 = sy1;
+	l->shelf.y2 = sy2;
+	l->shelf.err = serr;
+	l->highpass.err = herr;
+	l->highpass.y1 = hy1;
+	l->highpass.y2 = hy2;
+	l->energy = energy;
+	l->block_samples = block_samples;
+	return changed;
+}
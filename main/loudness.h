@@ -0,0 +1,50 @@
+#ifndef GAGA_LOUDNESS_H
+#define GAGA_LOUDNESS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "dsp.h"
+
+/* loudness normalization. the decoded audio is K-weighted (ITU-R BS.1770: a high shelf and a highpass, the same
+ * biquads the DSP chain uses) and its mean square summed up in LOUDNESS_BLOCK_MS blocks; the short-term loudness is
+ * taken over the last LOUDNESS_WINDOW_BLOCKS of them, leaving out silence (absolute gate) and the quiet bits well below
+ * the rest (relative gate), so that pauses don't pump the gain up. the gain which brings that to the target moves
+ * towards it a fraction of a dB at a time, faster for a while after the stream starts over.
+ * it only sees samples and hands back a gain in dB for the DSP chain to apply, so offline/bench_loudness.c can feed it
+ * captured streams on the host */
+#define LOUDNESS_BLOCK_MS 100
+#define LOUDNESS_WINDOW_BLOCKS 30  /* 3 s, the short-term loudness window */
+#define LOUDNESS_ABSOLUTE_GATE -70.0f  /* LUFS */
+#define LOUDNESS_RELATIVE_GATE -20.0f  /* LU below the ungated loudness */
+
+struct loudness {
+	/* what to aim for and how hard to push: loudness_init() fills in the defaults, the caller may override them */
+	float target;  /* LUFS */
+	float max_gain_db, max_cut_db;
+	float slew_db;  /* how fast the gain moves, dB per second... */
+	float fast_slew_db;  /* ...and right after a restart, until the window has filled up */
+
+	/* state */
+	uint32_t hz;
+	struct dsp_biquad shelf, highpass;
+	int64_t energy;  /* of the block being summed up, K-weighted samples squared, 16 fractional bits */
+	uint32_t block_len, block_samples;
+	float blocks[LOUDNESS_WINDOW_BLOCKS];  /* mean square of the last blocks, full scale is 1 */
+	int next, filled;
+	float lufs;  /* gated short-term loudness, or below LOUDNESS_ABSOLUTE_GATE if there's nothing to go by */
+	float gain_db;  /* current correction */
+};
+
+void loudness_init(struct loudness *l, uint32_t hz, float target, float max_gain_db);
+
+/* K-weighting for another sample rate, keeping what has been measured so far */
+void loudness_set_rate(struct loudness *l, uint32_t hz);
+
+/* the stream started over, possibly on another station: measure from scratch, and catch up quickly. the gain is kept */
+void loudness_restart(struct loudness *l);
+
+/* measures n more samples (swap like mp3dec_layout_t.swap, n even if set). returns 1 if the gain has changed */
+int loudness_update(struct loudness *l, const int16_t *buf, size_t n, int swap);
+
+#endif //GAGA_LOUDNESS_H
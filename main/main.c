@@ -1,22 +1,34 @@
 #include <sys/cdefs.h>
 #include <assert.h>
+#include <stdatomic.h>
+#include <string.h>
 #include <sys/time.h>
-#include <freertos/ringbuf.h>
 #include <FreeRTOSConfig.h>
 #include <freertos/portmacro.h>
 #include <freertos/projdefs.h>
 #include <freertos/task.h>
+#include <freertos/queue.h>
+#include <esp_attr.h>
 #include <esp_err.h>
 #include <nvs_flash.h>
 #include <hal/i2s_types.h>
 #include <driver/i2s_common.h>
 #include <driver/i2s_std.h>
+#include <driver/gpio.h>
 #include <esp_log.h>
+#include <soc/rtc.h>
 
 //#define STREAM_EMBEDDED_DATA
 //#define SOURCE_TASK_EMBEDDED_DATA
 
 #define MINIMP3_ONLY_MP3
+#ifdef CONFIG_GAGA_MP3_FIXED_POINT
+#define MINIMP3_FIXED_POINT
+#endif
+#ifdef CONFIG_GAGA_MP3_WIDE_HUFFMAN
+#define MINIMP3_WIDE_HUFFMAN
+#endif
+#define MINIMP3_GRANULE_CHANNELS 1  /* we only ever render one channel */
 #define MINIMP3_NONSTANDARD_BUT_LOGICAL
 #define MINIMP3_IMPLEMENTATION
 #include "minimp3.h"
@@ -24,37 +36,418 @@
 #include "data.h"
 #include "streaming.h"
 #include "checksum.h"
+#include "slot_queue.h"
+#include "byte_ring.h"
+#include "drift.h"
+#include "resampler.h"
+#include "dsp.h"
+#include "loudness.h"
 
 static const char *TAG = "a_main";
 
 #define SOURCE_STACK_SIZE 4096
 #define DECODER_STACK_SIZE 8192
 #define SINK_STACK_SIZE 4096
-#define MP3_RINGBUF_SIZE (1024*8)
-#define MP3_DECODER_BUF_SIZE (1024*24)
-#define AUDIO_BUF_SIZE MINIMP3_MAX_SAMPLES_PER_FRAME
+#define SYNTH_STACK_SIZE 4096
+#define MP3_RING_SIZE (1024*24)
+#define MP3_RING_GUARD (1024*16)  /* the most unread data the decoder asks for in one piece: enough to synchronize on */
+#define AUDIO_BUF_SIZE (GRANULE_SAMPLES * MINIMP3_GRANULE_CHANNELS)  /* one granule */
 #define MAX_SEEK_RETIES 10
 
-struct signals {
-  TaskHandle_t sink;
-  TaskHandle_t decoder;
-} signals;
+#if defined(CONFIG_GAGA_MONO_LEFT)
+#define MONO_POLICY MINIMP3_MONO_LEFT
+#elif defined(CONFIG_GAGA_MONO_RIGHT)
+#define MONO_POLICY MINIMP3_MONO_RIGHT
+#else
+#define MONO_POLICY MINIMP3_MONO_MIX
+#endif
+
+/* reduced rate output: the synthesis only renders the lower half (or quarter) of the spectrum, at half (or a quarter)
+ * of the stream's sample rate, which is all our speaker can play anyway, for a fraction of the work */
+#if defined(CONFIG_GAGA_OUTPUT_QUARTER_RATE)
+#define OUTPUT_SHIFT 2
+#elif defined(CONFIG_GAGA_OUTPUT_HALF_RATE)
+#define OUTPUT_SHIFT 1
+#else
+#define OUTPUT_SHIFT 0
+#endif
+#define GRANULE_SAMPLES (576 >> OUTPUT_SHIFT)  /* what a granule turns into */
+
+/* band pruning: the decoder leaves out the subbands above this, as the speaker can't play them anyway */
+#ifdef CONFIG_GAGA_BAND_CUTOFF_HZ
+#define BAND_CUTOFF_HZ CONFIG_GAGA_BAND_CUTOFF_HZ
+#else
+#define BAND_CUTOFF_HZ 0
+#endif
+#define STATS_INTERVAL_GRANULES 5000  /* about a minute at 48 kHz */
+
+#ifdef CONFIG_GAGA_PCM_QUEUE_DEPTH
+#define PCM_QUEUE_DEPTH CONFIG_GAGA_PCM_QUEUE_DEPTH
+#else
+#define PCM_QUEUE_DEPTH 4
+#endif
+
+/* the sink follows the sample rate of the stream, switching as soon as the first granule at a new rate is due. it
+ * starts out at the highest one mp3 has, which is also what the DMA buffers are sized for */
+#define I2S_SAMPLE_RATE (48000 >> OUTPUT_SHIFT)
+/* the APLL can't go below this: the i2s driver picks a divider from mclk which keeps it above */
+#define APLL_MIN_HZ 5000000
+
+/* resampling: the sink stays at I2S_SAMPLE_RATE whatever the stream's rate, and the synthesized audio is resampled to
+ * it on its way to the sink, by whichever task runs the synthesis */
+#ifdef CONFIG_GAGA_RESAMPLE
+#define RESAMPLE
+#if defined(CONFIG_GAGA_RESAMPLE_FAST)
+#define RESAMPLE_TAPS RESAMPLER_FAST
+#elif defined(CONFIG_GAGA_RESAMPLE_BEST)
+#define RESAMPLE_TAPS RESAMPLER_BEST
+#else
+#define RESAMPLE_TAPS RESAMPLER_MEDIUM
+#endif
+#endif
+
+/* clock drift compensation: the decoder watches how much of the stream is buffered, and the sink trims the APLL */
+#if defined(CONFIG_GAGA_DRIFT_COMPENSATION) && !defined(SOURCE_TASK_EMBEDDED_DATA)
+#define DRIFT_COMPENSATION
+#define DRIFT_MAX_PPM CONFIG_GAGA_DRIFT_MAX_PPM
+#endif
+
+/* zero copy sink: the decoder renders straight into the i2s DMA buffers, one granule each, instead of going through the
+ * pcm queue and i2s_channel_write(). there are as many buffers as the latency target allows at 48 kHz, at least 3:
+ * the latency grows at lower rates, as granules get longer */
+#ifdef CONFIG_GAGA_I2S_ZERO_COPY
+#define I2S_ZERO_COPY
+#define I2S_LATENCY_MS CONFIG_GAGA_I2S_LATENCY_MS
+#define DMA_DESC_NUM (I2S_LATENCY_MS * I2S_SAMPLE_RATE / 1000 / GRANULE_SAMPLES > 3 ? \
+                      I2S_LATENCY_MS * I2S_SAMPLE_RATE / 1000 / GRANULE_SAMPLES : 3)
+#endif
+
+/* speaker processing between the synthesis and the sink: bass cut, presence boost, limiter (see dsp.h) */
+#ifdef CONFIG_GAGA_DSP
+#define DSP_CHAIN
+#define DSP_GAIN_DB CONFIG_GAGA_DSP_GAIN_DB
+#define DSP_HIGHPASS_HZ CONFIG_GAGA_DSP_HIGHPASS_HZ
+#define DSP_PRESENCE_HZ CONFIG_GAGA_DSP_PRESENCE_HZ
+#define DSP_PRESENCE_DB CONFIG_GAGA_DSP_PRESENCE_DB
+#define DSP_LIMITER_DBFS CONFIG_GAGA_DSP_LIMITER_DBFS
+#define DSP_RELEASE_MS 200
+#endif
+
+/* loudness normalization: the DSP chain's gain follows the station's loudness (see loudness.h) */
+#if defined(CONFIG_GAGA_LOUDNESS) && defined(DSP_CHAIN)
+#define LOUDNESS
+#define LOUDNESS_TARGET CONFIG_GAGA_LOUDNESS_TARGET
+#define LOUDNESS_MAX_GAIN_DB CONFIG_GAGA_LOUDNESS_MAX_GAIN_DB
+#endif
+
+/* amplifier idling: the amp's enable pin is pulled low once the stream has been digitally silent (granules which decode
+ * to all zeroes) for a while, and high again as soon as there's something to play */
+#ifdef CONFIG_GAGA_AMP_IDLE
+#define AMP_IDLE
+#define AMP_GPIO CONFIG_GAGA_AMP_IDLE_GPIO
+#define AMP_IDLE_US (CONFIG_GAGA_AMP_IDLE_MS * 1000ull)
+#endif
+
+/* dual core decoding: the decoder task does everything up to the IMDCT, and hands the granules to a synth task on the
+ * other core, which runs the synthesis filterbank and fills the pcm queue. the source task shares the core with the
+ * Wi-Fi stack and the synth task, the decoder gets the other one for itself */
+#if defined(CONFIG_GAGA_DUAL_CORE) && !defined(SOURCE_TASK_EMBEDDED_DATA)
+#define DUAL_CORE_DECODER
+#endif
+#define GRANULE_QUEUE_DEPTH 3
+
+#ifdef CONFIG_ESP_WIFI_TASK_PINNED_TO_CORE_1
+#define WIFI_CORE 1
+#else
+#define WIFI_CORE 0
+#endif
+
+#ifdef DUAL_CORE_DECODER
+#define SOURCE_CORE WIFI_CORE
+#define DECODER_CORE (1 - WIFI_CORE)
+#define SYNTH_CORE WIFI_CORE
+#else
+#define SOURCE_CORE tskNO_AFFINITY
+#define DECODER_CORE tskNO_AFFINITY
+#endif
 
 _Noreturn void sink_task(void *param);
 _Noreturn void decoder_task(void *param);
+_Noreturn void synth_task(void *param);
+void sink_set_rate(uint32_t hz);
+void sink_trim_clock(float ppm);
+void sink_follow_trim(void);
+
+/* the i2s channel, and the sample rate it's running at */
+i2s_chan_handle_t tx_handle;
+uint32_t sink_rate_hz = I2S_SAMPLE_RATE;
+
+/* one decoded granule (GRANULE_SAMPLES samples, half a frame in MPEG-1). the decoder renders straight into a free slot of the pcm
+ * queue as soon as a granule is ready, and the sink writes it to i2s from there, so the DMA can start on the first half
+ * of a frame while the second is being decoded, and the decoder can work up to PCM_QUEUE_DEPTH granules ahead */
+struct pcm_frame {
+	size_t useful_size;  /* bytes of samples actually used */
+	uint32_t hz;  /* sample rate */
+	uint16_t buf[AUDIO_BUF_SIZE];  /* note: mp3dec will write *signed* data in here */
+};
+
+#ifndef I2S_ZERO_COPY
+struct pcm_frame pcm_frames[PCM_QUEUE_DEPTH];
+struct slot_queue pcm_queue;
+
+/* the decoder side of the sink: where to put the next granule, and handing it over once it's there */
+struct pcm_frame *pcm_frame_filling;
+
+void *pcm__acquire(uint32_t hz) {
+	/* get a free pcm slot: this blocks while the sink is PCM_QUEUE_DEPTH granules behind */
+	pcm_frame_filling = slot_queue_acquire(&pcm_queue, portMAX_DELAY);
+	pcm_frame_filling->hz = hz;  /* the sink switches rate when it gets here */
+	return pcm_frame_filling->buf;
+}
+
+void pcm__commit(size_t size) {
+	pcm_frame_filling->useful_size = size;
+	slot_queue_commit(&pcm_queue);
+}
+#else
+/* DMA buffers the i2s has finished sending, in order: each of them is played again once the DMA has gone around all
+ * the others, so that's how long the decoder has to refill it. the one the DMA is sending is never in here */
+QueueHandle_t dma_free_bufs;
+StaticQueue_t dma_free_bufs_queue;
+uint8_t dma_free_bufs_storage[(DMA_DESC_NUM - 1) * sizeof(void *)];
+volatile uint32_t dma_underruns;  /* buffers which went out before the decoder could refill them */
+volatile uint32_t dma_sent;  /* buffers the DMA has finished sending, ever */
+uint32_t dma_sent_at_acquire;  /* dma_sent when the decoder got its last buffer */
+
+void *pcm__acquire(uint32_t hz) {
+	void *buf;
+
+	/* the decoder fills the DMA buffers itself, so it's the one which has to switch the rate before filling any more,
+	 * and which owns the clock */
+	if (hz != sink_rate_hz)
+		sink_set_rate(hz);
+#if defined(DRIFT_COMPENSATION) && !defined(RESAMPLE)
+	sink_follow_trim();
+#endif
 
-volatile uint16_t buf[AUDIO_BUF_SIZE];  /* note: mp3dec will write *signed* data in here */
-volatile size_t useful_size = 0;  /* used by the source to signal available bytes */
+	xQueueReceive(dma_free_bufs, &buf, portMAX_DELAY);
+	dma_sent_at_acquire = dma_sent;
+	return buf;
+}
+
+void pcm__commit(size_t size) {
+	/* nothing to do, the DMA gets to the buffer when its turn comes */
+}
+
+static IRAM_ATTR bool sink__on_sent(i2s_chan_handle_t handle, i2s_event_data_t *event, void *user_ctx) {
+	BaseType_t woken = pdFALSE;
+	void *buf = *(void **)event->data;  /* a pointer to the DMA buffer pointer */
+
+	/* cleared here rather than by the driver's auto_clear, which would do it after this returns: by then the decoder
+	 * may already be filling the buffer from the other core */
+	memset(buf, 0, event->size);
+
+	/* the decoder is behind: the oldest buffer is the one the DMA has just started sending (cleared when it was queued,
+	 * so it plays as silence). it's too late for it, forget it */
+	if (xQueueIsQueueFullFromISR(dma_free_bufs)) {
+		void *stale;
+		xQueueReceiveFromISR(dma_free_bufs, &stale, &woken);
+		dma_underruns++;
+	}
+	dma_sent++;
+	xQueueSendFromISR(dma_free_bufs, &buf, &woken);
+	return woken == pdTRUE;
+}
+#endif
+
+/* synthesis filterbank state, only ever touched by the task running the synthesis */
+mp3dec_synth_t mp3_synth;
+
+#ifndef RESAMPLE
+/* with 16 bit mono, the i2s DMA wants every two samples swapped around: the synthesis stores them in that order right
+ * away, so the sink can write the slots as they are */
+static const mp3dec_layout_t pcm_layout = {
+	.stride = 1, .offset = { 0, -1 }, .swap = 1, .format = MINIMP3_PCM_S16, .shift = OUTPUT_SHIFT
+};
+#else
+/* the synthesis stores the samples in order for the resampler, which swaps them around for the DMA instead */
+static const mp3dec_layout_t pcm_layout = {
+	.stride = 1, .offset = { 0, -1 }, .swap = 0, .format = MINIMP3_PCM_S16, .shift = OUTPUT_SHIFT
+};
+
+struct resampler resampler;  /* only ever touched by the task running the synthesis, like mp3_synth */
+mp3d_sample_t resampler_in[576];
+volatile float resampler_ppm;  /* set by the drift compensation, picked up by the next granule */
+#endif
+
+#ifdef AMP_IDLE
+uint64_t amp_silent_us;  /* how long the stream has been silent, only ever touched by the task running the synthesis */
+
+static void sink__amp_init(void) {
+	gpio_reset_pin(AMP_GPIO);
+	gpio_set_direction(AMP_GPIO, GPIO_MODE_OUTPUT);
+	gpio_set_level(AMP_GPIO, 1);
+}
+
+/* keeps track of the silence on its way to the sink, and idles the amp when there's been enough of it. the decoder
+ * works ahead of the i2s, so when the sound comes back the amp has that long to wake up before it gets there */
+void sink_track_silence(const mp3dec_granule_t *granule) {
+	if (!granule->silent) {
+		if (amp_silent_us >= AMP_IDLE_US) {
+			ESP_LOGI(TAG, "Amplifier on after %llu ms of silence", amp_silent_us / 1000);
+			gpio_set_level(AMP_GPIO, 1);
+		}
+		amp_silent_us = 0;
+	} else if (amp_silent_us < AMP_IDLE_US) {
+		amp_silent_us += 576 * 1000000ull / granule->hz;
+		if (amp_silent_us >= AMP_IDLE_US) {
+			ESP_LOGI(TAG, "Amplifier idle");
+			gpio_set_level(AMP_GPIO, 0);
+		}
+	} else {
+		amp_silent_us += 576 * 1000000ull / granule->hz;
+	}
+}
+#endif
+
+#ifdef DSP_CHAIN
+struct dsp dsp;  /* only ever touched by the task running the synthesis, like mp3_synth */
+#ifdef LOUDNESS
+struct loudness loudness;  /* same */
+#endif
+
+/* runs the speaker processing in place over a granule on its way to the sink, at the rate it was synthesized at */
+static void pcm__process(const mp3dec_granule_t *granule, mp3d_sample_t *buf) {
+	static struct dsp_stats last;
+	uint32_t hz = granule->hz >> OUTPUT_SHIFT;
+
+	if (hz != dsp.hz)
+		dsp_set_rate(&dsp, hz);
+#ifdef LOUDNESS
+	/* measured before the processing, which would otherwise be in the loop */
+	if (hz != loudness.hz)
+		loudness_set_rate(&loudness, hz);
+	if (granule->reset)
+		loudness_restart(&loudness);
+	if (loudness_update(&loudness, buf, GRANULE_SAMPLES, dsp.swap))
+		dsp_set_gain(&dsp, DSP_GAIN_DB + loudness.gain_db);
+#endif
+	dsp_process(&dsp, buf, GRANULE_SAMPLES);
+
+	/* every now and then, log what it costs */
+	uint64_t samples = dsp.stats.samples - last.samples;
+	if (samples < (uint64_t)STATS_INTERVAL_GRANULES * GRANULE_SAMPLES)
+		return;
+#ifdef LOUDNESS
+	ESP_LOGI(TAG, "Loudness: %.1f LUFS, gain %+.1f dB", loudness.lufs, loudness.gain_db);
+#endif
+	ESP_LOGI(TAG, "DSP: %s %llu, %s %llu, %s %llu cycles per sample, limiting %lu%% of the time",
+	         dsp_stage_name(DSP_STAGE_GAIN), (dsp.stats.cycles[DSP_STAGE_GAIN] - last.cycles[DSP_STAGE_GAIN]) / samples,
+	         dsp_stage_name(DSP_STAGE_EQ), (dsp.stats.cycles[DSP_STAGE_EQ] - last.cycles[DSP_STAGE_EQ]) / samples,
+	         dsp_stage_name(DSP_STAGE_LIMITER),
+	         (dsp.stats.cycles[DSP_STAGE_LIMITER] - last.cycles[DSP_STAGE_LIMITER]) / samples,
+	         (uint32_t)((uint64_t)(dsp.stats.limited - last.limited) * DSP_CHUNK * 100 / samples));
+	last = dsp.stats;
+}
+#endif
+
+/* synthesizes a granule into the sink */
+void pcm__render(mp3dec_granule_t *granule) {
+#ifdef AMP_IDLE
+	sink_track_silence(granule);
+#endif
+#ifdef RESAMPLE
+	/* no stream is faster than I2S_SAMPLE_RATE, so the filter stays the one resampler_init() designed: cheap */
+	if ((uint32_t)granule->hz >> OUTPUT_SHIFT != resampler.in_hz)
+		resampler_set_rate(&resampler, granule->hz >> OUTPUT_SHIFT, I2S_SAMPLE_RATE);
+	if (resampler_ppm != resampler.ppm)
+		resampler_set_ppm(&resampler, resampler_ppm);
+
+	mp3dec_synth_granule(&mp3_synth, granule, resampler_in);
+#ifdef DSP_CHAIN
+	pcm__process(granule, resampler_in);
+#endif
+	resampler_write(&resampler, resampler_in, GRANULE_SAMPLES);
+
+	/* the output comes out in granule sized blocks too, as that's what the pcm slots and the DMA buffers hold: the
+	 * rest waits for the next granule */
+	while (resampler_available(&resampler) >= GRANULE_SAMPLES) {
+		resampler_read(&resampler, pcm__acquire(I2S_SAMPLE_RATE), GRANULE_SAMPLES);
+		pcm__commit(sizeof(mp3d_sample_t) * GRANULE_SAMPLES);
+	}
+#else
+	mp3d_sample_t *buf = pcm__acquire(granule->hz >> OUTPUT_SHIFT);
+	mp3dec_synth_granule(&mp3_synth, granule, buf);
+#ifdef DSP_CHAIN
+	pcm__process(granule, buf);  /* right where the sink will find it: no copies */
+#endif
+	pcm__commit(sizeof(mp3d_sample_t) * GRANULE_SAMPLES * granule->channels);
+#endif
+}
+
+#ifdef DUAL_CORE_DECODER
+/* granules decoded up to the IMDCT, on their way to the synth task */
+mp3dec_granule_t granule_slots[GRANULE_QUEUE_DEPTH];
+struct slot_queue granule_queue;
+
+_Noreturn void synth_task(void *param) {
+	ESP_LOGD(TAG, "Starting SYNTH task");
+
+	while (1) {
+		mp3dec_granule_t *granule = slot_queue_peek(&granule_queue, portMAX_DELAY);
+
+		pcm__render(granule);
+		slot_queue_release(&granule_queue);
+	}
+}
+#endif
+
+/* decodes the granules of the frame mp3dec_decode_frame_front() has just parsed, and passes each of them on as soon as
+ * it's done. the frame's main data is in minimp3's own buffer by now, so the input can already be consumed */
+void decoder__decode_granules(mp3dec_t *mp3d, size_t granules) {
+	for (size_t g = 0; g < granules; g++) {
+#ifdef DUAL_CORE_DECODER
+		/* the synth task works on this one while we do the next. this blocks while it's GRANULE_QUEUE_DEPTH behind */
+		mp3dec_granule_t *granule = slot_queue_acquire(&granule_queue, portMAX_DELAY);
+		mp3dec_decode_granule(mp3d, granule);
+		slot_queue_commit(&granule_queue);
+#else
+		static mp3dec_granule_t granule;
+
+		mp3dec_decode_granule(mp3d, &granule);
+		pcm__render(&granule);
+#endif
+	}
+}
+
+/* every now and then, log what the decoder has been up to */
+void decoder__log_stats(mp3dec_t *mp3d) {
+	static mp3dec_stats_t last;
+	mp3dec_stats_t stats;
+
+	mp3dec_get_stats(mp3d, &stats);
+	if (stats.granules - last.granules < STATS_INTERVAL_GRANULES)
+		return;
+
+	unsigned long channels = stats.channels - last.channels;
+	unsigned long pruned = stats.bands_pruned - last.bands_pruned;
+	ESP_LOGI(TAG, "Decoder: %lu granules (%lu silent), %lu channels rendered, %lu%% of the bands pruned",
+	         stats.granules - last.granules, stats.silent - last.silent, channels,
+	         channels ? pruned * 100 / (channels * 32) : 0);
+	last = stats;
+}
 
 #ifdef SOURCE_TASK_EMBEDDED_DATA
 _Noreturn void decoder_task(void *param) {
 	mp3dec_frame_info_t info;
 	size_t cur_pos = 0;
-	size_t samples, retries;
+	size_t granules, retries;
 
 	/* init MP3 decoder */
 	static mp3dec_t mp3d;
 	mp3dec_init(&mp3d);
+	mp3dec_set_mono(&mp3d, MONO_POLICY);
+	mp3dec_set_cutoff(&mp3d, BAND_CUTOFF_HZ, 32 >> OUTPUT_SHIFT);
 
 	/* get MP3 data pointer */
 	const uint8_t *audio_data = audio_data_start;
@@ -64,16 +457,14 @@ _Noreturn void decoder_task(void *param) {
 	ESP_LOGD(TAG, "Buffer size: %d (%p - %p)", audio_data_len, audio_data_end, audio_data_start);
 
 	while (1) {
-		xTaskNotifyWait(0, 0, NULL, portMAX_DELAY);
-
-		samples = 0;
+		granules = 0;
 		retries = MAX_SEEK_RETIES;
 
-		while (samples == 0 && cur_pos != audio_data_len && --retries) {
+		while (granules == 0 && cur_pos != audio_data_len && --retries) {
 			info.frame_bytes = 0;
-			samples = mp3dec_decode_frame(&mp3d,
-										  audio_data + cur_pos, audio_data_len - cur_pos,
-										  (mp3d_sample_t *)buf, &info);
+			granules = mp3dec_decode_frame_front(&mp3d,
+			                                     audio_data + cur_pos, audio_data_len - cur_pos,
+			                                     &info);
 			cur_pos += info.frame_bytes;
 		}
 
@@ -88,142 +479,284 @@ _Noreturn void decoder_task(void *param) {
 			}
 		}
 
-		useful_size = sizeof(mp3d_sample_t) * samples;
-		xTaskNotify(signals.sink, 0, eNoAction);
+		decoder__decode_granules(&mp3d, granules);
+		decoder__log_stats(&mp3d);
 	}
 }
 #else
 
-uint8_t mp3_decoder_buf[MP3_DECODER_BUF_SIZE];
-int mp3_decoder_buf_curr_size = 0;
-
-#define SYNCHRONIZATION_BYTES (MP3_DECODER_BUF_SIZE * 2 / 3)
-
-void decoder__queue_to_decoder_buffer(RingbufHandle_t rb, int synchronized) {
-	size_t dequeue_size;
-	uint8_t *dequeue_buf;
-
-	/* determine how many bytes to read at most.
-	 * the idea is that if we're synchronized, we're happy with whatever comes (as we use a delay of 0).
-	 * if we are not, however, the task logic will keep calling us, so we have to block and yield or other tasks will
-	 * not run. as such, we have to request a value that actually makes sense to avoid waiting indefinitely, and that is
-	 * SYNCHRONIZATION_BYTES. */
-	size_t max_bytes_to_read = MP3_DECODER_BUF_SIZE - mp3_decoder_buf_curr_size;;
-	if (!synchronized && max_bytes_to_read > SYNCHRONIZATION_BYTES)
-		max_bytes_to_read = SYNCHRONIZATION_BYTES;
-
-	/* get buffer from the queue */
-	dequeue_buf = xRingbufferReceiveUpTo(rb,
-										 &dequeue_size,
-										 synchronized ? (TickType_t)0 : portMAX_DELAY,
-										 max_bytes_to_read);
-
-	/* this isn't really documented, but if the queue is empty dequeue_size will be populated with a bogus value; as
-	 * such, we must check the pointer itself to see if an item was returned */
-	if (dequeue_buf != NULL) {
-		assert(dequeue_size + mp3_decoder_buf_curr_size <= MP3_DECODER_BUF_SIZE);
-
-		/* copy the data from the queue to our buffer */
-		memcpy(mp3_decoder_buf + mp3_decoder_buf_curr_size, dequeue_buf, dequeue_size);
-		/* cast uint8_t to int -- can't do much about this, FreeRTOS and minimp3 use different data types */
-		mp3_decoder_buf_curr_size += dequeue_size;
-
-		/* signal to the queue that we're done */
-		vRingbufferReturnItem(rb, dequeue_buf);
+#define SYNCHRONIZATION_BYTES (MP3_RING_SIZE * 2 / 3)
+#define MIN_DECODE_BYTES (1441 + 4)  /* biggest standard frame (320 kbps @ 32 kHz) and the next header */
+
+#ifdef CONFIG_GAGA_FAST_START
+#define FAST_START_MATCHES CONFIG_GAGA_FAST_START_MATCHES
+#else
+#define FAST_START_MATCHES 0
+#endif
+
+/* is there enough data in the ring to try decoding? */
+int decoder__can_decode(struct byte_ring *ring, int synchronized) {
+	size_t len = byte_ring_fill(ring);
+
+	if (synchronized)
+		return len >= MIN_DECODE_BYTES;
+
+	/* with this much data, minimp3 can find the first frame by itself, skipping whatever crap comes before it */
+	if (len >= SYNCHRONIZATION_BYTES)
+		return 1;
+
+#if FAST_START_MATCHES
+	/* fast start: don't wait for SYNCHRONIZATION_BYTES, skip the crap ourselves as soon as a few consistent frame
+	 * headers are in. the sink starts playing right away, and the buffers fill up while we play as the stream comes in
+	 * faster than real time */
+	const uint8_t *data = byte_ring_peek(ring, SYNCHRONIZATION_BYTES, &len);
+	int offset = mp3dec_find_sync(data, (int)len, FAST_START_MATCHES);
+	if (offset >= 0) {
+		byte_ring_consume(ring, offset);
+		return 1;
 	}
+#endif
+
+	return 0;
 }
 
+#ifdef DRIFT_COMPENSATION
+struct drift_ctl drift;
+float drift_elapsed_s;  /* audio decoded since the controller was last updated */
+float drift_applied_ppm;
+
+/* once per second of audio, tell the drift controller how much of the stream is waiting to be decoded */
+void decoder__track_drift(struct byte_ring *ring, const mp3dec_frame_info_t *info, size_t granules) {
+	drift_elapsed_s += 576.0f * granules / info->hz;
+	if (drift_elapsed_s < 1.0f || info->bitrate_kbps == 0)  /* free format streams don't tell their bitrate */
+		return;
+
+	float level_ms = (float)byte_ring_fill(ring) * 8 / info->bitrate_kbps;
+	float ppm = drift_update(&drift, level_ms, drift_elapsed_s);
+	drift_elapsed_s = 0;
+
+	if (ppm != drift_applied_ppm) {
+		sink_trim_clock(ppm);
+		drift_applied_ppm = ppm;
+		ESP_LOGD(TAG, "Drift: %.0f ms buffered, %+.1f ppm", level_ms, ppm);
+	}
+}
+#endif
+
 _Noreturn void decoder_task(void *param) {
-	RingbufHandle_t rb = (RingbufHandle_t)param;
+	struct byte_ring *ring = param;
 
 	mp3dec_frame_info_t info;
-	size_t samples, retries;
+	const uint8_t *data;
+	size_t len, want, granules, retries;
 	int synchronized = 0;  /* is the decoder currently synchronized? */
+	int need_more = 0;  /* minimp3 can't tell whether what's in the window is a frame without seeing more data */
 	uint8_t mp3_frame_ck;  /* debug */
 	uint64_t mp3_abs_position = 0;  /* debug */
 
 	/* init MP3 decoder */
 	static mp3dec_t mp3d;  /* don't allocate this on the stack, as it's absolutely huge */
 	mp3dec_init(&mp3d);
+	mp3dec_set_mono(&mp3d, MONO_POLICY);  /* we only have one speaker: only decode what we'll play */
+	mp3dec_set_cutoff(&mp3d, BAND_CUTOFF_HZ, 32 >> OUTPUT_SHIFT);  /* and only the part of the spectrum it can play */
+
+#ifdef DRIFT_COMPENSATION
+	drift_init(&drift, DRIFT_MAX_PPM);
+#endif
 
 	ESP_LOGD(TAG, "Starting SOURCE task");
 
 	while (1) {
-		/* wait for the streaming task to give us a good amount of data if we're not synchronized yet */
+		/* wait for the streaming task to give us enough data: a frame if we're synchronized, enough to synchronize if
+		 * we're not, anything new if minimp3 couldn't make sense of what's there. the data is decoded right where the
+		 * streaming task has put it */
+		int ready;
 		do {
-			decoder__queue_to_decoder_buffer(rb, synchronized);
-		} while (!synchronized && mp3_decoder_buf_curr_size < SYNCHRONIZATION_BYTES);
+			ready = !need_more && decoder__can_decode(ring, synchronized);
+			if (!ready)
+				byte_ring_wait(ring, byte_ring_fill(ring) + 1, portMAX_DELAY);
+			need_more = 0;
+		} while (!ready);
 
-		/* wait for sink task to give us access to the pcm buffer */
-		xTaskNotifyWait(0, 0, NULL, portMAX_DELAY);
-
-		samples = 0;
+		granules = 0;
 		retries = MAX_SEEK_RETIES;
+		want = synchronized ? MIN_DECODE_BYTES : SYNCHRONIZATION_BYTES;
 
-		while (samples == 0 && --retries) {
-			/* decode some bytes */
+		while (granules == 0 && --retries) {
+			/* find and parse a frame */
 			info.frame_bytes = 0;
-			samples = mp3dec_decode_frame(&mp3d,
-			                              mp3_decoder_buf, mp3_decoder_buf_curr_size,
-			                              (mp3d_sample_t *)buf, &info);
-			mp3_frame_ck = checksum(mp3_decoder_buf, info.frame_bytes);
-
-			/* use up the bytes in the source buffer */
-			memmove(mp3_decoder_buf, mp3_decoder_buf + info.frame_bytes, mp3_decoder_buf_curr_size - info.frame_bytes);
-			mp3_decoder_buf_curr_size -= info.frame_bytes;
+			data = byte_ring_peek(ring, want, &len);
+			granules = mp3dec_decode_frame_front(&mp3d, data, (int)len, &info);
+			mp3_frame_ck = checksum((uint8_t *)data, info.frame_bytes);
+
+			/* use up the bytes in the ring: this just moves the read position. minimp3 only ever skips bytes which it
+			 * knows can't be the start of a frame, the rest stays in the ring for the next attempt. the layer III
+			 * granules don't point into the mp3 data, so the streaming task can have the room back right away */
+			byte_ring_consume(ring, info.frame_bytes);
 			mp3_abs_position += info.frame_bytes;
+
+			if (!granules && !info.frame_bytes) {
+				/* the source has switched over to another connection there: nothing more is coming for what's left
+				 * of the old one's last frame, if anything. drop it, and keep the next frame away from the bit
+				 * reservoir, which was filled from the old one */
+				if (byte_ring_skip_cut(ring)) {
+					ESP_LOGI(TAG, "Stream cut, carrying on from the new connection");
+					mp3dec_discontinuity(&mp3d);
+#ifdef DRIFT_COMPENSATION
+					drift_restart(&drift);  /* the buffer has drained across the cut, that's not the clocks' doing */
+#endif
+					continue;
+				}
+				if (len < byte_ring_fill(ring) && want < SYNCHRONIZATION_BYTES) {
+					/* the span stopped at the wrap, and what minimp3 is looking at runs past it (e.g. a resync candidate
+					 * it can't tell from the few KB left): more data would never make the span any longer. have the
+					 * ring put the rest in one piece instead. not a retry, nothing was skipped */
+					want = SYNCHRONIZATION_BYTES;
+					retries++;
+					continue;
+				}
+				need_more = 1;
+				break;
+			}
 		}
 
-		if (!retries) {
+		if (need_more) {
+			continue;  /* wait for more data */
+		} else if (!retries) {
 			ESP_LOGE(TAG, "Sync fail!");
-			mp3_decoder_buf_curr_size = 0;  /* flush source data */
-			useful_size = 0;  /* don't send anything to sink */
-			synchronized = 0;  /* we're not synchronized to the mp3 stream anymore */
-		} else {
-			synchronized = 1;
-			useful_size = sizeof(mp3d_sample_t) * samples;
-			ESP_LOGV(TAG, "Decode: %d mp3 -> %d PCM -- ch=%d br=%d hz=%d -- %llx: in ck %x, next ck %x, out ck %x",
-					 info.frame_bytes, samples,
-					 info.channels, info.bitrate_kbps, info.hz,
-					 mp3_abs_position,
-					 mp3_frame_ck,
-					 checksum(mp3_decoder_buf, 500),
-					 checksum((uint8_t*)buf, useful_size));
+			synchronized = 0;  /* we're not synchronized to the mp3 stream anymore, but keep what we have */
+#ifdef DRIFT_COMPENSATION
+			drift_restart(&drift);  /* the buffer level is going to be something else entirely */
+#endif
+			continue;  /* don't send anything to sink */
 		}
-
-		/* get sink task to consume new pcm data */
-		xTaskNotify(signals.sink, 0, eNoAction);
+		synchronized = 1;
+		data = byte_ring_peek(ring, MIN_DECODE_BYTES, &len);
+		ESP_LOGV(TAG, "Decode: %d mp3 -> %d granules -- ch=%d br=%d hz=%d -- %llx: in ck %x, next ck %x",
+				 info.frame_bytes, granules,
+				 info.channels, info.bitrate_kbps, info.hz,
+				 mp3_abs_position,
+				 mp3_frame_ck,
+				 checksum((uint8_t *)data, len < 500 ? len : 500));
+
+		decoder__decode_granules(&mp3d, granules);
+		decoder__log_stats(&mp3d);
+#ifdef DRIFT_COMPENSATION
+		decoder__track_drift(ring, &info, granules);
+#endif
 	}
 }
 #endif
 
-/* this does three things:
- * 1) it turns stereo into mono
- * 2) it swaps around every two mono samples, as required by the DMA
- * 3) it inverts the MSB of each sample, converting to unsigned PCM <- removed, because it causes clipping. what? */
-void audio_sbramangle_mono_data() {
-	for (size_t i = 0; i < useful_size; i += 2) {
-		buf[i+1] = ((int16_t*)buf)[2*i];
-		buf[i] = ((int16_t*)buf)[2*i+2];
+#if defined(DRIFT_COMPENSATION) && defined(RESAMPLE)
+/* the i2s clock stays where it is: the resampler consumes the stream ppm faster instead */
+void sink_trim_clock(float ppm) {
+	resampler_ppm = ppm;
+}
+#elif defined(DRIFT_COMPENSATION)
+_Atomic float sink_trim_requested;  /* set by the decoder, picked up by whichever task owns the i2s clock */
+float sink_trim_ppm;  /* what the APLL is trimmed by, only touched by that task */
+
+/* runs the i2s clock ppm faster (or slower) than nominal, by setting the APLL fractional divider directly: the driver
+ * has no way to trim its clock, and asking for a new APLL frequency the official way would clash with its reference.
+ * only for the task which also calls sink_set_rate(), or the trim could be worked out for the rate it's replacing */
+static void sink__trim_apll(float ppm) {
+	uint32_t o_div, sdm0, sdm1, sdm2;
+
+	/* what the i2s driver has set the APLL to: mclk (256 times the sample rate) times the smallest divider which gets
+	 * it over APLL_MIN_HZ, and at least 2 */
+	uint32_t mclk = sink_rate_hz * 256;
+	uint32_t mclk_div = APLL_MIN_HZ / mclk + 1;
+	uint32_t nominal = mclk * (mclk_div < 2 ? 2 : mclk_div);
+	uint32_t freq = nominal + (int32_t)(nominal / 1e6f * ppm);
+
+	if (rtc_clk_apll_coeff_calc(freq, &o_div, &sdm0, &sdm1, &sdm2))
+		rtc_clk_apll_coeff_set(o_div, sdm0, sdm1, sdm2);
+	sink_trim_ppm = ppm;
+}
+
+/* called by the decoder, which doesn't own the clock: the trim is applied before the next granule goes out */
+void sink_trim_clock(float ppm) {
+	atomic_store(&sink_trim_requested, ppm);
+}
+
+void sink_follow_trim(void) {
+	float ppm = atomic_load(&sink_trim_requested);
+	if (ppm != sink_trim_ppm)
+		sink__trim_apll(ppm);
+}
+#endif
+
+static i2s_std_clk_config_t sink__clock_config(uint32_t hz) {
+	i2s_std_clk_config_t clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(hz);  /* mono: the sample rate is the frame clock */
+	clk_cfg.clk_src = I2S_CLK_SRC_APLL;
+	return clk_cfg;
+}
+
+#ifndef I2S_ZERO_COPY
+size_t sink_dma_bytes;  /* what fits in all the DMA buffers together */
+#endif
+
+/* switches the i2s over to another sample rate, once everything queued at the old one has been played: the channel
+ * is stopped in the middle of silence, so there's no click. the output stays mono whatever the stream is, as the
+ * decoder folds the channels together */
+void sink_set_rate(uint32_t hz) {
+	ESP_LOGI(TAG, "Sample rate: %lu Hz -> %lu Hz", sink_rate_hz, hz);
+
+#ifdef I2S_ZERO_COPY
+	/* called by the decoder, which stops filling DMA buffers and lets the DMA go around all of them: by then the last
+	 * one it filled has been sent, and they have all been cleared by sink__on_sent */
+	void *buf;
+	while (dma_sent - dma_sent_at_acquire < DMA_DESC_NUM)
+		xQueueReceive(dma_free_bufs, &buf, portMAX_DELAY);
+#else
+	/* called by the sink: push the DMA buffers' worth of silence after the last samples. once it's all in, they have
+	 * been sent */
+	static const mp3d_sample_t silence[576];
+	size_t bytes_written;
+	for (size_t left = sink_dma_bytes; left > 0; left -= bytes_written) {
+		i2s_channel_write(tx_handle, silence, left < sizeof(silence) ? left : sizeof(silence),
+		                  &bytes_written, portMAX_DELAY);
 	}
-	useful_size >>= 1;
+#endif
+
+	i2s_std_clk_config_t clk_cfg = sink__clock_config(hz);
+	i2s_channel_disable(tx_handle);
+	i2s_channel_reconfig_std_clock(tx_handle, &clk_cfg);
+	sink_rate_hz = hz;
+#if defined(DRIFT_COMPENSATION) && !defined(RESAMPLE)
+	sink__trim_apll(sink_trim_ppm);  /* the driver has just set the APLL back to nominal */
+#endif
+#ifdef I2S_ZERO_COPY
+	/* the DMA starts over from the first buffer: forget the order they came back in so far */
+	xQueueReset(dma_free_bufs);
+#endif
+	i2s_channel_enable(tx_handle);
 }
 
 void sink_task(void *param) {
 	ESP_LOGD(TAG, "Starting SINK task");
+#ifdef AMP_IDLE
+	sink__amp_init();
+#endif
 
-	i2s_chan_handle_t tx_handle;
 	/* Get the default channel configuration by helper macro.
 	 * This helper macro is defined in 'i2s_common.h' and shared by all the i2s communication mode.
 	 * It can help to specify the I2S role, and port id */
 	i2s_chan_config_t chan_cfg = I2S_CHANNEL_DEFAULT_CONFIG(I2S_NUM_0, I2S_ROLE_MASTER);
+#ifdef I2S_ZERO_COPY
+	/* one granule per DMA buffer (see pcm_layout), the decoder writes straight into them */
+	chan_cfg.dma_desc_num = DMA_DESC_NUM;
+	chan_cfg.dma_frame_num = GRANULE_SAMPLES;
+	chan_cfg.auto_clear = false;  /* sink__on_sent clears them before handing them over */
+#endif
 	/* Allocate a new tx channel and get the handle of this channel */
 	i2s_new_channel(&chan_cfg, &tx_handle, NULL);
 	/* Setting the configurations, the slot configuration and clock configuration can be generated by the macros
 	 * These two helper macros is defined in 'i2s_std.h' which can only be used in STD mode.
 	 * They can help to specify the slot and clock configurations for initialization or updating */
 	i2s_std_config_t std_cfg = {
-		.clk_cfg = I2S_STD_CLK_DEFAULT_CONFIG(48000),  /* 48kHz mono = 48kHz clock */
+		.clk_cfg = sink__clock_config(I2S_SAMPLE_RATE),  /* until the first granule tells the stream's */
 		.slot_cfg = I2S_STD_PHILIPS_SLOT_DEFAULT_CONFIG(I2S_DATA_BIT_WIDTH_16BIT, I2S_SLOT_MODE_MONO),
 		.gpio_cfg = {
 			.mclk = I2S_GPIO_UNUSED,
@@ -238,12 +771,30 @@ void sink_task(void *param) {
 			},
 		},
 	};
-	std_cfg.clk_cfg.clk_src = I2S_CLK_SRC_APLL;
 	/* Initialize the channel */
 	i2s_channel_init_std_mode(tx_handle, &std_cfg);
 
+#ifdef I2S_ZERO_COPY
+	/* the DMA buffers start out zeroed, so there's nothing to preload: the channel plays silence while the first on_sent
+	 * events hand them over to the decoder, which fills them from then on */
+	i2s_event_callbacks_t callbacks = {
+		.on_sent = sink__on_sent,
+	};
+	i2s_channel_register_event_callback(tx_handle, &callbacks, NULL);
+	i2s_channel_enable(tx_handle);
+
+	uint32_t underruns = 0;
+	while (1) {
+		vTaskDelay(pdMS_TO_TICKS(1000));
+		if (dma_underruns != underruns) {
+			ESP_LOGW(TAG, "DMA underruns: %lu", dma_underruns - underruns);
+			underruns = dma_underruns;
+		}
+	}
+#else
 	/* Before write data, start the tx channel first */
 	i2s_channel_enable(tx_handle);
+	sink_dma_bytes = chan_cfg.dma_desc_num * chan_cfg.dma_frame_num * sizeof(mp3d_sample_t);
 
 	struct timeval t0, t1;
 	gettimeofday(&t0, 0);
@@ -251,26 +802,32 @@ void sink_task(void *param) {
 
 	size_t i = 0;
 	while (1) {
-		xTaskNotifyWait(0, 0, NULL, portMAX_DELAY);
+		/* wait for the oldest decoded frame; the decoder keeps filling the other slots meanwhile */
+		struct pcm_frame *frame = slot_queue_peek(&pcm_queue, portMAX_DELAY);
+		size_t useful_size = frame->useful_size;
+		if (frame->hz != sink_rate_hz)
+			sink_set_rate(frame->hz);
+#if defined(DRIFT_COMPENSATION) && !defined(RESAMPLE)
+		sink_follow_trim();
+#endif
 		/* start gathering stats when first sample is actually received */
 		if (bytes_written_from_start == 0 && useful_size > 0)
 			gettimeofday(&t0, 0);
 
-		//ESP_LOGD(TAG, "US: %d ## PrS ck %x", useful_size, checksum((uint8_t *)buf, useful_size));
-		audio_sbramangle_mono_data();
-		//ESP_LOGD(TAG, "US: %d ## PoS ck %x", useful_size, checksum((uint8_t *)buf, useful_size));
+		/* no need to touch the samples: the synthesis already stored them the way the DMA wants them (see pcm_layout) */
+		//ESP_LOGD(TAG, "US: %d ## ck %x", useful_size, checksum((uint8_t *)frame->buf, useful_size));
 
 		size_t bytes_written, bytes_written_total;
 		bytes_written_total = 0;
 		while (bytes_written_total < useful_size) {
 			//ESP_LOGD(TAG, "x");
 			i2s_channel_write(tx_handle,
-			                  (char *) buf + bytes_written_total,
-			                  2 * useful_size - bytes_written_total,
+			                  (char *) frame->buf + bytes_written_total,
+			                  useful_size - bytes_written_total,
 			                  &bytes_written, 10000);
 			bytes_written_total += bytes_written;
 		}
-		xTaskNotify(signals.decoder, 0, eNoAction);
+		slot_queue_release(&pcm_queue);
 
 		/* print some stats */
 		bytes_written_from_start += bytes_written_total;
@@ -284,14 +841,7 @@ void sink_task(void *param) {
 			}
 		}
 	}
-
-	/* If the configurations of slot or clock need to be updated,
-	 * stop the channel first and then update it */
-	// i2s_channel_disable(tx_handle);
-	// std_cfg.slot_cfg.slot_mode = I2S_SLOT_MODE_MONO; // Default is stereo
-	// i2s_channel_reconfig_std_slot(tx_handle, &std_cfg.slot_cfg);
-	// std_cfg.clk_cfg.sample_rate_hz = 96000;
-	// i2s_channel_reconfig_std_clock(tx_handle, &std_cfg.clk_cfg);
+#endif
 
 	/* Have to stop the channel before deleting it */
 	i2s_channel_disable(tx_handle);
@@ -299,25 +849,34 @@ void sink_task(void *param) {
 	i2s_del_channel(tx_handle);
 }
 
+#if !defined(SOURCE_TASK_EMBEDDED_DATA) && !defined(STREAM_EMBEDDED_DATA)
+void source__on_title(const char *title) {
+	ESP_LOGI(TAG, "Now playing: %s", title);
+}
+#endif
+
 _Noreturn void source_task(void* param) {
-	RingbufHandle_t rb = (RingbufHandle_t)param;
+	struct byte_ring *ring = param;
 
 #ifndef SOURCE_TASK_EMBEDDED_DATA
 #ifndef STREAM_EMBEDDED_DATA
-	while (1) {
-		if (wifi_init_sta())
-			fetch_radio(rb);
-	}
+	streaming_set_title_callback(source__on_title);
+	wifi_init_sta();
+	stream_radio(ring);
 #else  // STREAM_EMBEDDED_DATA
 	while (1)
-		stream_embedded_data(rb);
+		stream_embedded_data(ring);
 #endif  // STREAM_EMBEDDED_DATA
 #endif  // SOURCE_TASK_EMBEDDED_DATA
 }
 
 
-StaticRingbuffer_t mp3_ringbuf;
-uint8_t mp3_ringbuf_backing_storage[MP3_RINGBUF_SIZE];
+#ifndef SOURCE_TASK_EMBEDDED_DATA
+struct byte_ring mp3_ring;
+uint8_t mp3_ring_storage[MP3_RING_GUARD + MP3_RING_SIZE];
+_Static_assert(MP3_RING_GUARD >= SYNCHRONIZATION_BYTES, "minimp3 needs what it synchronizes on in one piece");
+_Static_assert(MP3_RING_GUARD >= MIN_DECODE_BYTES, "the decoder needs a whole frame in one piece");
+#endif
 
 void app_main() {
 	esp_log_level_set("*", ESP_LOG_INFO);
@@ -331,37 +890,67 @@ void app_main() {
 	ESP_ERROR_CHECK(ret);
 
 #ifndef SOURCE_TASK_EMBEDDED_DATA
-	RingbufHandle_t rb = xRingbufferCreateStatic(MP3_RINGBUF_SIZE,
-												 RINGBUF_TYPE_BYTEBUF,
-												 mp3_ringbuf_backing_storage,
-												 &mp3_ringbuf);
+	byte_ring_init(&mp3_ring, mp3_ring_storage, MP3_RING_SIZE, MP3_RING_GUARD);
+	struct byte_ring *ring = &mp3_ring;
+#else
+	struct byte_ring *ring = NULL;
+#endif
+
+#ifdef I2S_ZERO_COPY
+	dma_free_bufs = xQueueCreateStatic(DMA_DESC_NUM - 1, sizeof(void *), dma_free_bufs_storage, &dma_free_bufs_queue);
 #else
-	void *rb = NULL;
+	slot_queue_init(&pcm_queue, pcm_frames, sizeof(struct pcm_frame), PCM_QUEUE_DEPTH);
+#endif
+	mp3dec_synth_init(&mp3_synth);
+	mp3_synth.layout = pcm_layout;
+#ifdef RESAMPLE
+	resampler_init(&resampler, RESAMPLE_TAPS, I2S_SAMPLE_RATE, I2S_SAMPLE_RATE);
+	resampler.swap = 1;  /* see pcm_layout */
+#endif
+#ifdef DSP_CHAIN
+	dsp_init(&dsp, I2S_SAMPLE_RATE);
+	dsp.swap = pcm_layout.swap;  /* it runs on the samples as the synthesis stores them */
+	dsp_set_gain(&dsp, DSP_GAIN_DB);
+	if (DSP_HIGHPASS_HZ > 0)
+		dsp_add_biquad(&dsp, DSP_HIGHPASS, DSP_HIGHPASS_HZ, 0.707f, 0);
+	if (DSP_PRESENCE_HZ > 0 && DSP_PRESENCE_DB != 0)
+		dsp_add_biquad(&dsp, DSP_PEAK, DSP_PRESENCE_HZ, 1.0f, DSP_PRESENCE_DB);
+	dsp_set_limiter(&dsp, DSP_LIMITER_DBFS, DSP_RELEASE_MS);
+#endif
+#ifdef LOUDNESS
+	loudness_init(&loudness, I2S_SAMPLE_RATE, LOUDNESS_TARGET, LOUDNESS_MAX_GAIN_DB);
+#endif
+#ifdef DUAL_CORE_DECODER
+	slot_queue_init(&granule_queue, granule_slots, sizeof(mp3dec_granule_t), GRANULE_QUEUE_DEPTH);
 #endif
 
 	BaseType_t result;
 
 	result = xTaskCreate(sink_task, "SINK", SINK_STACK_SIZE, NULL,
-	                     configMAX_PRIORITIES - 1, &signals.sink);
+	                     configMAX_PRIORITIES - 1, NULL);
 	if (result != pdPASS) {
 		ESP_LOGE(TAG, "Could not create task SINK");
 		while (1);
 	}
 
-	/* pass the ring buffer as a void*, (ab)using the implementation detail that RingbufHandle_t is a pointer type */
-	result = xTaskCreate(decoder_task, "DECODER", DECODER_STACK_SIZE, (void *)rb,
-	                     configMAX_PRIORITIES - 2, &signals.decoder);
+	result = xTaskCreatePinnedToCore(decoder_task, "DECODER", DECODER_STACK_SIZE, ring,
+	                                 configMAX_PRIORITIES - 2, NULL, DECODER_CORE);
 	if (result != pdPASS) {
 		ESP_LOGE(TAG, "Could not create task DECODER");
 		while (1);
 	}
 
-	// maestro attacchi!
-	xTaskNotify(signals.decoder, 0, eNoAction);
+#ifdef DUAL_CORE_DECODER
+	result = xTaskCreatePinnedToCore(synth_task, "SYNTH", SYNTH_STACK_SIZE, NULL,
+	                                 configMAX_PRIORITIES - 2, NULL, SYNTH_CORE);
+	if (result != pdPASS) {
+		ESP_LOGE(TAG, "Could not create task SYNTH");
+		while (1);
+	}
+#endif
 
-	/* pass the ring buffer as a void*, (ab)using the implementation detail that RingbufHandle_t is a pointer type */
-	result = xTaskCreate(source_task, "SOURCE", SOURCE_STACK_SIZE, (void *)rb,
-	                     configMAX_PRIORITIES - 3, NULL);
+	result = xTaskCreatePinnedToCore(source_task, "SOURCE", SOURCE_STACK_SIZE, ring,
+	                                 configMAX_PRIORITIES - 3, NULL, SOURCE_CORE);
 	if (result != pdPASS) {
 		ESP_LOGE(TAG, "Could not create task SOURCE");
 		while (1);
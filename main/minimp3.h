@@ -10,6 +10,13 @@
 
 #define MINIMP3_MAX_SAMPLES_PER_FRAME (1152*2)
 
+/* mono render policies for mp3dec_set_mono(). with anything but MINIMP3_MONO_OFF, stereo streams are folded to a single
+ * channel in the frequency domain, so IMDCT and synthesis run once per granule and pcm receives one channel only */
+#define MINIMP3_MONO_OFF            0
+#define MINIMP3_MONO_LEFT           1
+#define MINIMP3_MONO_RIGHT          2
+#define MINIMP3_MONO_MIX            3
+
 typedef struct
 {
   int frame_bytes, frame_offset, channels, hz, layer, bitrate_kbps;
@@ -18,11 +25,78 @@ typedef struct
 struct mp3dec_s;
 typedef struct mp3dec_s mp3dec_t;
 
+#ifdef MINIMP3_FIXED_POINT
+typedef int32_t mp3d_real_t;
+#else /* MINIMP3_FIXED_POINT */
+typedef float mp3d_real_t;
+#endif /* MINIMP3_FIXED_POINT */
+
+#ifndef MINIMP3_GRANULE_CHANNELS
+#define MINIMP3_GRANULE_CHANNELS    2  /* 1 is enough with mp3dec_set_mono() */
+#endif /* MINIMP3_GRANULE_CHANNELS */
+
+/* a layer III granule between mp3dec_decode_granule() and mp3dec_synth_granule(): 576 subband samples per channel */
+typedef struct
+{
+  int channels, hz, reset;  /* reset: a new stream starts here, the synthesis filterbank has to start over */
+  int silent;               /* buf is all zeroes: nothing coded, and nothing left over from the last granule */
+  mp3d_real_t buf[MINIMP3_GRANULE_CHANNELS][576];
+} mp3dec_granule_t;
+
+/* output sample formats for mp3dec_layout_t */
+#define MINIMP3_PCM_S16             0  /* mp3d_sample_t */
+#define MINIMP3_PCM_S32             1  /* 16 bit samples in the upper half of 32 bit slots (integer output only) */
+
+/* where mp3dec_synth_granule() stores the samples, so that they can land straight in the order and format the audio
+ * hardware wants: sample n of channel ch goes to pcm[(n ^ swap)*stride + offset[ch]], and isn't stored at all if
+ * offset[ch] < 0. all zeroes means packed interleaved mp3d_sample_t, like mp3dec_decode_frame() does.
+ * with shift, only the lower 32 >> shift subbands are synthesized, and only every (1 << shift)-th sample is computed,
+ * which makes for 576 >> shift samples per granule at a sample rate that many times lower: the filterbank with the
+ * upper subbands left out, and its window decimated to match */
+typedef struct
+{
+  int stride;     /* elements from one sample to the next one of the same channel */
+  int offset[2];  /* position of each channel within a sample */
+  int swap;       /* 1 to swap every two consecutive samples (e.g. ESP32 I2S, 16 bit mono) */
+  int format;     /* MINIMP3_PCM_S16 or MINIMP3_PCM_S32 */
+  int shift;      /* 0 for the full sample rate, 1 for half, 2 for a quarter */
+} mp3dec_layout_t;
+
+/* running counts since mp3dec_init(), for profiling */
+typedef struct
+{
+  unsigned long granules;      /* layer III granules decoded */
+  unsigned long channels;      /* channels rendered (IMDCT and synthesis), summed over the granules */
+  unsigned long bands_pruned;  /* subbands left out of all that, summed over the rendered channels */
+  unsigned long silent;        /* granules which came out as all zeroes, skipping the IMDCT and synthesis */
+} mp3dec_stats_t;
+
+/* synthesis filterbank state for mp3dec_synth_granule(). layout can be set after mp3dec_synth_init() */
+typedef struct
+{
+  mp3dec_layout_t layout;
+  int idle;  /* qmf_state is all zeroes: silent granules just store zeroes */
+  mp3d_real_t qmf_state[15*2*32], syn[18 + 15][2*32];
+} mp3dec_synth_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif /* __cplusplus */
 
+/* with MINIMP3_WIDE_HUFFMAN, the first call also builds the (shared) wide Huffman tables: make it before any decoder
+ * runs on another task */
 void mp3dec_init(mp3dec_t *dec);
+void mp3dec_set_mono(mp3dec_t *dec, int policy);
+/* layer III band pruning, for speakers which can't play the top of the spectrum anyway: the subbands above cutoff_hz
+ * (plus one, for the filterbank's transition band) are still Huffman decoded, stereo processed and reordered, but
+ * zeroed after that, and left out of the antialiasing, the IMDCT and the rest. never more than max_bands are processed either (e.g. 16 when synthesizing at
+ * half rate, see mp3dec_layout_t.shift). 0 and 32 turn each limit off, which is the default */
+void mp3dec_set_cutoff(mp3dec_t *dec, int cutoff_hz, int max_bands);
+void mp3dec_get_stats(const mp3dec_t *dec, mp3dec_stats_t *stats);
+/* the data from here on doesn't follow on from what came before (e.g. it comes from another server), even if it looks
+ * like it does: the next frame's bit reservoir isn't there, so it is skipped rather than decoded from the wrong bytes.
+ * the filterbanks are kept, the audio carries on */
+void mp3dec_discontinuity(mp3dec_t *dec);
 #ifndef MINIMP3_FLOAT_OUTPUT
 typedef int16_t mp3d_sample_t;
 #else /* MINIMP3_FLOAT_OUTPUT */
@@ -30,6 +104,21 @@ typedef float mp3d_sample_t;
 void mp3dec_f32_to_s16(const float *in, int16_t *out, int num_samples);
 #endif /* MINIMP3_FLOAT_OUTPUT */
 int mp3dec_decode_frame(mp3dec_t *dec, const uint8_t *mp3, int mp3_bytes, mp3d_sample_t *pcm, mp3dec_frame_info_t *info);
+/* offset of the first frame followed by at least min_matches consistent headers, or -1 if there isn't one (yet).
+ * nothing is decoded or skipped, so this can be polled while data arrives (free format streams are never matched) */
+int mp3dec_find_sync(const uint8_t *mp3, int mp3_bytes, int min_matches);
+
+/* split layer III decoding, to hand out the output one granule at a time as soon as it's ready, and/or to run the
+ * synthesis filterbank somewhere else (e.g. on the other core) than the rest.
+ * mp3dec_decode_frame_front() finds and parses a frame like mp3dec_decode_frame() does, and returns how many granules it
+ * has (0 if there's nothing to decode, info->frame_bytes tells how many bytes to skip as usual). each of them is then
+ * taken up to the IMDCT by mp3dec_decode_granule(), which doesn't need the mp3 data anymore, and turned into 576
+ * (>> layout.shift) samples per channel by mp3dec_synth_granule(). granules must be synthesized in order, and synth must only ever be
+ * touched by one task */
+int mp3dec_decode_frame_front(mp3dec_t *dec, const uint8_t *mp3, int mp3_bytes, mp3dec_frame_info_t *info);
+void mp3dec_decode_granule(mp3dec_t *dec, mp3dec_granule_t *gr);
+void mp3dec_synth_init(mp3dec_synth_t *synth);
+void mp3dec_synth_granule(mp3dec_synth_t *synth, mp3dec_granule_t *gr, void *pcm);
 
 #ifdef __cplusplus
 }
@@ -50,6 +139,7 @@ int mp3dec_decode_frame(mp3dec_t *dec, const uint8_t *mp3, int mp3_bytes, mp3d_s
 #define MAX_L3_FRAME_PAYLOAD_BYTES  MAX_FREE_FORMAT_FRAME_SIZE /* MUST be >= 320000/8/32000*1152 = 1440 */
 
 #define MAX_BITRESERVOIR_BYTES      511
+#define MAX_MAINDATA_BYTES          (MAX_BITRESERVOIR_BYTES + 2*MAX_L3_FRAME_PAYLOAD_BYTES)
 #define SHORT_BLOCK_TYPE            2
 #define STOP_BLOCK_TYPE             3
 #define MODE_MONO                   3
@@ -80,6 +170,35 @@ int mp3dec_decode_frame(mp3dec_t *dec, const uint8_t *mp3, int mp3_bytes, mp3d_s
 #define MINIMP3_MIN(a, b)           ((a) > (b) ? (b) : (a))
 #define MINIMP3_MAX(a, b)           ((a) < (b) ? (b) : (a))
 
+#ifdef MINIMP3_FIXED_POINT
+/* integer backend for targets without a (fast) FPU. samples travel through the whole layer III pipeline as Q24, where
+ * a full scale signal is roughly 1.0, so there are 7 bits of headroom; constants are Q27, as the biggest one is ~10.2.
+ * the synthesis window is made of plain integers and accumulates in 64 bits, exactly like the float code */
+#ifndef MINIMP3_ONLY_MP3
+#error MINIMP3_FIXED_POINT only implements layer III, define MINIMP3_ONLY_MP3
+#endif /* MINIMP3_ONLY_MP3 */
+#ifdef MINIMP3_FLOAT_OUTPUT
+#error MINIMP3_FIXED_POINT and MINIMP3_FLOAT_OUTPUT are mutually exclusive
+#endif /* MINIMP3_FLOAT_OUTPUT */
+#ifndef MINIMP3_NO_SIMD
+#define MINIMP3_NO_SIMD
+#endif /* MINIMP3_NO_SIMD */
+#define MP3D_FRAC_BITS              24
+#define MP3D_COEF_BITS              27
+#define MP3D_P43_BITS               21
+typedef int64_t mp3d_acc_t;
+typedef struct { int32_t m; int32_t sh; } mp3d_scf_t;  /* 2^(q/4) as mantissa and right shift, see L3_scf() */
+#define MP3D_C(x)                   ((int32_t)((x)*(1 << MP3D_COEF_BITS) + ((x) < 0 ? -0.5 : 0.5)))
+#define MP3D_P43(x)                 ((int32_t)((x)*(1 << MP3D_P43_BITS) + ((x) < 0 ? -0.5 : 0.5)))
+#define MP3D_MUL(a, c)              ((int32_t)(((int64_t)(a)*(c)) >> MP3D_COEF_BITS))
+#else /* MINIMP3_FIXED_POINT */
+typedef float mp3d_acc_t;
+typedef float mp3d_scf_t;
+#define MP3D_C(x)                   (x)
+#define MP3D_P43(x)                 (x)
+#define MP3D_MUL(a, c)              ((a)*(c))
+#endif /* MINIMP3_FIXED_POINT */
+
 #if !defined(MINIMP3_NO_SIMD)
 
 #if !defined(MINIMP3_ONLY_SIMD) && (defined(_M_X64) || defined(__x86_64__) || defined(__aarch64__) || defined(_M_ARM64))
@@ -228,17 +347,23 @@ typedef struct
 typedef struct
 {
   bs_t bs;
-  uint8_t maindata[MAX_BITRESERVOIR_BYTES + MAX_L3_FRAME_PAYLOAD_BYTES];
   L3_gr_info_t gr_info[4];
-  float grbuf[2][576], scf[40], syn[18 + 15][2*32];
+  mp3d_real_t grbuf[2][576], syn[18 + 15][2*32];
+  mp3d_scf_t scf[40];
   uint8_t ist_pos[2][39];
 } mp3dec_scratch_t;
 
 struct mp3dec_s
 {
-  float mdct_overlap[2][9*32], qmf_state[15*2*32];
-  int reserv, free_format_bytes;
-  unsigned char header[4], reserv_buf[511];
+  mp3d_real_t mdct_overlap[2][9*32], qmf_state[15*2*32];
+  /* silent granules: the last one came out as all zeroes, each overlap is all zeroes, so is qmf_state */
+  int silent, mdct_idle[2], qmf_idle;
+  int reserv, maindata_end, free_format_bytes, mono;
+  int cutoff_hz, max_bands;  /* see mp3dec_set_cutoff() */
+  mp3dec_stats_t stats;
+  int qmf_reset, granules, granule_next;  /* split decoding, see mp3dec_decode_frame_front() */
+  /* main data of the last frames: the reservoir is the reserv bytes before maindata_end */
+  unsigned char header[4], maindata[MAX_MAINDATA_BYTES];
 
   mp3dec_scratch_t scratch;
 
@@ -254,6 +379,7 @@ static void bs_init(bs_t *bs, const uint8_t *data, int bytes)
 	bs->limit = bytes*8;
 }
 
+/* 1 <= n <= 24 */
 static uint32_t get_bits(bs_t *bs, int n)
 {
 	uint32_t next, cache = 0, s = bs->pos & 7;
@@ -261,6 +387,12 @@ static uint32_t get_bits(bs_t *bs, int n)
 	const uint8_t *p = bs->buf + (bs->pos >> 3);
 	if ((bs->pos += n) > bs->limit)
 		return 0;
+	if (bs->limit - bs->pos >= 32 - shl)
+	{
+		/* the whole word is in the buffer: one load instead of a byte at a time */
+		cache = (uint32_t)p[0] << 24 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 8 | p[3];
+		return cache << s >> (32 - n);
+	}
 	next = *p++ & (255 >> s);
 	while ((shl -= 8) > 0)
 	{
@@ -648,6 +780,30 @@ static void L3_read_scalefactors(uint8_t *scf, uint8_t *ist_pos, const uint8_t *
 	scf[0] = scf[1] = scf[2] = 0;
 }
 
+#ifdef MINIMP3_FIXED_POINT
+static mp3d_real_t L3_ldexp_q2(mp3d_real_t y, int exp_q2)
+{
+	static const int32_t g_expfrac[4] = { MP3D_C(1.0f),MP3D_C(0.84089642f),MP3D_C(0.70710678f),MP3D_C(0.59460356f) };
+	return MP3D_MUL(y, g_expfrac[exp_q2 & 3]) >> MINIMP3_MIN(exp_q2 >> 2, 31);
+}
+
+/* a scalefactor 2^(q/4) is kept as a Q30 mantissa and a shift, such that a Q21 pow43 value times the mantissa, shifted
+ * right, is the Q24 dequantized sample */
+static mp3d_scf_t L3_scf(int q)
+{
+	static const int32_t g_expfrac[4] = { 1073741824,1276901417,1518500250,1805811301 };
+	mp3d_scf_t scf;
+	scf.m = g_expfrac[q & 3];
+	scf.sh = MINIMP3_MIN(MP3D_P43_BITS + 30 - MP3D_FRAC_BITS - (q >> 2), 63);
+	return scf;
+}
+
+static mp3d_real_t L3_deq(int32_t p43, mp3d_scf_t scf)
+{
+	int64_t v = ((int64_t)p43*scf.m) >> scf.sh;
+	return (mp3d_real_t)MINIMP3_MAX(MINIMP3_MIN(v, INT32_MAX), -INT32_MAX);
+}
+#else /* MINIMP3_FIXED_POINT */
 static float L3_ldexp_q2(float y, int exp_q2)
 {
 	static const float g_expfrac[4] = { 9.31322575e-10f,7.83145814e-10f,6.58544508e-10f,5.53767716e-10f };
@@ -659,8 +815,9 @@ static float L3_ldexp_q2(float y, int exp_q2)
 	} while ((exp_q2 -= e) > 0);
 	return y;
 }
+#endif /* MINIMP3_FIXED_POINT */
 
-static void L3_decode_scalefactors(const uint8_t *hdr, uint8_t *ist_pos, bs_t *bs, const L3_gr_info_t *gr, float *scf, int ch)
+static void L3_decode_scalefactors(const uint8_t *hdr, uint8_t *ist_pos, bs_t *bs, const L3_gr_info_t *gr, mp3d_scf_t *scf, int ch)
 {
 	static const uint8_t g_scf_partitions[3][28] = {
 		{ 6,5,5, 5,6,5,5,5,6,5, 7,3,11,10,0,0, 7, 7, 7,0, 6, 6,6,3, 8, 8,5,0 },
@@ -670,7 +827,9 @@ static void L3_decode_scalefactors(const uint8_t *hdr, uint8_t *ist_pos, bs_t *b
 	const uint8_t *scf_partition = g_scf_partitions[!!gr->n_short_sfb + !gr->n_long_sfb];
 	uint8_t scf_size[4], iscf[40];
 	int i, scf_shift = gr->scalefac_scale + 1, gain_exp, scfsi = gr->scfsi;
+#ifndef MINIMP3_FIXED_POINT
 	float gain;
+#endif /* MINIMP3_FIXED_POINT */
 
 	if (HDR_TEST_MPEG1(hdr))
 	{
@@ -715,22 +874,135 @@ static void L3_decode_scalefactors(const uint8_t *hdr, uint8_t *ist_pos, bs_t *b
 	}
 
 	gain_exp = gr->global_gain + BITS_DEQUANTIZER_OUT*4 - 210 - (HDR_IS_MS_STEREO(hdr) ? 2 : 0);
+#ifdef MINIMP3_FIXED_POINT
+	/* same as below: the gain is 2^(gain_exp/4), every scalefactor step divides it by 2^(1/4) */
+	for (i = 0; i < (int)(gr->n_long_sfb + gr->n_short_sfb); i++)
+	{
+		scf[i] = L3_scf(gain_exp - (iscf[i] << scf_shift));
+	}
+#else /* MINIMP3_FIXED_POINT */
 	gain = L3_ldexp_q2(1 << (MAX_SCFI/4),  MAX_SCFI - gain_exp);
 	for (i = 0; i < (int)(gr->n_long_sfb + gr->n_short_sfb); i++)
 	{
 		scf[i] = L3_ldexp_q2(gain, iscf[i] << scf_shift);
 	}
+#endif /* MINIMP3_FIXED_POINT */
 }
 
-static const float g_pow43[129 + 16] = {
-	0,-1,-2.519842f,-4.326749f,-6.349604f,-8.549880f,-10.902724f,-13.390518f,-16.000000f,-18.720754f,-21.544347f,-24.463781f,-27.473142f,-30.567351f,-33.741992f,-36.993181f,
-	0,1,2.519842f,4.326749f,6.349604f,8.549880f,10.902724f,13.390518f,16.000000f,18.720754f,21.544347f,24.463781f,27.473142f,30.567351f,33.741992f,36.993181f,40.317474f,43.711787f,47.173345f,50.699631f,54.288352f,57.937408f,61.644865f,65.408941f,69.227979f,73.100443f,77.024898f,81.000000f,85.024491f,89.097188f,93.216975f,97.382800f,101.593667f,105.848633f,110.146801f,114.487321f,118.869381f,123.292209f,127.755065f,132.257246f,136.798076f,141.376907f,145.993119f,150.646117f,155.335327f,160.060199f,164.820202f,169.614826f,174.443577f,179.305980f,184.201575f,189.129918f,194.090580f,199.083145f,204.107210f,209.162385f,214.248292f,219.364564f,224.510845f,229.686789f,234.892058f,240.126328f,245.389280f,250.680604f,256.000000f,261.347174f,266.721841f,272.123723f,277.552547f,283.008049f,288.489971f,293.998060f,299.532071f,305.091761f,310.676898f,316.287249f,321.922592f,327.582707f,333.267377f,338.976394f,344.709550f,350.466646f,356.247482f,362.051866f,367.879608f,373.730522f,379.604427f,385.501143f,391.420496f,397.362314f,403.326427f,409.312672f,415.320884f,421.350905f,427.402579f,433.475750f,439.570269f,445.685987f,451.822757f,457.980436f,464.158883f,470.357960f,476.577530f,482.817459f,489.077615f,495.357868f,501.658090f,507.978156f,514.317941f,520.677324f,527.056184f,533.454404f,539.871867f,546.308458f,552.764065f,559.238575f,565.731879f,572.243870f,578.774440f,585.323483f,591.890898f,598.476581f,605.080431f,611.702349f,618.342238f,625.000000f,631.675540f,638.368763f,645.079578f
+static const mp3d_real_t g_pow43[129 + 16] = {
+	MP3D_P43(0),MP3D_P43(-1),MP3D_P43(-2.519842f),MP3D_P43(-4.326749f),MP3D_P43(-6.349604f),MP3D_P43(-8.549880f),MP3D_P43(-10.902724f),MP3D_P43(-13.390518f),MP3D_P43(-16.000000f),MP3D_P43(-18.720754f),MP3D_P43(-21.544347f),MP3D_P43(-24.463781f),MP3D_P43(-27.473142f),MP3D_P43(-30.567351f),MP3D_P43(-33.741992f),MP3D_P43(-36.993181f),
+	MP3D_P43(0),MP3D_P43(1),MP3D_P43(2.519842f),MP3D_P43(4.326749f),MP3D_P43(6.349604f),MP3D_P43(8.549880f),MP3D_P43(10.902724f),MP3D_P43(13.390518f),MP3D_P43(16.000000f),MP3D_P43(18.720754f),MP3D_P43(21.544347f),MP3D_P43(24.463781f),MP3D_P43(27.473142f),MP3D_P43(30.567351f),MP3D_P43(33.741992f),MP3D_P43(36.993181f),MP3D_P43(40.317474f),MP3D_P43(43.711787f),MP3D_P43(47.173345f),MP3D_P43(50.699631f),MP3D_P43(54.288352f),MP3D_P43(57.937408f),MP3D_P43(61.644865f),MP3D_P43(65.408941f),MP3D_P43(69.227979f),MP3D_P43(73.100443f),MP3D_P43(77.024898f),MP3D_P43(81.000000f),MP3D_P43(85.024491f),MP3D_P43(89.097188f),MP3D_P43(93.216975f),MP3D_P43(97.382800f),MP3D_P43(101.593667f),MP3D_P43(105.848633f),MP3D_P43(110.146801f),MP3D_P43(114.487321f),MP3D_P43(118.869381f),MP3D_P43(123.292209f),MP3D_P43(127.755065f),MP3D_P43(132.257246f),MP3D_P43(136.798076f),MP3D_P43(141.376907f),MP3D_P43(145.993119f),MP3D_P43(150.646117f),MP3D_P43(155.335327f),MP3D_P43(160.060199f),MP3D_P43(164.820202f),MP3D_P43(169.614826f),MP3D_P43(174.443577f),MP3D_P43(179.305980f),MP3D_P43(184.201575f),MP3D_P43(189.129918f),MP3D_P43(194.090580f),MP3D_P43(199.083145f),MP3D_P43(204.107210f),MP3D_P43(209.162385f),MP3D_P43(214.248292f),MP3D_P43(219.364564f),MP3D_P43(224.510845f),MP3D_P43(229.686789f),MP3D_P43(234.892058f),MP3D_P43(240.126328f),MP3D_P43(245.389280f),MP3D_P43(250.680604f),MP3D_P43(256.000000f),MP3D_P43(261.347174f),MP3D_P43(266.721841f),MP3D_P43(272.123723f),MP3D_P43(277.552547f),MP3D_P43(283.008049f),MP3D_P43(288.489971f),MP3D_P43(293.998060f),MP3D_P43(299.532071f),MP3D_P43(305.091761f),MP3D_P43(310.676898f),MP3D_P43(316.287249f),MP3D_P43(321.922592f),MP3D_P43(327.582707f),MP3D_P43(333.267377f),MP3D_P43(338.976394f),MP3D_P43(344.709550f),MP3D_P43(350.466646f),MP3D_P43(356.247482f),MP3D_P43(362.051866f),MP3D_P43(367.879608f),MP3D_P43(373.730522f),MP3D_P43(379.604427f),MP3D_P43(385.501143f),MP3D_P43(391.420496f),MP3D_P43(397.362314f),MP3D_P43(403.326427f),MP3D_P43(409.312672f),MP3D_P43(415.320884f),MP3D_P43(421.350905f),MP3D_P43(427.402579f),MP3D_P43(433.475750f),MP3D_P43(439.570269f),MP3D_P43(445.685987f),MP3D_P43(451.822757f),MP3D_P43(457.980436f),MP3D_P43(464.158883f),MP3D_P43(470.357960f),MP3D_P43(476.577530f),MP3D_P43(482.817459f),MP3D_P43(489.077615f),MP3D_P43(495.357868f),MP3D_P43(501.658090f),MP3D_P43(507.978156f),MP3D_P43(514.317941f),MP3D_P43(520.677324f),MP3D_P43(527.056184f),MP3D_P43(533.454404f),MP3D_P43(539.871867f),MP3D_P43(546.308458f),MP3D_P43(552.764065f),MP3D_P43(559.238575f),MP3D_P43(565.731879f),MP3D_P43(572.243870f),MP3D_P43(578.774440f),MP3D_P43(585.323483f),MP3D_P43(591.890898f),MP3D_P43(598.476581f),MP3D_P43(605.080431f),MP3D_P43(611.702349f),MP3D_P43(618.342238f),MP3D_P43(625.000000f),MP3D_P43(631.675540f),MP3D_P43(638.368763f),MP3D_P43(645.079578f)
 };
 
+/* pow43(x)/16 for 129 <= x < 1024, which is where linbits values mostly land at high bitrates */
+static const mp3d_real_t g_pow43_ext[1024 - 129] = {
+	MP3D_P43(40.737993f),MP3D_P43(41.159601f),MP3D_P43(41.582291f),MP3D_P43(42.006058f),MP3D_P43(42.430896f),MP3D_P43(42.856801f),MP3D_P43(43.283766f),MP3D_P43(43.711787f),MP3D_P43(44.140858f),MP3D_P43(44.570975f),MP3D_P43(45.002131f),MP3D_P43(45.434323f),
+	MP3D_P43(45.867546f),MP3D_P43(46.301793f),MP3D_P43(46.737061f),MP3D_P43(47.173345f),MP3D_P43(47.610640f),MP3D_P43(48.048942f),MP3D_P43(48.488245f),MP3D_P43(48.928545f),MP3D_P43(49.369839f),MP3D_P43(49.812120f),MP3D_P43(50.255386f),MP3D_P43(50.699631f),
+	MP3D_P43(51.144852f),MP3D_P43(51.591043f),MP3D_P43(52.038202f),MP3D_P43(52.486323f),MP3D_P43(52.935403f),MP3D_P43(53.385437f),MP3D_P43(53.836421f),MP3D_P43(54.288352f),MP3D_P43(54.741226f),MP3D_P43(55.195038f),MP3D_P43(55.649785f),MP3D_P43(56.105463f),
+	MP3D_P43(56.562068f),MP3D_P43(57.019596f),MP3D_P43(57.478044f),MP3D_P43(57.937408f),MP3D_P43(58.397684f),MP3D_P43(58.858869f),MP3D_P43(59.320959f),MP3D_P43(59.783951f),MP3D_P43(60.247841f),MP3D_P43(60.712626f),MP3D_P43(61.178302f),MP3D_P43(61.644865f),
+	MP3D_P43(62.112314f),MP3D_P43(62.580643f),MP3D_P43(63.049850f),MP3D_P43(63.519932f),MP3D_P43(63.990885f),MP3D_P43(64.462706f),MP3D_P43(64.935393f),MP3D_P43(65.408941f),MP3D_P43(65.883347f),MP3D_P43(66.358609f),MP3D_P43(66.834724f),MP3D_P43(67.311688f),
+	MP3D_P43(67.789499f),MP3D_P43(68.268153f),MP3D_P43(68.747647f),MP3D_P43(69.227979f),MP3D_P43(69.709146f),MP3D_P43(70.191145f),MP3D_P43(70.673972f),MP3D_P43(71.157625f),MP3D_P43(71.642102f),MP3D_P43(72.127399f),MP3D_P43(72.613514f),MP3D_P43(73.100443f),
+	MP3D_P43(73.588185f),MP3D_P43(74.076737f),MP3D_P43(74.566095f),MP3D_P43(75.056258f),MP3D_P43(75.547222f),MP3D_P43(76.038985f),MP3D_P43(76.531544f),MP3D_P43(77.024898f),MP3D_P43(77.519042f),MP3D_P43(78.013976f),MP3D_P43(78.509695f),MP3D_P43(79.006198f),
+	MP3D_P43(79.503483f),MP3D_P43(80.001546f),MP3D_P43(80.500386f),MP3D_P43(81.000000f),MP3D_P43(81.500385f),MP3D_P43(82.001540f),MP3D_P43(82.503462f),MP3D_P43(83.006148f),MP3D_P43(83.509596f),MP3D_P43(84.013804f),MP3D_P43(84.518770f),MP3D_P43(85.024491f),
+	MP3D_P43(85.530966f),MP3D_P43(86.038191f),MP3D_P43(86.546165f),MP3D_P43(87.054885f),MP3D_P43(87.564350f),MP3D_P43(88.074557f),MP3D_P43(88.585503f),MP3D_P43(89.097188f),MP3D_P43(89.609608f),MP3D_P43(90.122762f),MP3D_P43(90.636648f),MP3D_P43(91.151262f),
+	MP3D_P43(91.666605f),MP3D_P43(92.182672f),MP3D_P43(92.699463f),MP3D_P43(93.216975f),MP3D_P43(93.735207f),MP3D_P43(94.254155f),MP3D_P43(94.773819f),MP3D_P43(95.294196f),MP3D_P43(95.815285f),MP3D_P43(96.337083f),MP3D_P43(96.859589f),MP3D_P43(97.382800f),
+	MP3D_P43(97.906715f),MP3D_P43(98.431332f),MP3D_P43(98.956649f),MP3D_P43(99.482664f),MP3D_P43(100.009375f),MP3D_P43(100.536780f),MP3D_P43(101.064878f),MP3D_P43(101.593667f),MP3D_P43(102.123145f),MP3D_P43(102.653310f),MP3D_P43(103.184161f),MP3D_P43(103.715695f),
+	MP3D_P43(104.247911f),MP3D_P43(104.780807f),MP3D_P43(105.314382f),MP3D_P43(105.848633f),MP3D_P43(106.383559f),MP3D_P43(106.919159f),MP3D_P43(107.455430f),MP3D_P43(107.992371f),MP3D_P43(108.529980f),MP3D_P43(109.068256f),MP3D_P43(109.607197f),MP3D_P43(110.146801f),
+	MP3D_P43(110.687067f),MP3D_P43(111.227993f),MP3D_P43(111.769577f),MP3D_P43(112.311819f),MP3D_P43(112.854715f),MP3D_P43(113.398266f),MP3D_P43(113.942468f),MP3D_P43(114.487321f),MP3D_P43(115.032823f),MP3D_P43(115.578972f),MP3D_P43(116.125768f),MP3D_P43(116.673208f),
+	MP3D_P43(117.221290f),MP3D_P43(117.770014f),MP3D_P43(118.319378f),MP3D_P43(118.869381f),MP3D_P43(119.420020f),MP3D_P43(119.971295f),MP3D_P43(120.523204f),MP3D_P43(121.075746f),MP3D_P43(121.628918f),MP3D_P43(122.182721f),MP3D_P43(122.737151f),MP3D_P43(123.292209f),
+	MP3D_P43(123.847891f),MP3D_P43(124.404198f),MP3D_P43(124.961128f),MP3D_P43(125.518678f),MP3D_P43(126.076849f),MP3D_P43(126.635638f),MP3D_P43(127.195044f),MP3D_P43(127.755065f),MP3D_P43(128.315702f),MP3D_P43(128.876951f),MP3D_P43(129.438812f),MP3D_P43(130.001283f),
+	MP3D_P43(130.564364f),MP3D_P43(131.128052f),MP3D_P43(131.692347f),MP3D_P43(132.257246f),MP3D_P43(132.822750f),MP3D_P43(133.388856f),MP3D_P43(133.955564f),MP3D_P43(134.522871f),MP3D_P43(135.090777f),MP3D_P43(135.659281f),MP3D_P43(136.228381f),MP3D_P43(136.798076f),
+	MP3D_P43(137.368364f),MP3D_P43(137.939246f),MP3D_P43(138.510718f),MP3D_P43(139.082780f),MP3D_P43(139.655432f),MP3D_P43(140.228671f),MP3D_P43(140.802496f),MP3D_P43(141.376907f),MP3D_P43(141.951902f),MP3D_P43(142.527479f),MP3D_P43(143.103638f),MP3D_P43(143.680378f),
+	MP3D_P43(144.257697f),MP3D_P43(144.835595f),MP3D_P43(145.414069f),MP3D_P43(145.993119f),MP3D_P43(146.572744f),MP3D_P43(147.152943f),MP3D_P43(147.733714f),MP3D_P43(148.315056f),MP3D_P43(148.896969f),MP3D_P43(149.479450f),MP3D_P43(150.062500f),MP3D_P43(150.646117f),
+	MP3D_P43(151.230299f),MP3D_P43(151.815046f),MP3D_P43(152.400357f),MP3D_P43(152.986230f),MP3D_P43(153.572665f),MP3D_P43(154.159660f),MP3D_P43(154.747214f),MP3D_P43(155.335327f),MP3D_P43(155.923997f),MP3D_P43(156.513223f),MP3D_P43(157.103004f),MP3D_P43(157.693339f),
+	MP3D_P43(158.284227f),MP3D_P43(158.875667f),MP3D_P43(159.467658f),MP3D_P43(160.060199f),MP3D_P43(160.653289f),MP3D_P43(161.246926f),MP3D_P43(161.841111f),MP3D_P43(162.435841f),MP3D_P43(163.031117f),MP3D_P43(163.626936f),MP3D_P43(164.223298f),MP3D_P43(164.820202f),
+	MP3D_P43(165.417647f),MP3D_P43(166.015632f),MP3D_P43(166.614156f),MP3D_P43(167.213218f),MP3D_P43(167.812816f),MP3D_P43(168.412951f),MP3D_P43(169.013622f),MP3D_P43(169.614826f),MP3D_P43(170.216563f),MP3D_P43(170.818833f),MP3D_P43(171.421634f),MP3D_P43(172.024966f),
+	MP3D_P43(172.628826f),MP3D_P43(173.233216f),MP3D_P43(173.838133f),MP3D_P43(174.443577f),MP3D_P43(175.049547f),MP3D_P43(175.656041f),MP3D_P43(176.263059f),MP3D_P43(176.870601f),MP3D_P43(177.478665f),MP3D_P43(178.087250f),MP3D_P43(178.696355f),MP3D_P43(179.305980f),
+	MP3D_P43(179.916123f),MP3D_P43(180.526784f),MP3D_P43(181.137962f),MP3D_P43(181.749656f),MP3D_P43(182.361866f),MP3D_P43(182.974589f),MP3D_P43(183.587826f),MP3D_P43(184.201575f),MP3D_P43(184.815836f),MP3D_P43(185.430608f),MP3D_P43(186.045889f),MP3D_P43(186.661680f),
+	MP3D_P43(187.277979f),MP3D_P43(187.894786f),MP3D_P43(188.512099f),MP3D_P43(189.129918f),MP3D_P43(189.748242f),MP3D_P43(190.367070f),MP3D_P43(190.986402f),MP3D_P43(191.606236f),MP3D_P43(192.226571f),MP3D_P43(192.847408f),MP3D_P43(193.468744f),MP3D_P43(194.090580f),
+	MP3D_P43(194.712914f),MP3D_P43(195.335746f),MP3D_P43(195.959075f),MP3D_P43(196.582900f),MP3D_P43(197.207220f),MP3D_P43(197.832035f),MP3D_P43(198.457344f),MP3D_P43(199.083145f),MP3D_P43(199.709439f),MP3D_P43(200.336224f),MP3D_P43(200.963499f),MP3D_P43(201.591265f),
+	MP3D_P43(202.219519f),MP3D_P43(202.848262f),MP3D_P43(203.477493f),MP3D_P43(204.107210f),MP3D_P43(204.737414f),MP3D_P43(205.368102f),MP3D_P43(205.999276f),MP3D_P43(206.630933f),MP3D_P43(207.263073f),MP3D_P43(207.895696f),MP3D_P43(208.528800f),MP3D_P43(209.162385f),
+	MP3D_P43(209.796451f),MP3D_P43(210.430996f),MP3D_P43(211.066019f),MP3D_P43(211.701521f),MP3D_P43(212.337499f),MP3D_P43(212.973955f),MP3D_P43(213.610886f),MP3D_P43(214.248292f),MP3D_P43(214.886173f),MP3D_P43(215.524528f),MP3D_P43(216.163355f),MP3D_P43(216.802655f),
+	MP3D_P43(217.442427f),MP3D_P43(218.082669f),MP3D_P43(218.723382f),MP3D_P43(219.364564f),MP3D_P43(220.006216f),MP3D_P43(220.648335f),MP3D_P43(221.290922f),MP3D_P43(221.933976f),MP3D_P43(222.577495f),MP3D_P43(223.221481f),MP3D_P43(223.865931f),MP3D_P43(224.510845f),
+	MP3D_P43(225.156223f),MP3D_P43(225.802063f),MP3D_P43(226.448366f),MP3D_P43(227.095130f),MP3D_P43(227.742355f),MP3D_P43(228.390040f),MP3D_P43(229.038185f),MP3D_P43(229.686789f),MP3D_P43(230.335850f),MP3D_P43(230.985370f),MP3D_P43(231.635346f),MP3D_P43(232.285778f),
+	MP3D_P43(232.936666f),MP3D_P43(233.588010f),MP3D_P43(234.239807f),MP3D_P43(234.892058f),MP3D_P43(235.544763f),MP3D_P43(236.197920f),MP3D_P43(236.851528f),MP3D_P43(237.505588f),MP3D_P43(238.160099f),MP3D_P43(238.815060f),MP3D_P43(239.470469f),MP3D_P43(240.126328f),
+	MP3D_P43(240.782635f),MP3D_P43(241.439389f),MP3D_P43(242.096591f),MP3D_P43(242.754238f),MP3D_P43(243.412332f),MP3D_P43(244.070870f),MP3D_P43(244.729853f),MP3D_P43(245.389280f),MP3D_P43(246.049150f),MP3D_P43(246.709463f),MP3D_P43(247.370218f),MP3D_P43(248.031414f),
+	MP3D_P43(248.693052f),MP3D_P43(249.355130f),MP3D_P43(250.017647f),MP3D_P43(250.680604f),MP3D_P43(251.344000f),MP3D_P43(252.007833f),MP3D_P43(252.672104f),MP3D_P43(253.336812f),MP3D_P43(254.001956f),MP3D_P43(254.667535f),MP3D_P43(255.333550f),MP3D_P43(256.000000f),
+	MP3D_P43(256.666884f),MP3D_P43(257.334201f),MP3D_P43(258.001951f),MP3D_P43(258.670133f),MP3D_P43(259.338747f),MP3D_P43(260.007792f),MP3D_P43(260.677268f),MP3D_P43(261.347174f),MP3D_P43(262.017510f),MP3D_P43(262.688275f),MP3D_P43(263.359468f),MP3D_P43(264.031089f),
+	MP3D_P43(264.703137f),MP3D_P43(265.375613f),MP3D_P43(266.048514f),MP3D_P43(266.721841f),MP3D_P43(267.395594f),MP3D_P43(268.069771f),MP3D_P43(268.744372f),MP3D_P43(269.419397f),MP3D_P43(270.094845f),MP3D_P43(270.770716f),MP3D_P43(271.447009f),MP3D_P43(272.123723f),
+	MP3D_P43(272.800858f),MP3D_P43(273.478413f),MP3D_P43(274.156389f),MP3D_P43(274.834784f),MP3D_P43(275.513597f),MP3D_P43(276.192830f),MP3D_P43(276.872480f),MP3D_P43(277.552547f),MP3D_P43(278.233031f),MP3D_P43(278.913932f),MP3D_P43(279.595248f),MP3D_P43(280.276980f),
+	MP3D_P43(280.959126f),MP3D_P43(281.641687f),MP3D_P43(282.324661f),MP3D_P43(283.008049f),MP3D_P43(283.691850f),MP3D_P43(284.376063f),MP3D_P43(285.060687f),MP3D_P43(285.745724f),MP3D_P43(286.431170f),MP3D_P43(287.117028f),MP3D_P43(287.803295f),MP3D_P43(288.489971f),
+	MP3D_P43(289.177056f),MP3D_P43(289.864550f),MP3D_P43(290.552451f),MP3D_P43(291.240760f),MP3D_P43(291.929476f),MP3D_P43(292.618598f),MP3D_P43(293.308127f),MP3D_P43(293.998060f),MP3D_P43(294.688399f),MP3D_P43(295.379142f),MP3D_P43(296.070289f),MP3D_P43(296.761840f),
+	MP3D_P43(297.453794f),MP3D_P43(298.146151f),MP3D_P43(298.838910f),MP3D_P43(299.532071f),MP3D_P43(300.225632f),MP3D_P43(300.919595f),MP3D_P43(301.613958f),MP3D_P43(302.308721f),MP3D_P43(303.003883f),MP3D_P43(303.699444f),MP3D_P43(304.395404f),MP3D_P43(305.091761f),
+	MP3D_P43(305.788517f),MP3D_P43(306.485669f),MP3D_P43(307.183218f),MP3D_P43(307.881163f),MP3D_P43(308.579504f),MP3D_P43(309.278241f),MP3D_P43(309.977372f),MP3D_P43(310.676898f),MP3D_P43(311.376817f),MP3D_P43(312.077130f),MP3D_P43(312.777837f),MP3D_P43(313.478936f),
+	MP3D_P43(314.180427f),MP3D_P43(314.882310f),MP3D_P43(315.584584f),MP3D_P43(316.287249f),MP3D_P43(316.990305f),MP3D_P43(317.693751f),MP3D_P43(318.397586f),MP3D_P43(319.101811f),MP3D_P43(319.806424f),MP3D_P43(320.511426f),MP3D_P43(321.216815f),MP3D_P43(321.922592f),
+	MP3D_P43(322.628756f),MP3D_P43(323.335307f),MP3D_P43(324.042244f),MP3D_P43(324.749567f),MP3D_P43(325.457275f),MP3D_P43(326.165368f),MP3D_P43(326.873845f),MP3D_P43(327.582707f),MP3D_P43(328.291952f),MP3D_P43(329.001580f),MP3D_P43(329.711592f),MP3D_P43(330.421986f),
+	MP3D_P43(331.132761f),MP3D_P43(331.843919f),MP3D_P43(332.555458f),MP3D_P43(333.267377f),MP3D_P43(333.979677f),MP3D_P43(334.692357f),MP3D_P43(335.405416f),MP3D_P43(336.118855f),MP3D_P43(336.832673f),MP3D_P43(337.546868f),MP3D_P43(338.261442f),MP3D_P43(338.976394f),
+	MP3D_P43(339.691722f),MP3D_P43(340.407428f),MP3D_P43(341.123509f),MP3D_P43(341.839967f),MP3D_P43(342.556801f),MP3D_P43(343.274009f),MP3D_P43(343.991593f),MP3D_P43(344.709550f),MP3D_P43(345.427882f),MP3D_P43(346.146588f),MP3D_P43(346.865666f),MP3D_P43(347.585118f),
+	MP3D_P43(348.304942f),MP3D_P43(349.025138f),MP3D_P43(349.745706f),MP3D_P43(350.466646f),MP3D_P43(351.187956f),MP3D_P43(351.909637f),MP3D_P43(352.631687f),MP3D_P43(353.354108f),MP3D_P43(354.076898f),MP3D_P43(354.800058f),MP3D_P43(355.523586f),MP3D_P43(356.247482f),
+	MP3D_P43(356.971746f),MP3D_P43(357.696378f),MP3D_P43(358.421377f),MP3D_P43(359.146742f),MP3D_P43(359.872474f),MP3D_P43(360.598573f),MP3D_P43(361.325036f),MP3D_P43(362.051866f),MP3D_P43(362.779060f),MP3D_P43(363.506619f),MP3D_P43(364.234542f),MP3D_P43(364.962829f),
+	MP3D_P43(365.691479f),MP3D_P43(366.420493f),MP3D_P43(367.149869f),MP3D_P43(367.879608f),MP3D_P43(368.609709f),MP3D_P43(369.340171f),MP3D_P43(370.070995f),MP3D_P43(370.802180f),MP3D_P43(371.533725f),MP3D_P43(372.265631f),MP3D_P43(372.997897f),MP3D_P43(373.730522f),
+	MP3D_P43(374.463507f),MP3D_P43(375.196850f),MP3D_P43(375.930552f),MP3D_P43(376.664612f),MP3D_P43(377.399030f),MP3D_P43(378.133805f),MP3D_P43(378.868938f),MP3D_P43(379.604427f),MP3D_P43(380.340272f),MP3D_P43(381.076474f),MP3D_P43(381.813032f),MP3D_P43(382.549944f),
+	MP3D_P43(383.287212f),MP3D_P43(384.024835f),MP3D_P43(384.762812f),MP3D_P43(385.501143f),MP3D_P43(386.239828f),MP3D_P43(386.978866f),MP3D_P43(387.718257f),MP3D_P43(388.458001f),MP3D_P43(389.198097f),MP3D_P43(389.938545f),MP3D_P43(390.679345f),MP3D_P43(391.420496f),
+	MP3D_P43(392.161998f),MP3D_P43(392.903851f),MP3D_P43(393.646054f),MP3D_P43(394.388607f),MP3D_P43(395.131510f),MP3D_P43(395.874762f),MP3D_P43(396.618364f),MP3D_P43(397.362314f),MP3D_P43(398.106612f),MP3D_P43(398.851258f),MP3D_P43(399.596252f),MP3D_P43(400.341594f),
+	MP3D_P43(401.087282f),MP3D_P43(401.833318f),MP3D_P43(402.579699f),MP3D_P43(403.326427f),MP3D_P43(404.073501f),MP3D_P43(404.820920f),MP3D_P43(405.568684f),MP3D_P43(406.316793f),MP3D_P43(407.065247f),MP3D_P43(407.814045f),MP3D_P43(408.563186f),MP3D_P43(409.312672f),
+	MP3D_P43(410.062500f),MP3D_P43(410.812671f),MP3D_P43(411.563185f),MP3D_P43(412.314042f),MP3D_P43(413.065240f),MP3D_P43(413.816780f),MP3D_P43(414.568662f),MP3D_P43(415.320884f),MP3D_P43(416.073447f),MP3D_P43(416.826351f),MP3D_P43(417.579595f),MP3D_P43(418.333178f),
+	MP3D_P43(419.087102f),MP3D_P43(419.841364f),MP3D_P43(420.595965f),MP3D_P43(421.350905f),MP3D_P43(422.106184f),MP3D_P43(422.861800f),MP3D_P43(423.617754f),MP3D_P43(424.374045f),MP3D_P43(425.130674f),MP3D_P43(425.887639f),MP3D_P43(426.644941f),MP3D_P43(427.402579f),
+	MP3D_P43(428.160553f),MP3D_P43(428.918862f),MP3D_P43(429.677507f),MP3D_P43(430.436487f),MP3D_P43(431.195801f),MP3D_P43(431.955450f),MP3D_P43(432.715433f),MP3D_P43(433.475750f),MP3D_P43(434.236401f),MP3D_P43(434.997385f),MP3D_P43(435.758701f),MP3D_P43(436.520351f),
+	MP3D_P43(437.282332f),MP3D_P43(438.044646f),MP3D_P43(438.807292f),MP3D_P43(439.570269f),MP3D_P43(440.333578f),MP3D_P43(441.097217f),MP3D_P43(441.861187f),MP3D_P43(442.625487f),MP3D_P43(443.390118f),MP3D_P43(444.155078f),MP3D_P43(444.920368f),MP3D_P43(445.685987f),
+	MP3D_P43(446.451934f),MP3D_P43(447.218211f),MP3D_P43(447.984816f),MP3D_P43(448.751749f),MP3D_P43(449.519010f),MP3D_P43(450.286598f),MP3D_P43(451.054514f),MP3D_P43(451.822757f),MP3D_P43(452.591326f),MP3D_P43(453.360222f),MP3D_P43(454.129444f),MP3D_P43(454.898991f),
+	MP3D_P43(455.668865f),MP3D_P43(456.439064f),MP3D_P43(457.209587f),MP3D_P43(457.980436f),MP3D_P43(458.751609f),MP3D_P43(459.523106f),MP3D_P43(460.294927f),MP3D_P43(461.067072f),MP3D_P43(461.839541f),MP3D_P43(462.612332f),MP3D_P43(463.385446f),MP3D_P43(464.158883f),
+	MP3D_P43(464.932643f),MP3D_P43(465.706724f),MP3D_P43(466.481127f),MP3D_P43(467.255852f),MP3D_P43(468.030898f),MP3D_P43(468.806265f),MP3D_P43(469.581952f),MP3D_P43(470.357960f),MP3D_P43(471.134289f),MP3D_P43(471.910937f),MP3D_P43(472.687905f),MP3D_P43(473.465192f),
+	MP3D_P43(474.242799f),MP3D_P43(475.020724f),MP3D_P43(475.798968f),MP3D_P43(476.577530f),MP3D_P43(477.356411f),MP3D_P43(478.135609f),MP3D_P43(478.915125f),MP3D_P43(479.694958f),MP3D_P43(480.475108f),MP3D_P43(481.255576f),MP3D_P43(482.036359f),MP3D_P43(482.817459f),
+	MP3D_P43(483.598875f),MP3D_P43(484.380607f),MP3D_P43(485.162654f),MP3D_P43(485.945017f),MP3D_P43(486.727695f),MP3D_P43(487.510687f),MP3D_P43(488.293994f),MP3D_P43(489.077615f),MP3D_P43(489.861550f),MP3D_P43(490.645799f),MP3D_P43(491.430362f),MP3D_P43(492.215237f),
+	MP3D_P43(493.000426f),MP3D_P43(493.785928f),MP3D_P43(494.571742f),MP3D_P43(495.357868f),MP3D_P43(496.144306f),MP3D_P43(496.931056f),MP3D_P43(497.718118f),MP3D_P43(498.505491f),MP3D_P43(499.293175f),MP3D_P43(500.081169f),MP3D_P43(500.869475f),MP3D_P43(501.658090f),
+	MP3D_P43(502.447016f),MP3D_P43(503.236251f),MP3D_P43(504.025796f),MP3D_P43(504.815650f),MP3D_P43(505.605814f),MP3D_P43(506.396286f),MP3D_P43(507.187067f),MP3D_P43(507.978156f),MP3D_P43(508.769553f),MP3D_P43(509.561258f),MP3D_P43(510.353271f),MP3D_P43(511.145591f),
+	MP3D_P43(511.938218f),MP3D_P43(512.731153f),MP3D_P43(513.524393f),MP3D_P43(514.317941f),MP3D_P43(515.111794f),MP3D_P43(515.905954f),MP3D_P43(516.700419f),MP3D_P43(517.495190f),MP3D_P43(518.290266f),MP3D_P43(519.085647f),MP3D_P43(519.881333f),MP3D_P43(520.677324f),
+	MP3D_P43(521.473619f),MP3D_P43(522.270217f),MP3D_P43(523.067120f),MP3D_P43(523.864327f),MP3D_P43(524.661837f),MP3D_P43(525.459650f),MP3D_P43(526.257766f),MP3D_P43(527.056184f),MP3D_P43(527.854905f),MP3D_P43(528.653929f),MP3D_P43(529.453254f),MP3D_P43(530.252882f),
+	MP3D_P43(531.052811f),MP3D_P43(531.853041f),MP3D_P43(532.653572f),MP3D_P43(533.454404f),MP3D_P43(534.255537f),MP3D_P43(535.056970f),MP3D_P43(535.858704f),MP3D_P43(536.660738f),MP3D_P43(537.463071f),MP3D_P43(538.265704f),MP3D_P43(539.068636f),MP3D_P43(539.871867f),
+	MP3D_P43(540.675397f),MP3D_P43(541.479226f),MP3D_P43(542.283353f),MP3D_P43(543.087779f),MP3D_P43(543.892502f),MP3D_P43(544.697524f),MP3D_P43(545.502842f),MP3D_P43(546.308458f),MP3D_P43(547.114372f),MP3D_P43(547.920582f),MP3D_P43(548.727088f),MP3D_P43(549.533892f),
+	MP3D_P43(550.340991f),MP3D_P43(551.148387f),MP3D_P43(551.956078f),MP3D_P43(552.764065f),MP3D_P43(553.572347f),MP3D_P43(554.380924f),MP3D_P43(555.189797f),MP3D_P43(555.998964f),MP3D_P43(556.808425f),MP3D_P43(557.618181f),MP3D_P43(558.428231f),MP3D_P43(559.238575f),
+	MP3D_P43(560.049213f),MP3D_P43(560.860143f),MP3D_P43(561.671368f),MP3D_P43(562.482885f),MP3D_P43(563.294695f),MP3D_P43(564.106797f),MP3D_P43(564.919192f),MP3D_P43(565.731879f),MP3D_P43(566.544859f),MP3D_P43(567.358129f),MP3D_P43(568.171692f),MP3D_P43(568.985546f),
+	MP3D_P43(569.799690f),MP3D_P43(570.614126f),MP3D_P43(571.428853f),MP3D_P43(572.243870f),MP3D_P43(573.059177f),MP3D_P43(573.874775f),MP3D_P43(574.690662f),MP3D_P43(575.506839f),MP3D_P43(576.323305f),MP3D_P43(577.140061f),MP3D_P43(577.957106f),MP3D_P43(578.774440f),
+	MP3D_P43(579.592062f),MP3D_P43(580.409973f),MP3D_P43(581.228172f),MP3D_P43(582.046659f),MP3D_P43(582.865434f),MP3D_P43(583.684496f),MP3D_P43(584.503846f),MP3D_P43(585.323483f),MP3D_P43(586.143408f),MP3D_P43(586.963619f),MP3D_P43(587.784117f),MP3D_P43(588.604901f),
+	MP3D_P43(589.425971f),MP3D_P43(590.247328f),MP3D_P43(591.068970f),MP3D_P43(591.890898f),MP3D_P43(592.713111f),MP3D_P43(593.535610f),MP3D_P43(594.358394f),MP3D_P43(595.181462f),MP3D_P43(596.004815f),MP3D_P43(596.828453f),MP3D_P43(597.652375f),MP3D_P43(598.476581f),
+	MP3D_P43(599.301070f),MP3D_P43(600.125844f),MP3D_P43(600.950901f),MP3D_P43(601.776241f),MP3D_P43(602.601864f),MP3D_P43(603.427771f),MP3D_P43(604.253960f),MP3D_P43(605.080431f),MP3D_P43(605.907185f),MP3D_P43(606.734221f),MP3D_P43(607.561538f),MP3D_P43(608.389138f),
+	MP3D_P43(609.217019f),MP3D_P43(610.045181f),MP3D_P43(610.873625f),MP3D_P43(611.702349f),MP3D_P43(612.531355f),MP3D_P43(613.360641f),MP3D_P43(614.190207f),MP3D_P43(615.020054f),MP3D_P43(615.850180f),MP3D_P43(616.680587f),MP3D_P43(617.511273f),MP3D_P43(618.342238f),
+	MP3D_P43(619.173483f),MP3D_P43(620.005007f),MP3D_P43(620.836809f),MP3D_P43(621.668891f),MP3D_P43(622.501251f),MP3D_P43(623.333889f),MP3D_P43(624.166806f),MP3D_P43(625.000000f),MP3D_P43(625.833472f),MP3D_P43(626.667222f),MP3D_P43(627.501249f),MP3D_P43(628.335554f),
+	MP3D_P43(629.170135f),MP3D_P43(630.004993f),MP3D_P43(630.840128f),MP3D_P43(631.675540f),MP3D_P43(632.511228f),MP3D_P43(633.347191f),MP3D_P43(634.183431f),MP3D_P43(635.019947f),MP3D_P43(635.856738f),MP3D_P43(636.693805f),MP3D_P43(637.531146f),MP3D_P43(638.368763f),
+	MP3D_P43(639.206655f),MP3D_P43(640.044821f),MP3D_P43(640.883262f),MP3D_P43(641.721977f),MP3D_P43(642.560967f),MP3D_P43(643.400230f),MP3D_P43(644.239767f)
+};
+
+#ifdef MINIMP3_FIXED_POINT
+/* returns pow43(x) in Q21, divided by 2^*sh: past the table the values are too big for Q21 */
+static int32_t L3_pow_43(int x, int *sh)
+{
+	int32_t frac, poly;
+	int sign;
+
+	*sh = 0;
+	if (x < 129)
+	{
+		return g_pow43[16 + x];
+	}
+
+	*sh = 4;
+	if (x < 1024)
+	{
+		return g_pow43_ext[x - 129];
+	}
+
+	*sh = 8;
+	sign = 2*x & 64;
+	frac = ((x & 63) - sign)*(1 << 24) / ((x & ~63) + sign);  /* Q24, |frac| < 1/2 */
+	poly = (1 << 24) + (int32_t)(((int64_t)frac*(22369621 /* 4/3 */ + (int32_t)(((int64_t)frac*3728270 /* 2/9 */) >> 24))) >> 24);
+	return (int32_t)(((int64_t)g_pow43[16 + ((x + sign) >> 6)]*poly) >> 24);
+}
+#else /* MINIMP3_FIXED_POINT */
 static float L3_pow_43(int x)
 {
 	float frac;
-	int sign, mult = 256;
+	int sign;
 
 	if (x < 129)
 	{
@@ -739,44 +1011,187 @@ static float L3_pow_43(int x)
 
 	if (x < 1024)
 	{
-		mult = 16;
-		x <<= 3;
+		return g_pow43_ext[x - 129]*16;
 	}
 
 	sign = 2*x & 64;
 	frac = (float)((x & 63) - sign) / ((x & ~63) + sign);
-	return g_pow43[16 + ((x + sign) >> 6)]*(1.f + frac*((4.f/3) + frac*(2.f/9)))*mult;
-}
-
-static void L3_huffman(float *dst, bs_t *bs, const L3_gr_info_t *gr_info, const float *scf, int layer3gr_limit)
-{
-	static const int16_t tabs[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-	                                785,785,785,785,784,784,784,784,513,513,513,513,513,513,513,513,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,
-	                                -255,1313,1298,1282,785,785,785,785,784,784,784,784,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,290,288,
-	                                -255,1313,1298,1282,769,769,769,769,529,529,529,529,529,529,529,529,528,528,528,528,528,528,528,528,512,512,512,512,512,512,512,512,290,288,
-	                                -253,-318,-351,-367,785,785,785,785,784,784,784,784,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,819,818,547,547,275,275,275,275,561,560,515,546,289,274,288,258,
-	                                -254,-287,1329,1299,1314,1312,1057,1057,1042,1042,1026,1026,784,784,784,784,529,529,529,529,529,529,529,529,769,769,769,769,768,768,768,768,563,560,306,306,291,259,
-	                                -252,-413,-477,-542,1298,-575,1041,1041,784,784,784,784,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,-383,-399,1107,1092,1106,1061,849,849,789,789,1104,1091,773,773,1076,1075,341,340,325,309,834,804,577,577,532,532,516,516,832,818,803,816,561,561,531,531,515,546,289,289,288,258,
-	                                -252,-429,-493,-559,1057,1057,1042,1042,529,529,529,529,529,529,529,529,784,784,784,784,769,769,769,769,512,512,512,512,512,512,512,512,-382,1077,-415,1106,1061,1104,849,849,789,789,1091,1076,1029,1075,834,834,597,581,340,340,339,324,804,833,532,532,832,772,818,803,817,787,816,771,290,290,290,290,288,258,
-	                                -253,-349,-414,-447,-463,1329,1299,-479,1314,1312,1057,1057,1042,1042,1026,1026,785,785,785,785,784,784,784,784,769,769,769,769,768,768,768,768,-319,851,821,-335,836,850,805,849,341,340,325,336,533,533,579,579,564,564,773,832,578,548,563,516,321,276,306,291,304,259,
-	                                -251,-572,-733,-830,-863,-879,1041,1041,784,784,784,784,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,-511,-527,-543,1396,1351,1381,1366,1395,1335,1380,-559,1334,1138,1138,1063,1063,1350,1392,1031,1031,1062,1062,1364,1363,1120,1120,1333,1348,881,881,881,881,375,374,359,373,343,358,341,325,791,791,1123,1122,-703,1105,1045,-719,865,865,790,790,774,774,1104,1029,338,293,323,308,-799,-815,833,788,772,818,803,816,322,292,307,320,561,531,515,546,289,274,288,258,
-	                                -251,-525,-605,-685,-765,-831,-846,1298,1057,1057,1312,1282,785,785,785,785,784,784,784,784,769,769,769,769,512,512,512,512,512,512,512,512,1399,1398,1383,1367,1382,1396,1351,-511,1381,1366,1139,1139,1079,1079,1124,1124,1364,1349,1363,1333,882,882,882,882,807,807,807,807,1094,1094,1136,1136,373,341,535,535,881,775,867,822,774,-591,324,338,-671,849,550,550,866,864,609,609,293,336,534,534,789,835,773,-751,834,804,308,307,833,788,832,772,562,562,547,547,305,275,560,515,290,290,
-	                                -252,-397,-477,-557,-622,-653,-719,-735,-750,1329,1299,1314,1057,1057,1042,1042,1312,1282,1024,1024,785,785,785,785,784,784,784,784,769,769,769,769,-383,1127,1141,1111,1126,1140,1095,1110,869,869,883,883,1079,1109,882,882,375,374,807,868,838,881,791,-463,867,822,368,263,852,837,836,-543,610,610,550,550,352,336,534,534,865,774,851,821,850,805,593,533,579,564,773,832,578,578,548,548,577,577,307,276,306,291,516,560,259,259,
-	                                -250,-2107,-2507,-2764,-2909,-2974,-3007,-3023,1041,1041,1040,1040,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,-767,-1052,-1213,-1277,-1358,-1405,-1469,-1535,-1550,-1582,-1614,-1647,-1662,-1694,-1726,-1759,-1774,-1807,-1822,-1854,-1886,1565,-1919,-1935,-1951,-1967,1731,1730,1580,1717,-1983,1729,1564,-1999,1548,-2015,-2031,1715,1595,-2047,1714,-2063,1610,-2079,1609,-2095,1323,1323,1457,1457,1307,1307,1712,1547,1641,1700,1699,1594,1685,1625,1442,1442,1322,1322,-780,-973,-910,1279,1278,1277,1262,1276,1261,1275,1215,1260,1229,-959,974,974,989,989,-943,735,478,478,495,463,506,414,-1039,1003,958,1017,927,942,987,957,431,476,1272,1167,1228,-1183,1256,-1199,895,895,941,941,1242,1227,1212,1135,1014,1014,490,489,503,487,910,1013,985,925,863,894,970,955,1012,847,-1343,831,755,755,984,909,428,366,754,559,-1391,752,486,457,924,997,698,698,983,893,740,740,908,877,739,739,667,667,953,938,497,287,271,271,683,606,590,712,726,574,302,302,738,736,481,286,526,725,605,711,636,724,696,651,589,681,666,710,364,467,573,695,466,466,301,465,379,379,709,604,665,679,316,316,634,633,436,436,464,269,424,394,452,332,438,363,347,408,393,448,331,422,362,407,392,421,346,406,391,376,375,359,1441,1306,-2367,1290,-2383,1337,-2399,-2415,1426,1321,-2431,1411,1336,-2447,-2463,-2479,1169,1169,1049,1049,1424,1289,1412,1352,1319,-2495,1154,1154,1064,1064,1153,1153,416,390,360,404,403,389,344,374,373,343,358,372,327,357,342,311,356,326,1395,1394,1137,1137,1047,1047,1365,1392,1287,1379,1334,1364,1349,1378,1318,1363,792,792,792,792,1152,1152,1032,1032,1121,1121,1046,1046,1120,1120,1030,1030,-2895,1106,1061,1104,849,849,789,789,1091,1076,1029,1090,1060,1075,833,833,309,324,532,532,832,772,818,803,561,561,531,560,515,546,289,274,288,258,
-	                                -250,-1179,-1579,-1836,-1996,-2124,-2253,-2333,-2413,-2477,-2542,-2574,-2607,-2622,-2655,1314,1313,1298,1312,1282,785,785,785,785,1040,1040,1025,1025,768,768,768,768,-766,-798,-830,-862,-895,-911,-927,-943,-959,-975,-991,-1007,-1023,-1039,-1055,-1070,1724,1647,-1103,-1119,1631,1767,1662,1738,1708,1723,-1135,1780,1615,1779,1599,1677,1646,1778,1583,-1151,1777,1567,1737,1692,1765,1722,1707,1630,1751,1661,1764,1614,1736,1676,1763,1750,1645,1598,1721,1691,1762,1706,1582,1761,1566,-1167,1749,1629,767,766,751,765,494,494,735,764,719,749,734,763,447,447,748,718,477,506,431,491,446,476,461,505,415,430,475,445,504,399,460,489,414,503,383,474,429,459,502,502,746,752,488,398,501,473,413,472,486,271,480,270,-1439,-1455,1357,-1471,-1487,-1503,1341,1325,-1519,1489,1463,1403,1309,-1535,1372,1448,1418,1476,1356,1462,1387,-1551,1475,1340,1447,1402,1386,-1567,1068,1068,1474,1461,455,380,468,440,395,425,410,454,364,467,466,464,453,269,409,448,268,432,1371,1473,1432,1417,1308,1460,1355,1446,1459,1431,1083,1083,1401,1416,1458,1445,1067,1067,1370,1457,1051,1051,1291,1430,1385,1444,1354,1415,1400,1443,1082,1082,1173,1113,1186,1066,1185,1050,-1967,1158,1128,1172,1097,1171,1081,-1983,1157,1112,416,266,375,400,1170,1142,1127,1065,793,793,1169,1033,1156,1096,1141,1111,1155,1080,1126,1140,898,898,808,808,897,897,792,792,1095,1152,1032,1125,1110,1139,1079,1124,882,807,838,881,853,791,-2319,867,368,263,822,852,837,866,806,865,-2399,851,352,262,534,534,821,836,594,594,549,549,593,593,533,533,848,773,579,579,564,578,548,563,276,276,577,576,306,291,516,560,305,305,275,259,
-	                                -251,-892,-2058,-2620,-2828,-2957,-3023,-3039,1041,1041,1040,1040,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,-511,-527,-543,-559,1530,-575,-591,1528,1527,1407,1526,1391,1023,1023,1023,1023,1525,1375,1268,1268,1103,1103,1087,1087,1039,1039,1523,-604,815,815,815,815,510,495,509,479,508,463,507,447,431,505,415,399,-734,-782,1262,-815,1259,1244,-831,1258,1228,-847,-863,1196,-879,1253,987,987,748,-767,493,493,462,477,414,414,686,669,478,446,461,445,474,429,487,458,412,471,1266,1264,1009,1009,799,799,-1019,-1276,-1452,-1581,-1677,-1757,-1821,-1886,-1933,-1997,1257,1257,1483,1468,1512,1422,1497,1406,1467,1496,1421,1510,1134,1134,1225,1225,1466,1451,1374,1405,1252,1252,1358,1480,1164,1164,1251,1251,1238,1238,1389,1465,-1407,1054,1101,-1423,1207,-1439,830,830,1248,1038,1237,1117,1223,1148,1236,1208,411,426,395,410,379,269,1193,1222,1132,1235,1221,1116,976,976,1192,1162,1177,1220,1131,1191,963,963,-1647,961,780,-1663,558,558,994,993,437,408,393,407,829,978,813,797,947,-1743,721,721,377,392,844,950,828,890,706,706,812,859,796,960,948,843,934,874,571,571,-1919,690,555,689,421,346,539,539,944,779,918,873,932,842,903,888,570,570,931,917,674,674,-2575,1562,-2591,1609,-2607,1654,1322,1322,1441,1441,1696,1546,1683,1593,1669,1624,1426,1426,1321,1321,1639,1680,1425,1425,1305,1305,1545,1668,1608,1623,1667,1592,1638,1666,1320,1320,1652,1607,1409,1409,1304,1304,1288,1288,1664,1637,1395,1395,1335,1335,1622,1636,1394,1394,1319,1319,1606,1621,1392,1392,1137,1137,1137,1137,345,390,360,375,404,373,1047,-2751,-2767,-2783,1062,1121,1046,-2799,1077,-2815,1106,1061,789,789,1105,1104,263,355,310,340,325,354,352,262,339,324,1091,1076,1029,1090,1060,1075,833,833,788,788,1088,1028,818,818,803,803,561,561,531,531,816,771,546,546,289,274,288,258,
-	                                -253,-317,-381,-446,-478,-509,1279,1279,-811,-1179,-1451,-1756,-1900,-2028,-2189,-2253,-2333,-2414,-2445,-2511,-2526,1313,1298,-2559,1041,1041,1040,1040,1025,1025,1024,1024,1022,1007,1021,991,1020,975,1019,959,687,687,1018,1017,671,671,655,655,1016,1015,639,639,758,758,623,623,757,607,756,591,755,575,754,559,543,543,1009,783,-575,-621,-685,-749,496,-590,750,749,734,748,974,989,1003,958,988,973,1002,942,987,957,972,1001,926,986,941,971,956,1000,910,985,925,999,894,970,-1071,-1087,-1102,1390,-1135,1436,1509,1451,1374,-1151,1405,1358,1480,1420,-1167,1507,1494,1389,1342,1465,1435,1450,1326,1505,1310,1493,1373,1479,1404,1492,1464,1419,428,443,472,397,736,526,464,464,486,457,442,471,484,482,1357,1449,1434,1478,1388,1491,1341,1490,1325,1489,1463,1403,1309,1477,1372,1448,1418,1433,1476,1356,1462,1387,-1439,1475,1340,1447,1402,1474,1324,1461,1371,1473,269,448,1432,1417,1308,1460,-1711,1459,-1727,1441,1099,1099,1446,1386,1431,1401,-1743,1289,1083,1083,1160,1160,1458,1445,1067,1067,1370,1457,1307,1430,1129,1129,1098,1098,268,432,267,416,266,400,-1887,1144,1187,1082,1173,1113,1186,1066,1050,1158,1128,1143,1172,1097,1171,1081,420,391,1157,1112,1170,1142,1127,1065,1169,1049,1156,1096,1141,1111,1155,1080,1126,1154,1064,1153,1140,1095,1048,-2159,1125,1110,1137,-2175,823,823,1139,1138,807,807,384,264,368,263,868,838,853,791,867,822,852,837,866,806,865,790,-2319,851,821,836,352,262,850,805,849,-2399,533,533,835,820,336,261,578,548,563,577,532,532,832,772,562,562,547,547,305,275,560,515,290,290,288,258 };
-	static const uint8_t tab32[] = { 130,162,193,209,44,28,76,140,9,9,9,9,9,9,9,9,190,254,222,238,126,94,157,157,109,61,173,205 };
-	static const uint8_t tab33[] = { 252,236,220,204,188,172,156,140,124,108,92,76,60,44,28,12 };
-	static const int16_t tabindex[2*16] = { 0,32,64,98,0,132,180,218,292,364,426,538,648,746,0,1126,1460,1460,1460,1460,1460,1460,1460,1460,1842,1842,1842,1842,1842,1842,1842,1842 };
-	static const uint8_t g_linbits[] =  { 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,2,3,4,6,8,10,13,4,5,6,7,8,9,11,13 };
+	return g_pow43[16 + ((x + sign) >> 6)]*(1.f + frac*((4.f/3) + frac*(2.f/9)))*256;
+}
+#endif /* MINIMP3_FIXED_POINT */
+
+#ifdef MINIMP3_FIXED_POINT
+#define L3_DEQ(p43, one)            L3_deq(p43, one)
+#define L3_DEQ_ONE(neg, one)        L3_deq((neg) ? -(1 << MP3D_P43_BITS) : (1 << MP3D_P43_BITS), one)
+#else /* MINIMP3_FIXED_POINT */
+#define L3_DEQ(p43, one)            ((p43)*(one))
+#define L3_DEQ_ONE(neg, one)        ((neg) ? -(one) : (one))
+#endif /* MINIMP3_FIXED_POINT */
+
+static const int16_t g_huff_tabs[] = { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                       785,785,785,785,784,784,784,784,513,513,513,513,513,513,513,513,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,
+                                       -255,1313,1298,1282,785,785,785,785,784,784,784,784,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,290,288,
+                                       -255,1313,1298,1282,769,769,769,769,529,529,529,529,529,529,529,529,528,528,528,528,528,528,528,528,512,512,512,512,512,512,512,512,290,288,
+                                       -253,-318,-351,-367,785,785,785,785,784,784,784,784,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,819,818,547,547,275,275,275,275,561,560,515,546,289,274,288,258,
+                                       -254,-287,1329,1299,1314,1312,1057,1057,1042,1042,1026,1026,784,784,784,784,529,529,529,529,529,529,529,529,769,769,769,769,768,768,768,768,563,560,306,306,291,259,
+                                       -252,-413,-477,-542,1298,-575,1041,1041,784,784,784,784,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,-383,-399,1107,1092,1106,1061,849,849,789,789,1104,1091,773,773,1076,1075,341,340,325,309,834,804,577,577,532,532,516,516,832,818,803,816,561,561,531,531,515,546,289,289,288,258,
+                                       -252,-429,-493,-559,1057,1057,1042,1042,529,529,529,529,529,529,529,529,784,784,784,784,769,769,769,769,512,512,512,512,512,512,512,512,-382,1077,-415,1106,1061,1104,849,849,789,789,1091,1076,1029,1075,834,834,597,581,340,340,339,324,804,833,532,532,832,772,818,803,817,787,816,771,290,290,290,290,288,258,
+                                       -253,-349,-414,-447,-463,1329,1299,-479,1314,1312,1057,1057,1042,1042,1026,1026,785,785,785,785,784,784,784,784,769,769,769,769,768,768,768,768,-319,851,821,-335,836,850,805,849,341,340,325,336,533,533,579,579,564,564,773,832,578,548,563,516,321,276,306,291,304,259,
+                                       -251,-572,-733,-830,-863,-879,1041,1041,784,784,784,784,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,-511,-527,-543,1396,1351,1381,1366,1395,1335,1380,-559,1334,1138,1138,1063,1063,1350,1392,1031,1031,1062,1062,1364,1363,1120,1120,1333,1348,881,881,881,881,375,374,359,373,343,358,341,325,791,791,1123,1122,-703,1105,1045,-719,865,865,790,790,774,774,1104,1029,338,293,323,308,-799,-815,833,788,772,818,803,816,322,292,307,320,561,531,515,546,289,274,288,258,
+                                       -251,-525,-605,-685,-765,-831,-846,1298,1057,1057,1312,1282,785,785,785,785,784,784,784,784,769,769,769,769,512,512,512,512,512,512,512,512,1399,1398,1383,1367,1382,1396,1351,-511,1381,1366,1139,1139,1079,1079,1124,1124,1364,1349,1363,1333,882,882,882,882,807,807,807,807,1094,1094,1136,1136,373,341,535,535,881,775,867,822,774,-591,324,338,-671,849,550,550,866,864,609,609,293,336,534,534,789,835,773,-751,834,804,308,307,833,788,832,772,562,562,547,547,305,275,560,515,290,290,
+                                       -252,-397,-477,-557,-622,-653,-719,-735,-750,1329,1299,1314,1057,1057,1042,1042,1312,1282,1024,1024,785,785,785,785,784,784,784,784,769,769,769,769,-383,1127,1141,1111,1126,1140,1095,1110,869,869,883,883,1079,1109,882,882,375,374,807,868,838,881,791,-463,867,822,368,263,852,837,836,-543,610,610,550,550,352,336,534,534,865,774,851,821,850,805,593,533,579,564,773,832,578,578,548,548,577,577,307,276,306,291,516,560,259,259,
+                                       -250,-2107,-2507,-2764,-2909,-2974,-3007,-3023,1041,1041,1040,1040,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,-767,-1052,-1213,-1277,-1358,-1405,-1469,-1535,-1550,-1582,-1614,-1647,-1662,-1694,-1726,-1759,-1774,-1807,-1822,-1854,-1886,1565,-1919,-1935,-1951,-1967,1731,1730,1580,1717,-1983,1729,1564,-1999,1548,-2015,-2031,1715,1595,-2047,1714,-2063,1610,-2079,1609,-2095,1323,1323,1457,1457,1307,1307,1712,1547,1641,1700,1699,1594,1685,1625,1442,1442,1322,1322,-780,-973,-910,1279,1278,1277,1262,1276,1261,1275,1215,1260,1229,-959,974,974,989,989,-943,735,478,478,495,463,506,414,-1039,1003,958,1017,927,942,987,957,431,476,1272,1167,1228,-1183,1256,-1199,895,895,941,941,1242,1227,1212,1135,1014,1014,490,489,503,487,910,1013,985,925,863,894,970,955,1012,847,-1343,831,755,755,984,909,428,366,754,559,-1391,752,486,457,924,997,698,698,983,893,740,740,908,877,739,739,667,667,953,938,497,287,271,271,683,606,590,712,726,574,302,302,738,736,481,286,526,725,605,711,636,724,696,651,589,681,666,710,364,467,573,695,466,466,301,465,379,379,709,604,665,679,316,316,634,633,436,436,464,269,424,394,452,332,438,363,347,408,393,448,331,422,362,407,392,421,346,406,391,376,375,359,1441,1306,-2367,1290,-2383,1337,-2399,-2415,1426,1321,-2431,1411,1336,-2447,-2463,-2479,1169,1169,1049,1049,1424,1289,1412,1352,1319,-2495,1154,1154,1064,1064,1153,1153,416,390,360,404,403,389,344,374,373,343,358,372,327,357,342,311,356,326,1395,1394,1137,1137,1047,1047,1365,1392,1287,1379,1334,1364,1349,1378,1318,1363,792,792,792,792,1152,1152,1032,1032,1121,1121,1046,1046,1120,1120,1030,1030,-2895,1106,1061,1104,849,849,789,789,1091,1076,1029,1090,1060,1075,833,833,309,324,532,532,832,772,818,803,561,561,531,560,515,546,289,274,288,258,
+                                       -250,-1179,-1579,-1836,-1996,-2124,-2253,-2333,-2413,-2477,-2542,-2574,-2607,-2622,-2655,1314,1313,1298,1312,1282,785,785,785,785,1040,1040,1025,1025,768,768,768,768,-766,-798,-830,-862,-895,-911,-927,-943,-959,-975,-991,-1007,-1023,-1039,-1055,-1070,1724,1647,-1103,-1119,1631,1767,1662,1738,1708,1723,-1135,1780,1615,1779,1599,1677,1646,1778,1583,-1151,1777,1567,1737,1692,1765,1722,1707,1630,1751,1661,1764,1614,1736,1676,1763,1750,1645,1598,1721,1691,1762,1706,1582,1761,1566,-1167,1749,1629,767,766,751,765,494,494,735,764,719,749,734,763,447,447,748,718,477,506,431,491,446,476,461,505,415,430,475,445,504,399,460,489,414,503,383,474,429,459,502,502,746,752,488,398,501,473,413,472,486,271,480,270,-1439,-1455,1357,-1471,-1487,-1503,1341,1325,-1519,1489,1463,1403,1309,-1535,1372,1448,1418,1476,1356,1462,1387,-1551,1475,1340,1447,1402,1386,-1567,1068,1068,1474,1461,455,380,468,440,395,425,410,454,364,467,466,464,453,269,409,448,268,432,1371,1473,1432,1417,1308,1460,1355,1446,1459,1431,1083,1083,1401,1416,1458,1445,1067,1067,1370,1457,1051,1051,1291,1430,1385,1444,1354,1415,1400,1443,1082,1082,1173,1113,1186,1066,1185,1050,-1967,1158,1128,1172,1097,1171,1081,-1983,1157,1112,416,266,375,400,1170,1142,1127,1065,793,793,1169,1033,1156,1096,1141,1111,1155,1080,1126,1140,898,898,808,808,897,897,792,792,1095,1152,1032,1125,1110,1139,1079,1124,882,807,838,881,853,791,-2319,867,368,263,822,852,837,866,806,865,-2399,851,352,262,534,534,821,836,594,594,549,549,593,593,533,533,848,773,579,579,564,578,548,563,276,276,577,576,306,291,516,560,305,305,275,259,
+                                       -251,-892,-2058,-2620,-2828,-2957,-3023,-3039,1041,1041,1040,1040,769,769,769,769,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,256,-511,-527,-543,-559,1530,-575,-591,1528,1527,1407,1526,1391,1023,1023,1023,1023,1525,1375,1268,1268,1103,1103,1087,1087,1039,1039,1523,-604,815,815,815,815,510,495,509,479,508,463,507,447,431,505,415,399,-734,-782,1262,-815,1259,1244,-831,1258,1228,-847,-863,1196,-879,1253,987,987,748,-767,493,493,462,477,414,414,686,669,478,446,461,445,474,429,487,458,412,471,1266,1264,1009,1009,799,799,-1019,-1276,-1452,-1581,-1677,-1757,-1821,-1886,-1933,-1997,1257,1257,1483,1468,1512,1422,1497,1406,1467,1496,1421,1510,1134,1134,1225,1225,1466,1451,1374,1405,1252,1252,1358,1480,1164,1164,1251,1251,1238,1238,1389,1465,-1407,1054,1101,-1423,1207,-1439,830,830,1248,1038,1237,1117,1223,1148,1236,1208,411,426,395,410,379,269,1193,1222,1132,1235,1221,1116,976,976,1192,1162,1177,1220,1131,1191,963,963,-1647,961,780,-1663,558,558,994,993,437,408,393,407,829,978,813,797,947,-1743,721,721,377,392,844,950,828,890,706,706,812,859,796,960,948,843,934,874,571,571,-1919,690,555,689,421,346,539,539,944,779,918,873,932,842,903,888,570,570,931,917,674,674,-2575,1562,-2591,1609,-2607,1654,1322,1322,1441,1441,1696,1546,1683,1593,1669,1624,1426,1426,1321,1321,1639,1680,1425,1425,1305,1305,1545,1668,1608,1623,1667,1592,1638,1666,1320,1320,1652,1607,1409,1409,1304,1304,1288,1288,1664,1637,1395,1395,1335,1335,1622,1636,1394,1394,1319,1319,1606,1621,1392,1392,1137,1137,1137,1137,345,390,360,375,404,373,1047,-2751,-2767,-2783,1062,1121,1046,-2799,1077,-2815,1106,1061,789,789,1105,1104,263,355,310,340,325,354,352,262,339,324,1091,1076,1029,1090,1060,1075,833,833,788,788,1088,1028,818,818,803,803,561,561,531,531,816,771,546,546,289,274,288,258,
+                                       -253,-317,-381,-446,-478,-509,1279,1279,-811,-1179,-1451,-1756,-1900,-2028,-2189,-2253,-2333,-2414,-2445,-2511,-2526,1313,1298,-2559,1041,1041,1040,1040,1025,1025,1024,1024,1022,1007,1021,991,1020,975,1019,959,687,687,1018,1017,671,671,655,655,1016,1015,639,639,758,758,623,623,757,607,756,591,755,575,754,559,543,543,1009,783,-575,-621,-685,-749,496,-590,750,749,734,748,974,989,1003,958,988,973,1002,942,987,957,972,1001,926,986,941,971,956,1000,910,985,925,999,894,970,-1071,-1087,-1102,1390,-1135,1436,1509,1451,1374,-1151,1405,1358,1480,1420,-1167,1507,1494,1389,1342,1465,1435,1450,1326,1505,1310,1493,1373,1479,1404,1492,1464,1419,428,443,472,397,736,526,464,464,486,457,442,471,484,482,1357,1449,1434,1478,1388,1491,1341,1490,1325,1489,1463,1403,1309,1477,1372,1448,1418,1433,1476,1356,1462,1387,-1439,1475,1340,1447,1402,1474,1324,1461,1371,1473,269,448,1432,1417,1308,1460,-1711,1459,-1727,1441,1099,1099,1446,1386,1431,1401,-1743,1289,1083,1083,1160,1160,1458,1445,1067,1067,1370,1457,1307,1430,1129,1129,1098,1098,268,432,267,416,266,400,-1887,1144,1187,1082,1173,1113,1186,1066,1050,1158,1128,1143,1172,1097,1171,1081,420,391,1157,1112,1170,1142,1127,1065,1169,1049,1156,1096,1141,1111,1155,1080,1126,1154,1064,1153,1140,1095,1048,-2159,1125,1110,1137,-2175,823,823,1139,1138,807,807,384,264,368,263,868,838,853,791,867,822,852,837,866,806,865,790,-2319,851,821,836,352,262,850,805,849,-2399,533,533,835,820,336,261,578,548,563,577,532,532,832,772,562,562,547,547,305,275,560,515,290,290,288,258 };
+static const uint8_t g_huff_tab32[] = { 130,162,193,209,44,28,76,140,9,9,9,9,9,9,9,9,190,254,222,238,126,94,157,157,109,61,173,205 };
+static const uint8_t g_huff_tab33[] = { 252,236,220,204,188,172,156,140,124,108,92,76,60,44,28,12 };
+static const int16_t g_huff_tabindex[2*16] = { 0,32,64,98,0,132,180,218,292,364,426,538,648,746,0,1126,1460,1460,1460,1460,1460,1460,1460,1460,1842,1842,1842,1842,1842,1842,1842,1842 };
+static const uint8_t g_linbits[] =  { 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,1,2,3,4,6,8,10,13,4,5,6,7,8,9,11,13 };
+
+#ifdef MINIMP3_WIDE_HUFFMAN
+#ifndef MINIMP3_HUFFMAN_BITS
+#define MINIMP3_HUFFMAN_BITS 8  /* 4 << MINIMP3_HUFFMAN_BITS bytes for each of the 16 codebooks, keep it <= 12 */
+#endif /* MINIMP3_HUFFMAN_BITS */
+
+/* wide tables: a single MINIMP3_HUFFMAN_BITS lookup decodes up to two big_values pairs, sign bits included, or a count1
+ * quad. big_values entries hold four 5-bit g_pow43 indexes, the bits used by the first pair (20..24) and by both pairs
+ * (25..29) and how many pairs were decoded (30..31). when the signs or linbits don't fit, but the codeword does, the entry
+ * is just the codebook leaf (pairs = 0). count1 entries hold four 2-bit values (1 = +1, 3 = -1), the codeword length
+ * (8..11) and the length with the sign bits (12..15). 0 means the codes are too long: walk the tree */
+static uint32_t g_huff_wide[16][1 << MINIMP3_HUFFMAN_BITS];
+static uint16_t g_huff_wide_count1[2][1 << MINIMP3_HUFFMAN_BITS];
+static uint8_t g_huff_wide_slot[32];
+
+/* walks a big_values codebook like L3_huffman does: returns the leaf for the codeword in the msbs of cache, with the
+ * total codeword length in place of the length of its last part */
+static int L3_huffman_leaf(const int16_t *codebook, uint32_t cache)
+{
+	int w = 5, len = 0;
+	int leaf = codebook[cache >> (32 - w)];
+	while (leaf < 0)
+	{
+		cache <<= w;
+		len += w;
+		w = leaf & 7;
+		leaf = codebook[(cache >> (32 - w)) - (leaf >> 3)];
+	}
+	return (leaf & 0xFF) | (len + (leaf >> 8)) << 8;
+}
+
+/* a big_values pair, sign bits included: returns its length, or -1 if it needs more than avail bits or linbits */
+static int L3_huffman_wide_pair(const int16_t *codebook, int linbits, uint32_t cache, int avail, uint32_t *idx)
+{
+	int j, leaf = L3_huffman_leaf(codebook, cache), len = leaf >> 8;
 
+	cache <<= len;
+	*idx = 0;
+	for (j = 0; j < 2; j++, leaf >>= 4)
+	{
+		int lsb = leaf & 0x0F, neg = 0;
+		if (lsb == 15 && linbits)
+		{
+			return -1;
+		}
+		if (lsb)
+		{
+			neg = cache >> 31;
+			cache <<= 1;
+			len++;
+		}
+		*idx |= (uint32_t)(16 + lsb - 16*neg) << 5*j;
+	}
+	return len <= avail ? len : -1;
+}
+
+static void L3_huffman_build_wide(void)
+{
+	int tab_num, slots = 0, i, j;
+	for (tab_num = 0; tab_num < 32; tab_num++)
+	{
+		const int16_t *codebook = g_huff_tabs + g_huff_tabindex[tab_num];
+		uint32_t *wide = g_huff_wide[slots];
+		for (i = 0; i < tab_num && g_huff_tabindex[i] != g_huff_tabindex[tab_num]; i++);
+		if (i < tab_num)
+		{
+			g_huff_wide_slot[tab_num] = g_huff_wide_slot[i];  /* same codebook as an earlier table */
+			continue;
+		}
+		g_huff_wide_slot[tab_num] = (uint8_t)slots++;
+		for (i = 0; i < (1 << MINIMP3_HUFFMAN_BITS); i++)
+		{
+			uint32_t cache = (uint32_t)i << (32 - MINIMP3_HUFFMAN_BITS), idx0, idx1;
+			int len0 = L3_huffman_wide_pair(codebook, g_linbits[tab_num], cache, MINIMP3_HUFFMAN_BITS, &idx0), len1;
+			if (len0 < 0)
+			{
+				/* the pair doesn't fit, but maybe the codeword alone does */
+				int leaf = L3_huffman_leaf(codebook, cache);
+				wide[i] = (leaf >> 8) <= MINIMP3_HUFFMAN_BITS ? (uint32_t)leaf : 0;
+				continue;
+			}
+			wide[i] = idx0 | (uint32_t)len0 << 20 | (uint32_t)len0 << 25 | 1u << 30;
+			len1 = L3_huffman_wide_pair(codebook, g_linbits[tab_num], cache << len0, MINIMP3_HUFFMAN_BITS - len0, &idx1);
+			if (len1 >= 0)
+			{
+				wide[i] = idx0 | idx1 << 10 | (uint32_t)len0 << 20 | (uint32_t)(len0 + len1) << 25 | 2u << 30;
+			}
+		}
+	}
+
+	for (j = 0; j < 2; j++)
+	{
+		const uint8_t *codebook_count1 = j ? g_huff_tab33 : g_huff_tab32;
+		for (i = 0; i < (1 << MINIMP3_HUFFMAN_BITS); i++)
+		{
+			uint32_t cache = (uint32_t)i << (32 - MINIMP3_HUFFMAN_BITS);
+			int k, len, signs = 0, values = 0;
+			int leaf = codebook_count1[cache >> 28];
+			if (!(leaf & 8))
+			{
+				leaf = codebook_count1[(leaf >> 3) + (cache << 4 >> (32 - (leaf & 3)))];
+			}
+			len = leaf & 7;
+			cache <<= len;
+			for (k = 0; k < 4; k++)
+			{
+				if (leaf & (128 >> k))
+				{
+					values |= (cache >> 31 ? 3 : 1) << 2*k;
+					cache <<= 1;
+					signs++;
+				}
+			}
+			g_huff_wide_count1[j][i] = len + signs <= MINIMP3_HUFFMAN_BITS ?
+			                           (uint16_t)(values | len << 8 | (len + signs) << 12) : 0;
+		}
+	}
+}
+#endif /* MINIMP3_WIDE_HUFFMAN */
+
+static void L3_huffman(mp3d_real_t *dst, bs_t *bs, const L3_gr_info_t *gr_info, const mp3d_scf_t *scf, int layer3gr_limit)
+{
 #define PEEK_BITS(n)  (bs_cache >> (32 - n))
 #define FLUSH_BITS(n) { bs_cache <<= (n); bs_sh += (n); }
 #define CHECK_BITS    while (bs_sh >= 0) { bs_cache |= (uint32_t)*bs_next_ptr++ << bs_sh; bs_sh -= 8; }
 #define BSPOS         ((bs_next_ptr - bs->buf)*8 - 24 + bs_sh)
-
-	float one = 0.0f;
+#define WIDE_PAIRS(e) { \
+		dst[0] = L3_DEQ(g_pow43[(e) & 31], one); \
+		dst[1] = L3_DEQ(g_pow43[((e) >> 5) & 31], one); \
+		if ((e) >> 31 && pairs_to_decode > 1) \
+		{ \
+			dst[2] = L3_DEQ(g_pow43[((e) >> 10) & 31], one); \
+			dst[3] = L3_DEQ(g_pow43[((e) >> 15) & 31], one); \
+			FLUSH_BITS(((e) >> 25) & 31); \
+			dst += 4; \
+			pairs_to_decode--; \
+		} else \
+		{ \
+			FLUSH_BITS(((e) >> 20) & 31); \
+			dst += 2; \
+		} \
+		CHECK_BITS; }
+
+	mp3d_scf_t one = { 0 };
 	int ireg = 0, big_val_cnt = gr_info->big_values;
 	const uint8_t *sfb = gr_info->sfbtab;
 	const uint8_t *bs_next_ptr = bs->buf + bs->pos/8;
@@ -788,8 +1203,11 @@ static void L3_huffman(float *dst, bs_t *bs, const L3_gr_info_t *gr_info, const
 	{
 		int tab_num = gr_info->table_select[ireg];
 		int sfb_cnt = gr_info->region_count[ireg++];
-		const int16_t *codebook = tabs + tabindex[tab_num];
+		const int16_t *codebook = g_huff_tabs + g_huff_tabindex[tab_num];
 		int linbits = g_linbits[tab_num];
+#ifdef MINIMP3_WIDE_HUFFMAN
+		const uint32_t *wide = g_huff_wide[g_huff_wide_slot[tab_num]];
+#endif /* MINIMP3_WIDE_HUFFMAN */
 		if (linbits)
 		{
 			do
@@ -799,13 +1217,25 @@ static void L3_huffman(float *dst, bs_t *bs, const L3_gr_info_t *gr_info, const
 				one = *scf++;
 				do
 				{
-					int j, w = 5;
-					int leaf = codebook[PEEK_BITS(w)];
-					while (leaf < 0)
+					int j, w = 5, leaf;
+#ifdef MINIMP3_WIDE_HUFFMAN
+					uint32_t e = wide[PEEK_BITS(MINIMP3_HUFFMAN_BITS)];
+					if (e >> 30)
 					{
-						FLUSH_BITS(w);
-						w = leaf & 7;
-						leaf = codebook[PEEK_BITS(w) - (leaf >> 3)];
+						WIDE_PAIRS(e);
+						continue;
+					}
+					leaf = (int)e;
+					if (!leaf)
+#endif /* MINIMP3_WIDE_HUFFMAN */
+					{
+						leaf = codebook[PEEK_BITS(w)];
+						while (leaf < 0)
+						{
+							FLUSH_BITS(w);
+							w = leaf & 7;
+							leaf = codebook[PEEK_BITS(w) - (leaf >> 3)];
+						}
 					}
 					FLUSH_BITS(leaf >> 8);
 
@@ -817,10 +1247,20 @@ static void L3_huffman(float *dst, bs_t *bs, const L3_gr_info_t *gr_info, const
 							lsb += PEEK_BITS(linbits);
 							FLUSH_BITS(linbits);
 							CHECK_BITS;
+#ifdef MINIMP3_FIXED_POINT
+							{
+								int sh;
+								mp3d_scf_t big = one;
+								int32_t p43 = L3_pow_43(lsb, &sh);
+								big.sh -= sh;
+								*dst = L3_deq((int32_t)bs_cache < 0 ? -p43 : p43, big);
+							}
+#else /* MINIMP3_FIXED_POINT */
 							*dst = one*L3_pow_43(lsb)*((int32_t)bs_cache < 0 ? -1: 1);
+#endif /* MINIMP3_FIXED_POINT */
 						} else
 						{
-							*dst = g_pow43[16 + lsb - 16*(bs_cache >> 31)]*one;
+							*dst = L3_DEQ(g_pow43[16 + lsb - 16*(bs_cache >> 31)], one);
 						}
 						FLUSH_BITS(lsb ? 1 : 0);
 					}
@@ -836,20 +1276,32 @@ static void L3_huffman(float *dst, bs_t *bs, const L3_gr_info_t *gr_info, const
 				one = *scf++;
 				do
 				{
-					int j, w = 5;
-					int leaf = codebook[PEEK_BITS(w)];
-					while (leaf < 0)
+					int j, w = 5, leaf;
+#ifdef MINIMP3_WIDE_HUFFMAN
+					uint32_t e = wide[PEEK_BITS(MINIMP3_HUFFMAN_BITS)];
+					if (e >> 30)
 					{
-						FLUSH_BITS(w);
-						w = leaf & 7;
-						leaf = codebook[PEEK_BITS(w) - (leaf >> 3)];
+						WIDE_PAIRS(e);
+						continue;
+					}
+					leaf = (int)e;
+					if (!leaf)
+#endif /* MINIMP3_WIDE_HUFFMAN */
+					{
+						leaf = codebook[PEEK_BITS(w)];
+						while (leaf < 0)
+						{
+							FLUSH_BITS(w);
+							w = leaf & 7;
+							leaf = codebook[PEEK_BITS(w) - (leaf >> 3)];
+						}
 					}
 					FLUSH_BITS(leaf >> 8);
 
 					for (j = 0; j < 2; j++, dst++, leaf >>= 4)
 					{
 						int lsb = leaf & 0x0F;
-						*dst = g_pow43[16 + lsb - 16*(bs_cache >> 31)]*one;
+						*dst = L3_DEQ(g_pow43[16 + lsb - 16*(bs_cache >> 31)], one);
 						FLUSH_BITS(lsb ? 1 : 0);
 					}
 					CHECK_BITS;
@@ -858,10 +1310,33 @@ static void L3_huffman(float *dst, bs_t *bs, const L3_gr_info_t *gr_info, const
 		}
 	}
 
+#define RELOAD_SCALEFACTOR  if (!--np) { np = *sfb++/2; if (!np) break; one = *scf++; }
 	for (np = 1 - big_val_cnt;; dst += 4)
 	{
-		const uint8_t *codebook_count1 = (gr_info->count1_table) ? tab33 : tab32;
-		int leaf = codebook_count1[PEEK_BITS(4)];
+		const uint8_t *codebook_count1 = (gr_info->count1_table) ? g_huff_tab33 : g_huff_tab32;
+		int leaf;
+#ifdef MINIMP3_WIDE_HUFFMAN
+		int e = g_huff_wide_count1[gr_info->count1_table][PEEK_BITS(MINIMP3_HUFFMAN_BITS)];
+		if (e)
+		{
+			FLUSH_BITS((e >> 8) & 15);
+			if (BSPOS > layer3gr_limit)
+			{
+				break;
+			}
+#define DEQ_COUNT1_WIDE(s) if (e & (1 << 2*s)) { dst[s] = L3_DEQ_ONE(e & (2 << 2*s), one); }
+			RELOAD_SCALEFACTOR;
+			DEQ_COUNT1_WIDE(0);
+			DEQ_COUNT1_WIDE(1);
+			RELOAD_SCALEFACTOR;
+			DEQ_COUNT1_WIDE(2);
+			DEQ_COUNT1_WIDE(3);
+			FLUSH_BITS((e >> 12) - ((e >> 8) & 15));
+			CHECK_BITS;
+			continue;
+		}
+#endif /* MINIMP3_WIDE_HUFFMAN */
+		leaf = codebook_count1[PEEK_BITS(4)];
 		if (!(leaf & 8))
 		{
 			leaf = codebook_count1[(leaf >> 3) + (bs_cache << 4 >> (32 - (leaf & 3)))];
@@ -871,8 +1346,7 @@ static void L3_huffman(float *dst, bs_t *bs, const L3_gr_info_t *gr_info, const
 		{
 			break;
 		}
-#define RELOAD_SCALEFACTOR  if (!--np) { np = *sfb++/2; if (!np) break; one = *scf++; }
-#define DEQ_COUNT1(s) if (leaf & (128 >> s)) { dst[s] = ((int32_t)bs_cache < 0) ? -one : one; FLUSH_BITS(1) }
+#define DEQ_COUNT1(s) if (leaf & (128 >> s)) { dst[s] = L3_DEQ_ONE((int32_t)bs_cache < 0, one); FLUSH_BITS(1) }
 		RELOAD_SCALEFACTOR;
 		DEQ_COUNT1(0);
 		DEQ_COUNT1(1);
@@ -885,10 +1359,10 @@ static void L3_huffman(float *dst, bs_t *bs, const L3_gr_info_t *gr_info, const
 	bs->pos = layer3gr_limit;
 }
 
-static void L3_midside_stereo(float *left, int n)
+static void L3_midside_stereo(mp3d_real_t *left, int n)
 {
 	int i = 0;
-	float *right = left + 576;
+	mp3d_real_t *right = left + 576;
 #if HAVE_SIMD
 	if (have_simd())
     {
@@ -910,24 +1384,24 @@ static void L3_midside_stereo(float *left, int n)
 #endif /* HAVE_SIMD */
 	for (; i < n; i++)
 	{
-		float a = left[i];
-		float b = right[i];
+		mp3d_real_t a = left[i];
+		mp3d_real_t b = right[i];
 		left[i] = a + b;
 		right[i] = a - b;
 	}
 }
 
-static void L3_intensity_stereo_band(float *left, int n, float kl, float kr)
+static void L3_intensity_stereo_band(mp3d_real_t *left, int n, mp3d_real_t kl, mp3d_real_t kr)
 {
 	int i;
 	for (i = 0; i < n; i++)
 	{
-		left[i + 576] = left[i]*kr;
-		left[i] = left[i]*kl;
+		left[i + 576] = MP3D_MUL(left[i], kr);
+		left[i] = MP3D_MUL(left[i], kl);
 	}
 }
 
-static void L3_stereo_top_band(const float *right, const uint8_t *sfb, int nbands, int max_band[3])
+static void L3_stereo_top_band(const mp3d_real_t *right, const uint8_t *sfb, int nbands, int max_band[3])
 {
 	int i, k;
 
@@ -947,9 +1421,9 @@ static void L3_stereo_top_band(const float *right, const uint8_t *sfb, int nband
 	}
 }
 
-static void L3_stereo_process(float *left, const uint8_t *ist_pos, const uint8_t *sfb, const uint8_t *hdr, int max_band[3], int mpeg2_sh)
+static void L3_stereo_process(mp3d_real_t *left, const uint8_t *ist_pos, const uint8_t *sfb, const uint8_t *hdr, int max_band[3], int mpeg2_sh)
 {
-	static const float g_pan[7*2] = { 0,1,0.21132487f,0.78867513f,0.36602540f,0.63397460f,0.5f,0.5f,0.63397460f,0.36602540f,0.78867513f,0.21132487f,1,0 };
+	static const mp3d_real_t g_pan[7*2] = { MP3D_C(0),MP3D_C(1),MP3D_C(0.21132487f),MP3D_C(0.78867513f),MP3D_C(0.36602540f),MP3D_C(0.63397460f),MP3D_C(0.5f),MP3D_C(0.5f),MP3D_C(0.63397460f),MP3D_C(0.36602540f),MP3D_C(0.78867513f),MP3D_C(0.21132487f),MP3D_C(1),MP3D_C(0) };
 	unsigned i, max_pos = HDR_TEST_MPEG1(hdr) ? 7 : 64;
 
 	for (i = 0; sfb[i]; i++)
@@ -957,22 +1431,22 @@ static void L3_stereo_process(float *left, const uint8_t *ist_pos, const uint8_t
 		unsigned ipos = ist_pos[i];
 		if ((int)i > max_band[i % 3] && ipos < max_pos)
 		{
-			float kl, kr, s = HDR_TEST_MS_STEREO(hdr) ? 1.41421356f : 1;
+			mp3d_real_t kl, kr, s = HDR_TEST_MS_STEREO(hdr) ? MP3D_C(1.41421356f) : MP3D_C(1);
 			if (HDR_TEST_MPEG1(hdr))
 			{
 				kl = g_pan[2*ipos];
 				kr = g_pan[2*ipos + 1];
 			} else
 			{
-				kl = 1;
-				kr = L3_ldexp_q2(1, (ipos + 1) >> 1 << mpeg2_sh);
+				kl = MP3D_C(1);
+				kr = L3_ldexp_q2(MP3D_C(1), (ipos + 1) >> 1 << mpeg2_sh);
 				if (ipos & 1)
 				{
 					kl = kr;
-					kr = 1;
+					kr = MP3D_C(1);
 				}
 			}
-			L3_intensity_stereo_band(left, sfb[i], kl*s, kr*s);
+			L3_intensity_stereo_band(left, sfb[i], MP3D_MUL(kl, s), MP3D_MUL(kr, s));
 		} else if (HDR_TEST_MS_STEREO(hdr))
 		{
 			L3_midside_stereo(left, sfb[i]);
@@ -981,7 +1455,7 @@ static void L3_stereo_process(float *left, const uint8_t *ist_pos, const uint8_t
 	}
 }
 
-static void L3_intensity_stereo(float *left, uint8_t *ist_pos, const L3_gr_info_t *gr, const uint8_t *hdr)
+static void L3_intensity_stereo(mp3d_real_t *left, uint8_t *ist_pos, const L3_gr_info_t *gr, const uint8_t *hdr)
 {
 	int max_band[3], n_sfb = gr->n_long_sfb + gr->n_short_sfb;
 	int i, max_blocks = gr->n_short_sfb ? 3 : 1;
@@ -1001,10 +1475,10 @@ static void L3_intensity_stereo(float *left, uint8_t *ist_pos, const L3_gr_info_
 	L3_stereo_process(left, ist_pos, gr->sfbtab, hdr, max_band, gr[1].scalefac_compress & 1);
 }
 
-static void L3_reorder(float *grbuf, float *scratch, const uint8_t *sfb)
+static void L3_reorder(mp3d_real_t *grbuf, mp3d_real_t *scratch, const uint8_t *sfb)
 {
 	int i, len;
-	float *src = grbuf, *dst = scratch;
+	mp3d_real_t *src = grbuf, *dst = scratch;
 
 	for (;0 != (len = *sfb); sfb += 3, src += 2*len)
 	{
@@ -1015,14 +1489,14 @@ static void L3_reorder(float *grbuf, float *scratch, const uint8_t *sfb)
 			*dst++ = src[2*len];
 		}
 	}
-	memcpy(grbuf, scratch, (dst - scratch)*sizeof(float));
+	memcpy(grbuf, scratch, (dst - scratch)*sizeof(mp3d_real_t));
 }
 
-static void L3_antialias(float *grbuf, int nbands)
+static void L3_antialias(mp3d_real_t *grbuf, int nbands)
 {
-	static const float g_aa[2][8] = {
-		{0.85749293f,0.88174200f,0.94962865f,0.98331459f,0.99551782f,0.99916056f,0.99989920f,0.99999316f},
-		{0.51449576f,0.47173197f,0.31337745f,0.18191320f,0.09457419f,0.04096558f,0.01419856f,0.00369997f}
+	static const mp3d_real_t g_aa[2][8] = {
+		{MP3D_C(0.85749293f),MP3D_C(0.88174200f),MP3D_C(0.94962865f),MP3D_C(0.98331459f),MP3D_C(0.99551782f),MP3D_C(0.99916056f),MP3D_C(0.99989920f),MP3D_C(0.99999316f)},
+		{MP3D_C(0.51449576f),MP3D_C(0.47173197f),MP3D_C(0.31337745f),MP3D_C(0.18191320f),MP3D_C(0.09457419f),MP3D_C(0.04096558f),MP3D_C(0.01419856f),MP3D_C(0.00369997f)}
 	};
 
 	for (; nbands > 0; nbands--, grbuf += 18)
@@ -1044,28 +1518,28 @@ static void L3_antialias(float *grbuf, int nbands)
 #ifndef MINIMP3_ONLY_SIMD
 		for(; i < 8; i++)
 		{
-			float u = grbuf[18 + i];
-			float d = grbuf[17 - i];
-			grbuf[18 + i] = u*g_aa[0][i] - d*g_aa[1][i];
-			grbuf[17 - i] = u*g_aa[1][i] + d*g_aa[0][i];
+			mp3d_real_t u = grbuf[18 + i];
+			mp3d_real_t d = grbuf[17 - i];
+			grbuf[18 + i] = MP3D_MUL(u, g_aa[0][i]) - MP3D_MUL(d, g_aa[1][i]);
+			grbuf[17 - i] = MP3D_MUL(u, g_aa[1][i]) + MP3D_MUL(d, g_aa[0][i]);
 		}
 #endif /* MINIMP3_ONLY_SIMD */
 	}
 }
 
-static void L3_dct3_9(float *y)
+static void L3_dct3_9(mp3d_real_t *y)
 {
-	float s0, s1, s2, s3, s4, s5, s6, s7, s8, t0, t2, t4;
+	mp3d_real_t s0, s1, s2, s3, s4, s5, s6, s7, s8, t0, t2, t4;
 
 	s0 = y[0]; s2 = y[2]; s4 = y[4]; s6 = y[6]; s8 = y[8];
-	t0 = s0 + s6*0.5f;
+	t0 = s0 + MP3D_MUL(s6, MP3D_C(0.5f));
 	s0 -= s6;
-	t4 = (s4 + s2)*0.93969262f;
-	t2 = (s8 + s2)*0.76604444f;
-	s6 = (s4 - s8)*0.17364818f;
+	t4 = MP3D_MUL((s4 + s2), MP3D_C(0.93969262f));
+	t2 = MP3D_MUL((s8 + s2), MP3D_C(0.76604444f));
+	s6 = MP3D_MUL((s4 - s8), MP3D_C(0.17364818f));
 	s4 += s8 - s2;
 
-	s2 = s0 - s4*0.5f;
+	s2 = s0 - MP3D_MUL(s4, MP3D_C(0.5f));
 	y[4] = s4 + s0;
 	s8 = t0 - t2 + s6;
 	s0 = t0 - t4 + t2;
@@ -1073,11 +1547,11 @@ static void L3_dct3_9(float *y)
 
 	s1 = y[1]; s3 = y[3]; s5 = y[5]; s7 = y[7];
 
-	s3 *= 0.86602540f;
-	t0 = (s5 + s1)*0.98480775f;
-	t4 = (s5 - s7)*0.34202014f;
-	t2 = (s1 + s7)*0.64278761f;
-	s1 = (s1 - s5 - s7)*0.86602540f;
+	s3 = MP3D_MUL(s3, MP3D_C(0.86602540f));
+	t0 = MP3D_MUL((s5 + s1), MP3D_C(0.98480775f));
+	t4 = MP3D_MUL((s5 - s7), MP3D_C(0.34202014f));
+	t2 = MP3D_MUL((s1 + s7), MP3D_C(0.64278761f));
+	s1 = MP3D_MUL((s1 - s5 - s7), MP3D_C(0.86602540f));
 
 	s5 = t0 - s3 - t2;
 	s7 = t4 - s3 - t0;
@@ -1093,16 +1567,16 @@ static void L3_dct3_9(float *y)
 	y[8] = s4 + s7;
 }
 
-static void L3_imdct36(float *grbuf, float *overlap, const float *window, int nbands)
+static void L3_imdct36(mp3d_real_t *grbuf, mp3d_real_t *overlap, const mp3d_real_t *window, int nbands)
 {
 	int i, j;
-	static const float g_twid9[18] = {
-		0.73727734f,0.79335334f,0.84339145f,0.88701083f,0.92387953f,0.95371695f,0.97629601f,0.99144486f,0.99904822f,0.67559021f,0.60876143f,0.53729961f,0.46174861f,0.38268343f,0.30070580f,0.21643961f,0.13052619f,0.04361938f
+	static const mp3d_real_t g_twid9[18] = {
+		MP3D_C(0.73727734f),MP3D_C(0.79335334f),MP3D_C(0.84339145f),MP3D_C(0.88701083f),MP3D_C(0.92387953f),MP3D_C(0.95371695f),MP3D_C(0.97629601f),MP3D_C(0.99144486f),MP3D_C(0.99904822f),MP3D_C(0.67559021f),MP3D_C(0.60876143f),MP3D_C(0.53729961f),MP3D_C(0.46174861f),MP3D_C(0.38268343f),MP3D_C(0.30070580f),MP3D_C(0.21643961f),MP3D_C(0.13052619f),MP3D_C(0.04361938f)
 	};
 
 	for (j = 0; j < nbands; j++, grbuf += 18, overlap += 9)
 	{
-		float co[9], si[9];
+		mp3d_real_t co[9], si[9];
 		co[0] = -grbuf[0];
 		si[0] = grbuf[17];
 		for (i = 0; i < 4; i++)
@@ -1141,28 +1615,28 @@ static void L3_imdct36(float *grbuf, float *overlap, const float *window, int nb
 #endif /* HAVE_SIMD */
 		for (; i < 9; i++)
 		{
-			float ovl  = overlap[i];
-			float sum  = co[i]*g_twid9[9 + i] + si[i]*g_twid9[0 + i];
-			overlap[i] = co[i]*g_twid9[0 + i] - si[i]*g_twid9[9 + i];
-			grbuf[i]      = ovl*window[0 + i] - sum*window[9 + i];
-			grbuf[17 - i] = ovl*window[9 + i] + sum*window[0 + i];
+			mp3d_real_t ovl  = overlap[i];
+			mp3d_real_t sum  = MP3D_MUL(co[i], g_twid9[9 + i]) + MP3D_MUL(si[i], g_twid9[0 + i]);
+			overlap[i] = MP3D_MUL(co[i], g_twid9[0 + i]) - MP3D_MUL(si[i], g_twid9[9 + i]);
+			grbuf[i]      = MP3D_MUL(ovl, window[0 + i]) - MP3D_MUL(sum, window[9 + i]);
+			grbuf[17 - i] = MP3D_MUL(ovl, window[9 + i]) + MP3D_MUL(sum, window[0 + i]);
 		}
 	}
 }
 
-static void L3_idct3(float x0, float x1, float x2, float *dst)
+static void L3_idct3(mp3d_real_t x0, mp3d_real_t x1, mp3d_real_t x2, mp3d_real_t *dst)
 {
-	float m1 = x1*0.86602540f;
-	float a1 = x0 - x2*0.5f;
+	mp3d_real_t m1 = MP3D_MUL(x1, MP3D_C(0.86602540f));
+	mp3d_real_t a1 = x0 - MP3D_MUL(x2, MP3D_C(0.5f));
 	dst[1] = x0 + x2;
 	dst[0] = a1 + m1;
 	dst[2] = a1 - m1;
 }
 
-static void L3_imdct12(float *x, float *dst, float *overlap)
+static void L3_imdct12(mp3d_real_t *x, mp3d_real_t *dst, mp3d_real_t *overlap)
 {
-	static const float g_twid3[6] = { 0.79335334f,0.92387953f,0.99144486f, 0.60876143f,0.38268343f,0.13052619f };
-	float co[3], si[3];
+	static const mp3d_real_t g_twid3[6] = { MP3D_C(0.79335334f),MP3D_C(0.92387953f),MP3D_C(0.99144486f), MP3D_C(0.60876143f),MP3D_C(0.38268343f),MP3D_C(0.13052619f) };
+	mp3d_real_t co[3], si[3];
 	int i;
 
 	L3_idct3(-x[0], x[6] + x[3], x[12] + x[9], co);
@@ -1171,41 +1645,42 @@ static void L3_imdct12(float *x, float *dst, float *overlap)
 
 	for (i = 0; i < 3; i++)
 	{
-		float ovl  = overlap[i];
-		float sum  = co[i]*g_twid3[3 + i] + si[i]*g_twid3[0 + i];
-		overlap[i] = co[i]*g_twid3[0 + i] - si[i]*g_twid3[3 + i];
-		dst[i]     = ovl*g_twid3[2 - i] - sum*g_twid3[5 - i];
-		dst[5 - i] = ovl*g_twid3[5 - i] + sum*g_twid3[2 - i];
+		mp3d_real_t ovl  = overlap[i];
+		mp3d_real_t sum  = MP3D_MUL(co[i], g_twid3[3 + i]) + MP3D_MUL(si[i], g_twid3[0 + i]);
+		overlap[i] = MP3D_MUL(co[i], g_twid3[0 + i]) - MP3D_MUL(si[i], g_twid3[3 + i]);
+		dst[i]     = MP3D_MUL(ovl, g_twid3[2 - i]) - MP3D_MUL(sum, g_twid3[5 - i]);
+		dst[5 - i] = MP3D_MUL(ovl, g_twid3[5 - i]) + MP3D_MUL(sum, g_twid3[2 - i]);
 	}
 }
 
-static void L3_imdct_short(float *grbuf, float *overlap, int nbands)
+static void L3_imdct_short(mp3d_real_t *grbuf, mp3d_real_t *overlap, int nbands)
 {
 	for (;nbands > 0; nbands--, overlap += 9, grbuf += 18)
 	{
-		float tmp[18];
+		mp3d_real_t tmp[18];
 		memcpy(tmp, grbuf, sizeof(tmp));
-		memcpy(grbuf, overlap, 6*sizeof(float));
+		memcpy(grbuf, overlap, 6*sizeof(mp3d_real_t));
 		L3_imdct12(tmp, grbuf + 6, overlap + 6);
 		L3_imdct12(tmp + 1, grbuf + 12, overlap + 6);
 		L3_imdct12(tmp + 2, overlap, overlap + 6);
 	}
 }
 
-static void L3_change_sign(float *grbuf)
+static void L3_change_sign(mp3d_real_t *grbuf, int nbands)
 {
 	int b, i;
-	for (b = 0, grbuf += 18; b < 32; b += 2, grbuf += 36)
+	for (b = 0, grbuf += 18; b + 1 < nbands; b += 2, grbuf += 36)
 		for (i = 1; i < 18; i += 2)
 			grbuf[i] = -grbuf[i];
 }
 
-static void L3_imdct_gr(float *grbuf, float *overlap, unsigned block_type, unsigned n_long_bands)
+static void L3_imdct_gr(mp3d_real_t *grbuf, mp3d_real_t *overlap, unsigned block_type, unsigned n_long_bands, unsigned nbands)
 {
-	static const float g_mdct_window[2][18] = {
-		{ 0.99904822f,0.99144486f,0.97629601f,0.95371695f,0.92387953f,0.88701083f,0.84339145f,0.79335334f,0.73727734f,0.04361938f,0.13052619f,0.21643961f,0.30070580f,0.38268343f,0.46174861f,0.53729961f,0.60876143f,0.67559021f },
-		{ 1,1,1,1,1,1,0.99144486f,0.92387953f,0.79335334f,0,0,0,0,0,0,0.13052619f,0.38268343f,0.60876143f }
+	static const mp3d_real_t g_mdct_window[2][18] = {
+		{ MP3D_C(0.99904822f),MP3D_C(0.99144486f),MP3D_C(0.97629601f),MP3D_C(0.95371695f),MP3D_C(0.92387953f),MP3D_C(0.88701083f),MP3D_C(0.84339145f),MP3D_C(0.79335334f),MP3D_C(0.73727734f),MP3D_C(0.04361938f),MP3D_C(0.13052619f),MP3D_C(0.21643961f),MP3D_C(0.30070580f),MP3D_C(0.38268343f),MP3D_C(0.46174861f),MP3D_C(0.53729961f),MP3D_C(0.60876143f),MP3D_C(0.67559021f) },
+		{ MP3D_C(1),MP3D_C(1),MP3D_C(1),MP3D_C(1),MP3D_C(1),MP3D_C(1),MP3D_C(0.99144486f),MP3D_C(0.92387953f),MP3D_C(0.79335334f),MP3D_C(0),MP3D_C(0),MP3D_C(0),MP3D_C(0),MP3D_C(0),MP3D_C(0),MP3D_C(0.13052619f),MP3D_C(0.38268343f),MP3D_C(0.60876143f) }
 	};
+	n_long_bands = MINIMP3_MIN(n_long_bands, nbands);
 	if (n_long_bands)
 	{
 		L3_imdct36(grbuf, overlap, g_mdct_window[0], n_long_bands);
@@ -1213,49 +1688,118 @@ static void L3_imdct_gr(float *grbuf, float *overlap, unsigned block_type, unsig
 		overlap += 9*n_long_bands;
 	}
 	if (block_type == SHORT_BLOCK_TYPE)
-		L3_imdct_short(grbuf, overlap, 32 - n_long_bands);
+		L3_imdct_short(grbuf, overlap, nbands - n_long_bands);
 	else
-		L3_imdct36(grbuf, overlap, g_mdct_window[block_type == STOP_BLOCK_TYPE], 32 - n_long_bands);
+		L3_imdct36(grbuf, overlap, g_mdct_window[block_type == STOP_BLOCK_TYPE], nbands - n_long_bands);
 }
 
+/* the bytes left after the last granule stay where they are, in front of the next frame's main data */
 static void L3_save_reservoir(mp3dec_t *h, mp3dec_scratch_t *s)
 {
-	int pos = (s->bs.pos + 7)/8u;
-	int remains = s->bs.limit/8u - pos;
-	if (remains > MAX_BITRESERVOIR_BYTES)
-	{
-		pos += remains - MAX_BITRESERVOIR_BYTES;
-		remains = MAX_BITRESERVOIR_BYTES;
-	}
-	if (remains > 0)
-	{
-		memmove(h->reserv_buf, s->maindata + pos, remains);
-	}
-	h->reserv = remains;
+	int remains = s->bs.limit/8 - (s->bs.pos + 7)/8;
+	h->reserv = MINIMP3_MAX(0, MINIMP3_MIN(remains, MAX_BITRESERVOIR_BYTES));
 }
 
+/* the frame's main data is still copied in every time, behind the reservoir: it's only ever contiguous with it when
+ * main_data_begin is 0, and even then reading it in place isn't safe. mp3dec_decode_frame_front() lets the caller
+ * reuse the frame before the granules are decoded, and the Huffman decoder can read well past the end of a broken
+ * granule, which must stay inside the decoder rather than run off the end of the caller's buffer */
 static int L3_restore_reservoir(mp3dec_t *h, bs_t *bs, mp3dec_scratch_t *s, int main_data_begin)
 {
 	int frame_bytes = (bs->limit - bs->pos)/8;
 	int bytes_have = MINIMP3_MIN(h->reserv, main_data_begin);
-	memcpy(s->maindata, h->reserv_buf + MINIMP3_MAX(0, h->reserv - main_data_begin), MINIMP3_MIN(h->reserv, main_data_begin));
-	memcpy(s->maindata + bytes_have, bs->buf + bs->pos/8, frame_bytes);
-	bs_init(&s->bs, s->maindata, bytes_have + frame_bytes);
+	if (h->maindata_end + frame_bytes > MAX_MAINDATA_BYTES)
+	{
+		/* out of room: move the reservoir back to the start, the only time it gets copied again */
+		memmove(h->maindata, h->maindata + h->maindata_end - h->reserv, h->reserv);
+		h->maindata_end = h->reserv;
+	}
+	memcpy(h->maindata + h->maindata_end, bs->buf + bs->pos/8, frame_bytes);
+	bs_init(&s->bs, h->maindata + h->maindata_end - bytes_have, bytes_have + frame_bytes);
+	h->maindata_end += frame_bytes;
 	return h->reserv >= main_data_begin;
 }
 
+static int L3_same_blocks(const L3_gr_info_t *gr)
+{
+	return gr[0].block_type == gr[1].block_type && gr[0].mixed_block_flag == gr[1].mixed_block_flag;
+}
+
+static void L3_fold_mono(mp3d_real_t *left, const mp3d_real_t *right, int n, int policy)
+{
+	int i;
+	if (policy == MINIMP3_MONO_RIGHT)
+	{
+		memcpy(left, right, n*sizeof(mp3d_real_t));
+	} else if (policy == MINIMP3_MONO_MIX)
+	{
+		for (i = 0; i < n; i++)
+		{
+			left[i] = MP3D_MUL((left[i] + right[i]), MP3D_C(0.5f));
+		}
+	}
+}
+
 static void L3_decode(mp3dec_t *h, mp3dec_scratch_t *s, L3_gr_info_t *gr_info, int nch)
 {
-	int ch;
+	int ch, ch_begin = 0, ch_end = nch, nrender = nch, freq_fold = 0, time_fold = 0, silent = 1, zero;
+	int nbands = h->max_bands;
+
+	if (h->cutoff_hz)
+	{
+		/* each subband is hz/64 wide: keep the ones up to the cutoff, and the next one */
+		unsigned hz = hdr_sample_rate_hz(h->header);
+		nbands = MINIMP3_MIN(nbands, (int)((h->cutoff_hz*64 + hz - 1)/hz) + 1);
+	}
+
+	if (nch == 2 && h->mono)
+	{
+		nrender = 1;
+		if (!HDR_TEST_I_STEREO(h->header) && !HDR_IS_MS_STEREO(h->header) && h->mono != MINIMP3_MONO_MIX)
+		{
+			/* plain stereo, the unused channel is never even huffman decoded */
+			ch_begin = h->mono == MINIMP3_MONO_RIGHT;
+			ch_end = ch_begin + 1;
+		} else if (!HDR_TEST_I_STEREO(h->header) && HDR_IS_MS_STEREO(h->header) && h->mono == MINIMP3_MONO_MIX &&
+		           L3_same_blocks(gr_info))
+		{
+			/* (L + R)/2 is the mid channel as it is in the bitstream, the side channel is not needed */
+			ch_end = 1;
+		} else if (h->mono != MINIMP3_MONO_MIX || L3_same_blocks(gr_info))
+		{
+			freq_fold = 1;
+		} else
+		{
+			/* the two channels use different windows, so they can't share one IMDCT: run both from the folded
+			 * overlap and fold afterwards. only the overlap at the block type switch is approximated */
+			memcpy(h->mdct_overlap[1], h->mdct_overlap[0], sizeof(h->mdct_overlap[0]));
+			h->mdct_idle[1] = h->mdct_idle[0];
+			nrender = 2;
+			time_fold = 1;
+		}
+	}
 
 	for (ch = 0; ch < nch; ch++)
 	{
 		int layer3gr_limit = s->bs.pos + gr_info[ch].part_23_length;
 		L3_decode_scalefactors(h->header, s->ist_pos[ch], &s->bs, gr_info + ch, s->scf, ch);
-		L3_huffman(s->grbuf[ch], &s->bs, gr_info + ch, s->scf, layer3gr_limit);
+		if (ch < ch_begin || ch >= ch_end)
+		{
+			/* scalefactors are still needed by scfsi in the next granule */
+			s->bs.pos = layer3gr_limit;
+			continue;
+		}
+		if (gr_info[ch].big_values || s->bs.pos < layer3gr_limit)
+		{
+			silent = 0;  /* there are big_values pairs, or count1 quads */
+		}
+		L3_huffman(s->grbuf[ch - ch_begin], &s->bs, gr_info + ch, s->scf, layer3gr_limit);
 	}
 
-	if (HDR_TEST_I_STEREO(h->header))
+	if (ch_end - ch_begin < nch)
+	{
+		/* only one channel was decoded, nothing to do */
+	} else if (HDR_TEST_I_STEREO(h->header))
 	{
 		L3_intensity_stereo(s->grbuf[0], s->ist_pos[1], gr_info, h->header);
 	} else if (HDR_IS_MS_STEREO(h->header))
@@ -1263,27 +1807,64 @@ static void L3_decode(mp3dec_t *h, mp3dec_scratch_t *s, L3_gr_info_t *gr_info, i
 		L3_midside_stereo(s->grbuf[0], 576);
 	}
 
-	for (ch = 0; ch < nch; ch++, gr_info++)
+	if (freq_fold)
+	{
+		L3_fold_mono(s->grbuf[0], s->grbuf[1], 576, h->mono);
+		gr_info += h->mono == MINIMP3_MONO_RIGHT;
+	} else
+	{
+		gr_info += ch_begin;
+	}
+
+	for (ch = 0, zero = silent; ch < nrender; ch++, gr_info++)
 	{
 		int aa_bands = 31;
 		int n_long_bands = (gr_info->mixed_block_flag ? 2 : 0) << (int)(HDR_GET_MY_SAMPLE_RATE(h->header) == 2);
 
+		if (silent && h->mdct_idle[ch])
+		{
+			/* nothing coded, nothing left over from the last granule either: the output is zeroes, as grbuf already is */
+			continue;
+		}
+		/* an IMDCT of zeroes still outputs the last overlap, but leaves zeroes behind: the next one can be skipped */
+		h->mdct_idle[ch] = silent;
+		zero = 0;
+
 		if (gr_info->n_short_sfb)
 		{
 			aa_bands = n_long_bands - 1;
 			L3_reorder(s->grbuf[ch] + n_long_bands*18, s->syn[0], gr_info->sfbtab + gr_info->n_long_sfb);
 		}
 
-		L3_antialias(s->grbuf[ch], aa_bands);
-		L3_imdct_gr(s->grbuf[ch], h->mdct_overlap[ch], gr_info->block_type, n_long_bands);
-		L3_change_sign(s->grbuf[ch]);
+		if (nbands < 32)
+		{
+			/* the pruned bands stay zero from here on, and so does their IMDCT overlap */
+			memset(s->grbuf[ch] + 18*nbands, 0, sizeof(mp3d_real_t)*18*(32 - nbands));
+			memset(h->mdct_overlap[ch] + 9*nbands, 0, sizeof(mp3d_real_t)*9*(32 - nbands));
+			h->stats.bands_pruned += 32 - nbands;
+		}
+
+		L3_antialias(s->grbuf[ch], MINIMP3_MIN(aa_bands, nbands - 1));
+		L3_imdct_gr(s->grbuf[ch], h->mdct_overlap[ch], gr_info->block_type, n_long_bands, nbands);
+		L3_change_sign(s->grbuf[ch], nbands);
+	}
+	h->stats.granules++;
+	h->stats.channels += nrender;
+	h->stats.silent += zero;
+	h->silent = zero;
+
+	if (time_fold)
+	{
+		L3_fold_mono(s->grbuf[0], s->grbuf[1], 576, MINIMP3_MONO_MIX);
+		L3_fold_mono(h->mdct_overlap[0], h->mdct_overlap[1], 9*32, MINIMP3_MONO_MIX);
+		h->mdct_idle[0] &= h->mdct_idle[1];
 	}
 }
 
-static void mp3d_DCT_II(float *grbuf, int n)
+static void mp3d_DCT_II(mp3d_real_t *grbuf, int n)
 {
-	static const float g_sec[24] = {
-		10.19000816f,0.50060302f,0.50241929f,3.40760851f,0.50547093f,0.52249861f,2.05778098f,0.51544732f,0.56694406f,1.48416460f,0.53104258f,0.64682180f,1.16943991f,0.55310392f,0.78815460f,0.97256821f,0.58293498f,1.06067765f,0.83934963f,0.62250412f,1.72244716f,0.74453628f,0.67480832f,5.10114861f
+	static const mp3d_real_t g_sec[24] = {
+		MP3D_C(10.19000816f),MP3D_C(0.50060302f),MP3D_C(0.50241929f),MP3D_C(3.40760851f),MP3D_C(0.50547093f),MP3D_C(0.52249861f),MP3D_C(2.05778098f),MP3D_C(0.51544732f),MP3D_C(0.56694406f),MP3D_C(1.48416460f),MP3D_C(0.53104258f),MP3D_C(0.64682180f),MP3D_C(1.16943991f),MP3D_C(0.55310392f),MP3D_C(0.78815460f),MP3D_C(0.97256821f),MP3D_C(0.58293498f),MP3D_C(1.06067765f),MP3D_C(0.83934963f),MP3D_C(0.62250412f),MP3D_C(1.72244716f),MP3D_C(0.74453628f),MP3D_C(0.67480832f),MP3D_C(5.10114861f)
 	};
 	int i, k = 0;
 #if HAVE_SIMD
@@ -1376,26 +1957,26 @@ static void mp3d_DCT_II(float *grbuf, int n)
 #else /* MINIMP3_ONLY_SIMD */
 	for (; k < n; k++)
 	{
-		float t[4][8], *x, *y = grbuf + k;
+		mp3d_real_t t[4][8], *x, *y = grbuf + k;
 
 		for (x = t[0], i = 0; i < 8; i++, x++)
 		{
-			float x0 = y[i*18];
-			float x1 = y[(15 - i)*18];
-			float x2 = y[(16 + i)*18];
-			float x3 = y[(31 - i)*18];
-			float t0 = x0 + x3;
-			float t1 = x1 + x2;
-			float t2 = (x1 - x2)*g_sec[3*i + 0];
-			float t3 = (x0 - x3)*g_sec[3*i + 1];
+			mp3d_real_t x0 = y[i*18];
+			mp3d_real_t x1 = y[(15 - i)*18];
+			mp3d_real_t x2 = y[(16 + i)*18];
+			mp3d_real_t x3 = y[(31 - i)*18];
+			mp3d_real_t t0 = x0 + x3;
+			mp3d_real_t t1 = x1 + x2;
+			mp3d_real_t t2 = MP3D_MUL((x1 - x2), g_sec[3*i + 0]);
+			mp3d_real_t t3 = MP3D_MUL((x0 - x3), g_sec[3*i + 1]);
 			x[0] = t0 + t1;
-			x[8] = (t0 - t1)*g_sec[3*i + 2];
+			x[8] = MP3D_MUL((t0 - t1), g_sec[3*i + 2]);
 			x[16] = t3 + t2;
-			x[24] = (t3 - t2)*g_sec[3*i + 2];
+			x[24] = MP3D_MUL((t3 - t2), g_sec[3*i + 2]);
 		}
 		for (x = t[0], i = 0; i < 4; i++, x += 8)
 		{
-			float x0 = x[0], x1 = x[1], x2 = x[2], x3 = x[3], x4 = x[4], x5 = x[5], x6 = x[6], x7 = x[7], xt;
+			mp3d_real_t x0 = x[0], x1 = x[1], x2 = x[2], x3 = x[3], x4 = x[4], x5 = x[5], x6 = x[6], x7 = x[7], xt;
 			xt = x0 - x7; x0 += x7;
 			x7 = x1 - x6; x1 += x6;
 			x6 = x2 - x5; x2 += x5;
@@ -1403,21 +1984,21 @@ static void mp3d_DCT_II(float *grbuf, int n)
 			x4 = x0 - x3; x0 += x3;
 			x3 = x1 - x2; x1 += x2;
 			x[0] = x0 + x1;
-			x[4] = (x0 - x1)*0.70710677f;
+			x[4] = MP3D_MUL((x0 - x1), MP3D_C(0.70710677f));
 			x5 =  x5 + x6;
-			x6 = (x6 + x7)*0.70710677f;
+			x6 = MP3D_MUL((x6 + x7), MP3D_C(0.70710677f));
 			x7 =  x7 + xt;
-			x3 = (x3 + x4)*0.70710677f;
-			x5 -= x7*0.198912367f;  /* rotate by PI/8 */
-			x7 += x5*0.382683432f;
-			x5 -= x7*0.198912367f;
+			x3 = MP3D_MUL((x3 + x4), MP3D_C(0.70710677f));
+			x5 -= MP3D_MUL(x7, MP3D_C(0.198912367f));  /* rotate by PI/8 */
+			x7 += MP3D_MUL(x5, MP3D_C(0.382683432f));
+			x5 -= MP3D_MUL(x7, MP3D_C(0.198912367f));
 			x0 = xt - x6; xt += x6;
-			x[1] = (xt + x7)*0.50979561f;
-			x[2] = (x4 + x3)*0.54119611f;
-			x[3] = (x0 - x5)*0.60134488f;
-			x[5] = (x0 + x5)*0.89997619f;
-			x[6] = (x4 - x3)*1.30656302f;
-			x[7] = (xt - x7)*2.56291556f;
+			x[1] = MP3D_MUL((xt + x7), MP3D_C(0.50979561f));
+			x[2] = MP3D_MUL((x4 + x3), MP3D_C(0.54119611f));
+			x[3] = MP3D_MUL((x0 - x5), MP3D_C(0.60134488f));
+			x[5] = MP3D_MUL((x0 + x5), MP3D_C(0.89997619f));
+			x[6] = MP3D_MUL((x4 - x3), MP3D_C(1.30656302f));
+			x[7] = MP3D_MUL((xt - x7), MP3D_C(2.56291556f));
 
 		}
 		for (i = 0; i < 7; i++, y += 4*18)
@@ -1435,7 +2016,16 @@ static void mp3d_DCT_II(float *grbuf, int n)
 #endif /* MINIMP3_ONLY_SIMD */
 }
 
-#ifndef MINIMP3_FLOAT_OUTPUT
+#if defined(MINIMP3_FIXED_POINT)
+/* the synthesis window is integer, so the accumulator is Q24 pcm */
+static int16_t mp3d_scale_pcm(mp3d_acc_t sample)
+{
+	int64_t s = (sample + (1 << (MP3D_FRAC_BITS - 1))) >> MP3D_FRAC_BITS;
+	if (s >  32767) return (int16_t) 32767;
+	if (s < -32768) return (int16_t)-32768;
+	return (int16_t)s;
+}
+#elif !defined(MINIMP3_FLOAT_OUTPUT)
 static int16_t mp3d_scale_pcm(float sample)
 {
 #if HAVE_ARMV6
@@ -1457,38 +2047,56 @@ static float mp3d_scale_pcm(float sample)
 }
 #endif /* MINIMP3_FLOAT_OUTPUT */
 
-static void mp3d_synth_pair(mp3d_sample_t *pcm, int nch, const float *z)
+static void mp3d_store_pcm(const mp3dec_layout_t *layout, void *pcm, int ch, int n, mp3d_sample_t sample)
 {
-	float a;
-	a  = (z[14*64] - z[    0]) * 29;
-	a += (z[ 1*64] + z[13*64]) * 213;
-	a += (z[12*64] - z[ 2*64]) * 459;
-	a += (z[ 3*64] + z[11*64]) * 2037;
-	a += (z[10*64] - z[ 4*64]) * 5153;
-	a += (z[ 5*64] + z[ 9*64]) * 6574;
-	a += (z[ 8*64] - z[ 6*64]) * 37489;
-	a +=  z[ 7*64]             * 75038;
-	pcm[0] = mp3d_scale_pcm(a);
+	int at;
+	if (layout->offset[ch] < 0)
+	{
+		return;
+	}
+	at = ((n >> layout->shift) ^ layout->swap)*layout->stride + layout->offset[ch];
+#ifndef MINIMP3_FLOAT_OUTPUT
+	if (layout->format == MINIMP3_PCM_S32)
+	{
+		((int32_t *)pcm)[at] = (int32_t)sample*65536;
+		return;
+	}
+#endif /* MINIMP3_FLOAT_OUTPUT */
+	((mp3d_sample_t *)pcm)[at] = sample;
+}
+
+static void mp3d_synth_pair(void *pcm, const mp3dec_layout_t *layout, int ch, int n, const mp3d_real_t *z)
+{
+	mp3d_acc_t a;
+	a  = (mp3d_acc_t)(z[14*64] - z[    0]) * 29;
+	a += (mp3d_acc_t)(z[ 1*64] + z[13*64]) * 213;
+	a += (mp3d_acc_t)(z[12*64] - z[ 2*64]) * 459;
+	a += (mp3d_acc_t)(z[ 3*64] + z[11*64]) * 2037;
+	a += (mp3d_acc_t)(z[10*64] - z[ 4*64]) * 5153;
+	a += (mp3d_acc_t)(z[ 5*64] + z[ 9*64]) * 6574;
+	a += (mp3d_acc_t)(z[ 8*64] - z[ 6*64]) * 37489;
+	a += (mp3d_acc_t) z[ 7*64]             * 75038;
+	mp3d_store_pcm(layout, pcm, ch, n, mp3d_scale_pcm(a));
 
 	z += 2;
-	a  = z[14*64] * 104;
-	a += z[12*64] * 1567;
-	a += z[10*64] * 9727;
-	a += z[ 8*64] * 64019;
-	a += z[ 6*64] * -9975;
-	a += z[ 4*64] * -45;
-	a += z[ 2*64] * 146;
-	a += z[ 0*64] * -5;
-	pcm[16*nch] = mp3d_scale_pcm(a);
+	a  = (mp3d_acc_t)z[14*64] * 104;
+	a += (mp3d_acc_t)z[12*64] * 1567;
+	a += (mp3d_acc_t)z[10*64] * 9727;
+	a += (mp3d_acc_t)z[ 8*64] * 64019;
+	a += (mp3d_acc_t)z[ 6*64] * -9975;
+	a += (mp3d_acc_t)z[ 4*64] * -45;
+	a += (mp3d_acc_t)z[ 2*64] * 146;
+	a += (mp3d_acc_t)z[ 0*64] * -5;
+	mp3d_store_pcm(layout, pcm, ch, n + 16, mp3d_scale_pcm(a));
 }
 
-static void mp3d_synth(float *xl, mp3d_sample_t *dstl, int nch, float *lins)
+/* synthesizes output samples n to n + 63, or every (1 << layout->shift)-th of them */
+static void mp3d_synth(mp3d_real_t *xl, void *pcm, int n, int nch, mp3d_real_t *lins, const mp3dec_layout_t *layout)
 {
-	int i;
-	float *xr = xl + 576*(nch - 1);
-	mp3d_sample_t *dstr = dstl + (nch - 1);
+	int i, skip = (1 << layout->shift) - 1;
+	mp3d_real_t *xr = xl + 576*(nch - 1);
 
-	static const float g_win[] = {
+	static const mp3d_real_t g_win[] = {
 		-1,26,-31,208,218,401,-519,2063,2000,4788,-5517,7134,5959,35640,-39336,74992,
 		-1,24,-35,202,222,347,-581,2080,1952,4425,-5879,7640,5288,33791,-41176,74856,
 		-1,21,-38,196,225,294,-645,2087,1893,4063,-6237,8092,4561,31947,-43006,74630,
@@ -1505,8 +2113,8 @@ static void mp3d_synth(float *xl, mp3d_sample_t *dstl, int nch, float *lins)
 		-4,7,-91,117,177,-106,-1428,1698,402,545,-9416,9916,-7154,12980,-61289,66494,
 		-5,6,-97,111,163,-127,-1498,1634,185,288,-9585,9838,-8540,11455,-62684,65290
 	};
-	float *zlin = lins + 15*64;
-	const float *w = g_win;
+	mp3d_real_t *zlin = lins + 15*64;
+	const mp3d_real_t *w = g_win;
 
 	zlin[4*15]     = xl[18*16];
 	zlin[4*15 + 1] = xr[18*16];
@@ -1518,10 +2126,10 @@ static void mp3d_synth(float *xl, mp3d_sample_t *dstl, int nch, float *lins)
 	zlin[4*31 + 2] = xl[1];
 	zlin[4*31 + 3] = xr[1];
 
-	mp3d_synth_pair(dstr, nch, lins + 4*15 + 1);
-	mp3d_synth_pair(dstr + 32*nch, nch, lins + 4*15 + 64 + 1);
-	mp3d_synth_pair(dstl, nch, lins + 4*15);
-	mp3d_synth_pair(dstl + 32*nch, nch, lins + 4*15 + 64);
+	mp3d_synth_pair(pcm, layout, 1, n, lins + 4*15 + 1);
+	mp3d_synth_pair(pcm, layout, 1, n + 32, lins + 4*15 + 64 + 1);
+	mp3d_synth_pair(pcm, layout, 0, n, lins + 4*15);
+	mp3d_synth_pair(pcm, layout, 0, n + 32, lins + 4*15 + 64);
 
 #if HAVE_SIMD
 	if (have_simd()) for (i = 14; i >= 0; i--)
@@ -1539,6 +2147,11 @@ static void mp3d_synth(float *xl, mp3d_sample_t *dstl, int nch, float *lins)
         zlin[4*i + 64 + 1] = xr[1 + 18*(1 + i)];
         zlin[4*i - 64 + 2] = xl[18*(1 + i)];
         zlin[4*i - 64 + 3] = xr[18*(1 + i)];
+        if ((15 - i) & skip)
+        {
+            w += 16;
+            continue;
+        }
 
         V0(0) V2(1) V1(2) V2(3) V1(4) V2(5) V1(6) V2(7)
 
@@ -1549,28 +2162,28 @@ static void mp3d_synth(float *xl, mp3d_sample_t *dstl, int nch, float *lins)
             static const f4 g_min = { -32768.0f, -32768.0f, -32768.0f, -32768.0f };
             __m128i pcm8 = _mm_packs_epi32(_mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(a, g_max), g_min)),
                                            _mm_cvtps_epi32(_mm_max_ps(_mm_min_ps(b, g_max), g_min)));
-            dstr[(15 - i)*nch] = _mm_extract_epi16(pcm8, 1);
-            dstr[(17 + i)*nch] = _mm_extract_epi16(pcm8, 5);
-            dstl[(15 - i)*nch] = _mm_extract_epi16(pcm8, 0);
-            dstl[(17 + i)*nch] = _mm_extract_epi16(pcm8, 4);
-            dstr[(47 - i)*nch] = _mm_extract_epi16(pcm8, 3);
-            dstr[(49 + i)*nch] = _mm_extract_epi16(pcm8, 7);
-            dstl[(47 - i)*nch] = _mm_extract_epi16(pcm8, 2);
-            dstl[(49 + i)*nch] = _mm_extract_epi16(pcm8, 6);
+            mp3d_store_pcm(layout, pcm, 1, n + 15 - i, _mm_extract_epi16(pcm8, 1));
+            mp3d_store_pcm(layout, pcm, 1, n + 17 + i, _mm_extract_epi16(pcm8, 5));
+            mp3d_store_pcm(layout, pcm, 0, n + 15 - i, _mm_extract_epi16(pcm8, 0));
+            mp3d_store_pcm(layout, pcm, 0, n + 17 + i, _mm_extract_epi16(pcm8, 4));
+            mp3d_store_pcm(layout, pcm, 1, n + 47 - i, _mm_extract_epi16(pcm8, 3));
+            mp3d_store_pcm(layout, pcm, 1, n + 49 + i, _mm_extract_epi16(pcm8, 7));
+            mp3d_store_pcm(layout, pcm, 0, n + 47 - i, _mm_extract_epi16(pcm8, 2));
+            mp3d_store_pcm(layout, pcm, 0, n + 49 + i, _mm_extract_epi16(pcm8, 6));
 #else /* HAVE_SSE */
             int16x4_t pcma, pcmb;
             a = VADD(a, VSET(0.5f));
             b = VADD(b, VSET(0.5f));
             pcma = vqmovn_s32(vqaddq_s32(vcvtq_s32_f32(a), vreinterpretq_s32_u32(vcltq_f32(a, VSET(0)))));
             pcmb = vqmovn_s32(vqaddq_s32(vcvtq_s32_f32(b), vreinterpretq_s32_u32(vcltq_f32(b, VSET(0)))));
-            vst1_lane_s16(dstr + (15 - i)*nch, pcma, 1);
-            vst1_lane_s16(dstr + (17 + i)*nch, pcmb, 1);
-            vst1_lane_s16(dstl + (15 - i)*nch, pcma, 0);
-            vst1_lane_s16(dstl + (17 + i)*nch, pcmb, 0);
-            vst1_lane_s16(dstr + (47 - i)*nch, pcma, 3);
-            vst1_lane_s16(dstr + (49 + i)*nch, pcmb, 3);
-            vst1_lane_s16(dstl + (47 - i)*nch, pcma, 2);
-            vst1_lane_s16(dstl + (49 + i)*nch, pcmb, 2);
+            mp3d_store_pcm(layout, pcm, 1, n + 15 - i, vget_lane_s16(pcma, 1));
+            mp3d_store_pcm(layout, pcm, 1, n + 17 + i, vget_lane_s16(pcmb, 1));
+            mp3d_store_pcm(layout, pcm, 0, n + 15 - i, vget_lane_s16(pcma, 0));
+            mp3d_store_pcm(layout, pcm, 0, n + 17 + i, vget_lane_s16(pcmb, 0));
+            mp3d_store_pcm(layout, pcm, 1, n + 47 - i, vget_lane_s16(pcma, 3));
+            mp3d_store_pcm(layout, pcm, 1, n + 49 + i, vget_lane_s16(pcmb, 3));
+            mp3d_store_pcm(layout, pcm, 0, n + 47 - i, vget_lane_s16(pcma, 2));
+            mp3d_store_pcm(layout, pcm, 0, n + 49 + i, vget_lane_s16(pcmb, 2));
 #endif /* HAVE_SSE */
 
 #else /* MINIMP3_FLOAT_OUTPUT */
@@ -1579,23 +2192,23 @@ static void mp3d_synth(float *xl, mp3d_sample_t *dstl, int nch, float *lins)
             a = VMUL(a, g_scale);
             b = VMUL(b, g_scale);
 #if HAVE_SSE
-            _mm_store_ss(dstr + (15 - i)*nch, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1)));
-            _mm_store_ss(dstr + (17 + i)*nch, _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1)));
-            _mm_store_ss(dstl + (15 - i)*nch, _mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 0)));
-            _mm_store_ss(dstl + (17 + i)*nch, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)));
-            _mm_store_ss(dstr + (47 - i)*nch, _mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3)));
-            _mm_store_ss(dstr + (49 + i)*nch, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3)));
-            _mm_store_ss(dstl + (47 - i)*nch, _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2)));
-            _mm_store_ss(dstl + (49 + i)*nch, _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2)));
+            mp3d_store_pcm(layout, pcm, 1, n + 15 - i, _mm_cvtss_f32(_mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1))));
+            mp3d_store_pcm(layout, pcm, 1, n + 17 + i, _mm_cvtss_f32(_mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1))));
+            mp3d_store_pcm(layout, pcm, 0, n + 15 - i, _mm_cvtss_f32(_mm_shuffle_ps(a, a, _MM_SHUFFLE(0, 0, 0, 0))));
+            mp3d_store_pcm(layout, pcm, 0, n + 17 + i, _mm_cvtss_f32(_mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0))));
+            mp3d_store_pcm(layout, pcm, 1, n + 47 - i, _mm_cvtss_f32(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3))));
+            mp3d_store_pcm(layout, pcm, 1, n + 49 + i, _mm_cvtss_f32(_mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3))));
+            mp3d_store_pcm(layout, pcm, 0, n + 47 - i, _mm_cvtss_f32(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 2, 2, 2))));
+            mp3d_store_pcm(layout, pcm, 0, n + 49 + i, _mm_cvtss_f32(_mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2))));
 #else /* HAVE_SSE */
-            vst1q_lane_f32(dstr + (15 - i)*nch, a, 1);
-            vst1q_lane_f32(dstr + (17 + i)*nch, b, 1);
-            vst1q_lane_f32(dstl + (15 - i)*nch, a, 0);
-            vst1q_lane_f32(dstl + (17 + i)*nch, b, 0);
-            vst1q_lane_f32(dstr + (47 - i)*nch, a, 3);
-            vst1q_lane_f32(dstr + (49 + i)*nch, b, 3);
-            vst1q_lane_f32(dstl + (47 - i)*nch, a, 2);
-            vst1q_lane_f32(dstl + (49 + i)*nch, b, 2);
+            mp3d_store_pcm(layout, pcm, 1, n + 15 - i, vgetq_lane_f32(a, 1));
+            mp3d_store_pcm(layout, pcm, 1, n + 17 + i, vgetq_lane_f32(b, 1));
+            mp3d_store_pcm(layout, pcm, 0, n + 15 - i, vgetq_lane_f32(a, 0));
+            mp3d_store_pcm(layout, pcm, 0, n + 17 + i, vgetq_lane_f32(b, 0));
+            mp3d_store_pcm(layout, pcm, 1, n + 47 - i, vgetq_lane_f32(a, 3));
+            mp3d_store_pcm(layout, pcm, 1, n + 49 + i, vgetq_lane_f32(b, 3));
+            mp3d_store_pcm(layout, pcm, 0, n + 47 - i, vgetq_lane_f32(a, 2));
+            mp3d_store_pcm(layout, pcm, 0, n + 49 + i, vgetq_lane_f32(b, 2));
 #endif /* HAVE_SSE */
 #endif /* MINIMP3_FLOAT_OUTPUT */
         }
@@ -1606,11 +2219,11 @@ static void mp3d_synth(float *xl, mp3d_sample_t *dstl, int nch, float *lins)
 #else /* MINIMP3_ONLY_SIMD */
 	for (i = 14; i >= 0; i--)
 	{
-#define LOAD(k) float w0 = *w++; float w1 = *w++; float *vz = &zlin[4*i - k*64]; float *vy = &zlin[4*i - (15 - k)*64];
+#define LOAD(k) mp3d_acc_t w0 = *w++; mp3d_acc_t w1 = *w++; mp3d_real_t *vz = &zlin[4*i - k*64]; mp3d_real_t *vy = &zlin[4*i - (15 - k)*64];
 #define S0(k) { int j; LOAD(k); for (j = 0; j < 4; j++) b[j]  = vz[j]*w1 + vy[j]*w0, a[j]  = vz[j]*w0 - vy[j]*w1; }
 #define S1(k) { int j; LOAD(k); for (j = 0; j < 4; j++) b[j] += vz[j]*w1 + vy[j]*w0, a[j] += vz[j]*w0 - vy[j]*w1; }
 #define S2(k) { int j; LOAD(k); for (j = 0; j < 4; j++) b[j] += vz[j]*w1 + vy[j]*w0, a[j] += vy[j]*w1 - vz[j]*w0; }
-		float a[4], b[4];
+		mp3d_acc_t a[4], b[4];
 
 		zlin[4*i]     = xl[18*(31 - i)];
 		zlin[4*i + 1] = xr[18*(31 - i)];
@@ -1620,34 +2233,62 @@ static void mp3d_synth(float *xl, mp3d_sample_t *dstl, int nch, float *lins)
 		zlin[4*(i + 16) + 1] = xr[1 + 18*(1 + i)];
 		zlin[4*(i - 16) + 2] = xl[18*(1 + i)];
 		zlin[4*(i - 16) + 3] = xr[18*(1 + i)];
+		if ((15 - i) & skip)
+		{
+			w += 16;  /* none of this iteration's samples are wanted: n + 15 - i, n + 17 + i... are all alike */
+			continue;
+		}
 
 		S0(0) S2(1) S1(2) S2(3) S1(4) S2(5) S1(6) S2(7)
 
-		dstr[(15 - i)*nch] = mp3d_scale_pcm(a[1]);
-		dstr[(17 + i)*nch] = mp3d_scale_pcm(b[1]);
-		dstl[(15 - i)*nch] = mp3d_scale_pcm(a[0]);
-		dstl[(17 + i)*nch] = mp3d_scale_pcm(b[0]);
-		dstr[(47 - i)*nch] = mp3d_scale_pcm(a[3]);
-		dstr[(49 + i)*nch] = mp3d_scale_pcm(b[3]);
-		dstl[(47 - i)*nch] = mp3d_scale_pcm(a[2]);
-		dstl[(49 + i)*nch] = mp3d_scale_pcm(b[2]);
+		mp3d_store_pcm(layout, pcm, 1, n + 15 - i, mp3d_scale_pcm(a[1]));
+		mp3d_store_pcm(layout, pcm, 1, n + 17 + i, mp3d_scale_pcm(b[1]));
+		mp3d_store_pcm(layout, pcm, 0, n + 15 - i, mp3d_scale_pcm(a[0]));
+		mp3d_store_pcm(layout, pcm, 0, n + 17 + i, mp3d_scale_pcm(b[0]));
+		mp3d_store_pcm(layout, pcm, 1, n + 47 - i, mp3d_scale_pcm(a[3]));
+		mp3d_store_pcm(layout, pcm, 1, n + 49 + i, mp3d_scale_pcm(b[3]));
+		mp3d_store_pcm(layout, pcm, 0, n + 47 - i, mp3d_scale_pcm(a[2]));
+		mp3d_store_pcm(layout, pcm, 0, n + 49 + i, mp3d_scale_pcm(b[2]));
 	}
 #endif /* MINIMP3_ONLY_SIMD */
 }
 
-static void mp3d_synth_granule(float *qmf_state, float *grbuf, int nbands, int nch, mp3d_sample_t *pcm, float *lins)
+/* what mp3d_synth_granule() stores for a granule of zeroes, when qmf_state is all zeroes too */
+static void mp3d_synth_silence(void *pcm, int nsamples, int nch, const mp3dec_layout_t *layout)
+{
+	int i, ch;
+	for (i = 0; i < nsamples; i += 1 << layout->shift)
+	{
+		for (ch = 0; ch < nch; ch++)
+		{
+			mp3d_store_pcm(layout, pcm, ch, i, 0);
+		}
+	}
+}
+
+static void mp3d_synth_granule(mp3d_real_t *qmf_state, mp3d_real_t *grbuf, int nbands, int nch, void *pcm, mp3d_real_t *lins, const mp3dec_layout_t *layout)
 {
 	int i;
+	mp3dec_layout_t l = *layout;
+	if (nch == 1)
+	{
+		l.offset[1] = -1;  /* mp3d_synth() runs the same channel on both sides, store it once */
+	}
 	for (i = 0; i < nch; i++)
 	{
+		if (l.shift)
+		{
+			/* what's above the new nyquist would alias: leave it out */
+			memset(grbuf + 576*i + 18*(32 >> l.shift), 0, sizeof(mp3d_real_t)*18*(32 - (32 >> l.shift)));
+		}
 		mp3d_DCT_II(grbuf + 576*i, nbands);
 	}
 
-	memcpy(lins, qmf_state, sizeof(float)*15*64);
+	memcpy(lins, qmf_state, sizeof(mp3d_real_t)*15*64);
 
 	for (i = 0; i < nbands; i += 2)
 	{
-		mp3d_synth(grbuf + i, pcm + 32*nch*i, nch, lins + i*64);
+		mp3d_synth(grbuf + i, pcm, 32*i, nch, lins + i*64, &l);
 	}
 #ifndef MINIMP3_NONSTANDARD_BUT_LOGICAL
 	if (nch == 1)
@@ -1659,24 +2300,27 @@ static void mp3d_synth_granule(float *qmf_state, float *grbuf, int nbands, int n
     } else
 #endif /* MINIMP3_NONSTANDARD_BUT_LOGICAL */
 	{
-		memcpy(qmf_state, lins + nbands*64, sizeof(float)*15*64);
+		memcpy(qmf_state, lins + nbands*64, sizeof(mp3d_real_t)*15*64);
 	}
 }
 
-static int mp3d_match_frame(const uint8_t *hdr, int mp3_bytes, int frame_bytes)
+static int mp3d_match_frame(const uint8_t *hdr, int mp3_bytes, int frame_bytes, int min_matches)
 {
 	int i, nmatch;
 	for (i = 0, nmatch = 0; nmatch < MAX_FRAME_SYNC_MATCHES; nmatch++)
 	{
 		i += hdr_frame_bytes(hdr + i, frame_bytes) + hdr_padding(hdr + i);
 		if (i + HDR_SIZE > mp3_bytes)
-			return nmatch > 0;
+			return nmatch >= min_matches;
 		if (!hdr_compare(hdr, hdr + i))
 			return 0;
 	}
 	return 1;
 }
 
+/* returns the offset of the first frame, or, with *ptr_frame_bytes = 0, how many bytes are certainly not the start of
+ * one: a candidate which can't be checked yet because the data ends too early is left for the next call, along with
+ * the last few bytes. *free_format_bytes is only updated when a frame is found, so it's remembered across calls */
 static int mp3d_find_frame(const uint8_t *mp3, int mp3_bytes, int *free_format_bytes, int *ptr_frame_bytes)
 {
 	int i, k;
@@ -1684,9 +2328,16 @@ static int mp3d_find_frame(const uint8_t *mp3, int mp3_bytes, int *free_format_b
 	{
 		if (hdr_valid(mp3))
 		{
-			int frame_bytes = hdr_frame_bytes(mp3, *free_format_bytes);
+			int free_format = *free_format_bytes;
+			int frame_bytes = hdr_frame_bytes(mp3, free_format);
 			int frame_and_padding = frame_bytes + hdr_padding(mp3);
 
+			if (HDR_IS_FREE_FORMAT(mp3) && frame_bytes && i + frame_and_padding + HDR_SIZE <= mp3_bytes &&
+			    !hdr_compare(mp3, mp3 + frame_and_padding))
+			{
+				/* the free format frame size we remember doesn't fit here, look for it again */
+				frame_bytes = frame_and_padding = 0;
+			}
 			for (k = HDR_SIZE; !frame_bytes && k < MAX_FREE_FORMAT_FRAME_SIZE && i + 2*k < mp3_bytes - HDR_SIZE; k++)
 			{
 				if (hdr_compare(mp3, mp3 + k))
@@ -1697,33 +2348,86 @@ static int mp3d_find_frame(const uint8_t *mp3, int mp3_bytes, int *free_format_b
 						continue;
 					frame_and_padding = k;
 					frame_bytes = fb;
-					*free_format_bytes = fb;
+					free_format = fb;
 				}
 			}
 			if ((frame_bytes && i + frame_and_padding <= mp3_bytes &&
-			     mp3d_match_frame(mp3, mp3_bytes - i, frame_bytes)) ||
+			     mp3d_match_frame(mp3, mp3_bytes - i, frame_bytes, 1)) ||
 			    (!i && frame_and_padding == mp3_bytes))
 			{
+				*free_format_bytes = free_format;
 				*ptr_frame_bytes = frame_and_padding;
 				return i;
 			}
-			*free_format_bytes = 0;
+			if ((frame_bytes && i + frame_and_padding + HDR_SIZE > mp3_bytes) ||
+			    (!frame_bytes && k < MAX_FREE_FORMAT_FRAME_SIZE))
+			{
+				/* might be a frame, we'll know with more data */
+				break;
+			}
 		}
 	}
 	*ptr_frame_bytes = 0;
-	return mp3_bytes;
+	return MINIMP3_MAX(i, 0);
+}
+
+int mp3dec_find_sync(const uint8_t *mp3, int mp3_bytes, int min_matches)
+{
+	int i;
+	for (i = 0; i < mp3_bytes - HDR_SIZE; i++)
+	{
+		int frame_bytes = hdr_valid(mp3 + i) ? hdr_frame_bytes(mp3 + i, 0) : 0;
+		if (frame_bytes && mp3d_match_frame(mp3 + i, mp3_bytes - i, frame_bytes, min_matches))
+		{
+			return i;
+		}
+	}
+	return -1;
 }
 
 void mp3dec_init(mp3dec_t *dec)
 {
-	dec->header[0] = 0;
+	memset(dec, 0, sizeof(mp3dec_t));
+	dec->mono = MINIMP3_MONO_OFF;
+	dec->max_bands = 32;
+#ifdef MINIMP3_WIDE_HUFFMAN
+	static int wide_ready;  /* the tables are shared by all the decoders: see the note on the prototype */
+	if (!wide_ready)
+	{
+		L3_huffman_build_wide();
+		wide_ready = 1;
+	}
+#endif /* MINIMP3_WIDE_HUFFMAN */
 }
 
-int mp3dec_decode_frame(mp3dec_t *dec, const uint8_t *mp3, int mp3_bytes, mp3d_sample_t *pcm, mp3dec_frame_info_t *info)
+void mp3dec_set_mono(mp3dec_t *dec, int policy)
+{
+	dec->mono = policy;
+}
+
+void mp3dec_set_cutoff(mp3dec_t *dec, int cutoff_hz, int max_bands)
+{
+	dec->cutoff_hz = cutoff_hz;
+	dec->max_bands = MINIMP3_MAX(1, MINIMP3_MIN(max_bands, 32));
+}
+
+void mp3dec_get_stats(const mp3dec_t *dec, mp3dec_stats_t *stats)
 {
-	int i = 0, igr, frame_size = 0, success = 1;
+	*stats = dec->stats;
+}
+
+void mp3dec_discontinuity(mp3dec_t *dec)
+{
+	dec->reserv = 0;
+	dec->free_format_bytes = 0;
+}
+
+/* finds the frame to decode, resynchronizing if needed, and fills info. returns the frame size, or 0 with
+ * info->frame_bytes set to how many bytes can be skipped */
+static int mp3d_sync_frame(mp3dec_t *dec, const uint8_t *mp3, int mp3_bytes, mp3dec_frame_info_t *info)
+{
+	int i = 0, frame_size = 0;
 	const uint8_t *hdr;
-	bs_t bs_frame[1];
 
 	if (mp3_bytes > 4 && dec->header[0] == 0xff && hdr_compare(dec->header, mp3))
 	{
@@ -1735,13 +2439,31 @@ int mp3dec_decode_frame(mp3dec_t *dec, const uint8_t *mp3, int mp3_bytes, mp3d_s
 	}
 	if (!frame_size)
 	{
-		memset(dec, 0, sizeof(mp3dec_t));
+		/* resync. the decoder state is kept as long as it still makes sense, so that a glitch in the stream costs a
+		 * frame or two rather than the whole bit reservoir and a pop in the filterbanks */
 		i = mp3d_find_frame(mp3, mp3_bytes, &dec->free_format_bytes, &frame_size);
 		if (!frame_size || i + frame_size > mp3_bytes)
 		{
+			if (i)
+			{
+				dec->reserv = 0;
+			}
 			info->frame_bytes = i;
 			return 0;
 		}
+		if (!hdr_compare(dec->header, mp3 + i))
+		{
+			/* first frame ever, or a different stream altogether */
+			memset(dec->mdct_overlap, 0, sizeof(dec->mdct_overlap));
+			memset(dec->qmf_state, 0, sizeof(dec->qmf_state));
+			dec->mdct_idle[0] = dec->mdct_idle[1] = dec->qmf_idle = 1;
+			dec->qmf_reset = 1;
+			dec->reserv = 0;
+		} else if (i)
+		{
+			/* bytes were skipped, the reservoir is unlikely to be what this frame refers to */
+			dec->reserv = 0;
+		}
 	}
 
 	hdr = mp3 + i;
@@ -1752,6 +2474,24 @@ int mp3dec_decode_frame(mp3dec_t *dec, const uint8_t *mp3, int mp3_bytes, mp3d_s
 	info->hz = hdr_sample_rate_hz(hdr);
 	info->layer = 4 - HDR_GET_LAYER(hdr);
 	info->bitrate_kbps = hdr_bitrate_kbps(hdr);
+	return frame_size;
+}
+
+int mp3dec_decode_frame(mp3dec_t *dec, const uint8_t *mp3, int mp3_bytes, mp3d_sample_t *pcm, mp3dec_frame_info_t *info)
+{
+	int igr, frame_size, success = 1, out_nch;
+	const uint8_t *hdr;
+	bs_t bs_frame[1];
+	mp3dec_layout_t layout = { 0, { 0, 1 }, 0, MINIMP3_PCM_S16, 0 };
+
+	frame_size = mp3d_sync_frame(dec, mp3, mp3_bytes, info);
+	if (!frame_size)
+	{
+		return 0;
+	}
+	hdr = mp3 + info->frame_offset;
+	out_nch = dec->mono ? 1 : info->channels;
+	layout.stride = out_nch;
 
 	if (!pcm)
 	{
@@ -1769,17 +2509,24 @@ int mp3dec_decode_frame(mp3dec_t *dec, const uint8_t *mp3, int mp3_bytes, mp3d_s
 		int main_data_begin = L3_read_side_info(bs_frame, dec->scratch.gr_info, hdr);
 		if (main_data_begin < 0 || bs_frame->pos > bs_frame->limit)
 		{
-			mp3dec_init(dec);
+			dec->header[0] = 0;
+			dec->reserv = 0;
 			return 0;
 		}
 		success = L3_restore_reservoir(dec, bs_frame, &dec->scratch, main_data_begin);
 		if (success)
 		{
-			for (igr = 0; igr < (HDR_TEST_MPEG1(hdr) ? 2 : 1); igr++, pcm += 576*info->channels)
+			for (igr = 0; igr < (HDR_TEST_MPEG1(hdr) ? 2 : 1); igr++, pcm += 576*out_nch)
 			{
-				memset(dec->scratch.grbuf[0], 0, 576*2*sizeof(float));
+				memset(dec->scratch.grbuf[0], 0, 576*2*sizeof(mp3d_real_t));
 				L3_decode(dec, &dec->scratch, dec->scratch.gr_info + igr*info->channels, info->channels);
-				mp3d_synth_granule(dec->qmf_state, dec->scratch.grbuf[0], 18, info->channels, pcm, dec->scratch.syn[0]);
+				if (dec->silent && dec->qmf_idle)
+				{
+					mp3d_synth_silence(pcm, 576, out_nch, &layout);
+					continue;
+				}
+				mp3d_synth_granule(dec->qmf_state, dec->scratch.grbuf[0], 18, out_nch, pcm, dec->scratch.syn[0], &layout);
+				dec->qmf_idle = dec->silent;
 			}
 		}
 		L3_save_reservoir(dec, &dec->scratch);
@@ -1788,6 +2535,7 @@ int mp3dec_decode_frame(mp3dec_t *dec, const uint8_t *mp3, int mp3_bytes, mp3d_s
 #ifdef MINIMP3_ONLY_MP3
 		return 0;
 #else /* MINIMP3_ONLY_MP3 */
+		int i;
 		L12_read_scale_info(hdr, bs_frame, dec->sci);
 
         memset(dec->scratch.grbuf[0], 0, 576*2*sizeof(float));
@@ -1797,13 +2545,19 @@ int mp3dec_decode_frame(mp3dec_t *dec, const uint8_t *mp3, int mp3_bytes, mp3d_s
             {
                 i = 0;
                 L12_apply_scf_384(dec->sci, dec->sci->scf + igr, dec->scratch.grbuf[0]);
-                mp3d_synth_granule(dec->qmf_state, dec->scratch.grbuf[0], 12, info->channels, pcm, dec->scratch.syn[0]);
+                if (info->channels == 2)
+                {
+                    L3_fold_mono(dec->scratch.grbuf[0], dec->scratch.grbuf[1], 576, dec->mono);
+                }
+                mp3d_synth_granule(dec->qmf_state, dec->scratch.grbuf[0], 12, out_nch, pcm, dec->scratch.syn[0], &layout);
+                dec->qmf_idle = 0;
                 memset(dec->scratch.grbuf[0], 0, 576*2*sizeof(float));
-                pcm += 384*info->channels;
+                pcm += 384*out_nch;
             }
             if (bs_frame->pos > bs_frame->limit)
             {
-                mp3dec_init(dec);
+                dec->header[0] = 0;
+                dec->reserv = 0;
                 return 0;
             }
         }
@@ -1812,6 +2566,91 @@ int mp3dec_decode_frame(mp3dec_t *dec, const uint8_t *mp3, int mp3_bytes, mp3d_s
 	return success*hdr_frame_samples(dec->header);
 }
 
+int mp3dec_decode_frame_front(mp3dec_t *dec, const uint8_t *mp3, int mp3_bytes, mp3dec_frame_info_t *info)
+{
+	int frame_size, main_data_begin;
+	const uint8_t *hdr;
+	bs_t bs_frame[1];
+
+	dec->granules = dec->granule_next = 0;
+	frame_size = mp3d_sync_frame(dec, mp3, mp3_bytes, info);
+	if (!frame_size || info->layer != 3)
+	{
+		return 0;
+	}
+	hdr = mp3 + info->frame_offset;
+
+	bs_init(bs_frame, hdr + HDR_SIZE, frame_size - HDR_SIZE);
+	if (HDR_IS_CRC(hdr))
+	{
+		get_bits(bs_frame, 16);
+	}
+	main_data_begin = L3_read_side_info(bs_frame, dec->scratch.gr_info, hdr);
+	if (main_data_begin < 0 || bs_frame->pos > bs_frame->limit)
+	{
+		dec->header[0] = 0;
+		dec->reserv = 0;
+		return 0;
+	}
+	/* from here on, everything comes from the main data buffer: the caller can let go of the frame */
+	if (!L3_restore_reservoir(dec, bs_frame, &dec->scratch, main_data_begin))
+	{
+		L3_save_reservoir(dec, &dec->scratch);
+		return 0;
+	}
+	dec->granules = HDR_TEST_MPEG1(hdr) ? 2 : 1;
+	return dec->granules;
+}
+
+void mp3dec_decode_granule(mp3dec_t *dec, mp3dec_granule_t *gr)
+{
+	int ch, nch = HDR_IS_MONO(dec->header) ? 1 : 2;
+	mp3dec_scratch_t *s = &dec->scratch;
+
+	memset(s->grbuf[0], 0, 576*2*sizeof(mp3d_real_t));
+	L3_decode(dec, s, s->gr_info + dec->granule_next*nch, nch);
+	if (++dec->granule_next == dec->granules)
+	{
+		L3_save_reservoir(dec, s);
+	}
+
+	gr->channels = MINIMP3_MIN(dec->mono ? 1 : nch, MINIMP3_GRANULE_CHANNELS);
+	gr->hz = hdr_sample_rate_hz(dec->header);
+	gr->reset = dec->qmf_reset;
+	gr->silent = dec->silent;
+	dec->qmf_reset = 0;
+	for (ch = 0; ch < gr->channels; ch++)
+	{
+		memcpy(gr->buf[ch], s->grbuf[ch], sizeof(gr->buf[ch]));
+	}
+}
+
+void mp3dec_synth_init(mp3dec_synth_t *synth)
+{
+	memset(synth, 0, sizeof(mp3dec_synth_t));
+	synth->idle = 1;
+}
+
+void mp3dec_synth_granule(mp3dec_synth_t *synth, mp3dec_granule_t *gr, void *pcm)
+{
+	mp3dec_layout_t packed = { 0, { 0, 1 }, 0, MINIMP3_PCM_S16, 0 };
+	const mp3dec_layout_t *layout = synth->layout.stride ? &synth->layout : &packed;
+	if (gr->reset)
+	{
+		memset(synth->qmf_state, 0, sizeof(synth->qmf_state));
+		synth->idle = 1;
+	}
+	packed.stride = gr->channels;
+	if (gr->silent && synth->idle)
+	{
+		mp3d_synth_silence(pcm, 576, gr->channels, layout);
+		return;
+	}
+	mp3d_synth_granule(synth->qmf_state, gr->buf[0], 18, gr->channels, pcm, synth->syn[0], layout);
+	/* the filterbank's state is the last 15 slots of this granule: after a silent one, it's all zeroes */
+	synth->idle = gr->silent;
+}
+
 #ifdef MINIMP3_FLOAT_OUTPUT
 void mp3dec_f32_to_s16(const float *in, int16_t *out, int num_samples)
 {
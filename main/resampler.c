@@ -0,0 +1,145 @@
+#include <math.h>
+#include <string.h>
+
+#include "resampler.h"
+
+/* modified Bessel function of the first kind, order 0, for the Kaiser window */
+static double resampler__i0(double x) {
+	double sum = 1, term = 1;
+	for (int k = 1; term > sum * 1e-12; k++) {
+		term *= (x / (2 * k)) * (x / (2 * k));
+		sum += term;
+	}
+	return sum;
+}
+
+static void resampler__design(struct resampler *r, double cutoff, double beta) {
+	int taps = r->taps;
+	double i0_beta = resampler__i0(beta);
+
+	for (int p = 0; p <= RESAMPLER_PHASES; p++) {
+		int16_t *row = r->coefs + p * taps;
+		double h[RESAMPLER_MAX_TAPS], sum = 0;
+
+		/* tap k is the input sample at k - (taps/2 - 1) - p/PHASES from the output */
+		for (int k = 0; k < taps; k++) {
+			double t = k - (taps / 2 - 1) - (double)p / RESAMPLER_PHASES;
+			double x = t / (taps / 2.0);
+			double window = x * x < 1 ? resampler__i0(beta * sqrt(1 - x * x)) / i0_beta : 0;
+			double sinc = t == 0 ? 1 : sin(M_PI * cutoff * t) / (M_PI * cutoff * t);
+			h[k] = cutoff * sinc * window;
+			sum += h[k];
+		}
+
+		/* unity gain at DC for every phase, exactly, in spite of the rounding: the error goes to the biggest tap */
+		int total = 0, biggest = 0;
+		for (int k = 0; k < taps; k++) {
+			row[k] = (int16_t)lrint(h[k] / sum * 32768);
+			total += row[k];
+			if (row[k] > row[biggest])
+				biggest = k;
+		}
+		row[biggest] += 32768 - total;
+	}
+}
+
+static void resampler__update_step(struct resampler *r) {
+	r->step = (uint64_t)((double)r->in_hz / r->out_hz * (1 + r->ppm * 1e-6) * 4294967296.0 + 0.5);
+}
+
+void resampler_init(struct resampler *r, int taps, uint32_t in_hz, uint32_t out_hz) {
+	r->taps = taps > RESAMPLER_MAX_TAPS ? RESAMPLER_MAX_TAPS : taps;
+	r->swap = 0;
+	r->ppm = 0;
+	r->pos = 0;
+	/* start with the filter full of silence, so the first output sample is the first input one */
+	r->len = r->taps / 2 - 1;
+	memset(r->buf, 0, sizeof(r->buf));
+	r->cutoff = -1;  /* nothing designed yet */
+	resampler_set_rate(r, in_hz, out_hz);
+}
+
+void resampler_set_rate(struct resampler *r, uint32_t in_hz, uint32_t out_hz) {
+	/* Kaiser's formulas, for the stopband attenuation the filter length can afford: about 45, 58 and 70 dB at 8, 16
+	 * and 32 taps. the more attenuation, the wider the transition band (as a fraction of the nyquist) */
+	double attenuation = 45 + 12.5 * log2(r->taps / 8.0);
+	double beta = attenuation > 50 ? 0.1102 * (attenuation - 8.7) :
+	              attenuation > 21 ? 0.5842 * pow(attenuation - 21, 0.4) + 0.07886 * (attenuation - 21) : 0;
+	double width = 2 * (attenuation - 7.95) / (14.36 * r->taps);
+	/* the cutoff, as a fraction of the input's nyquist. going up (or not at all), it's always the same: just below the
+	 * input's nyquist, the closer the longer the filter. going down, the stopband has to start at the output's
+	 * nyquist, or what's above it would alias */
+	float cutoff = (float)(out_hz >= in_hz ? 1 - 2.0 / r->taps : (double)out_hz / in_hz - width / 2);
+
+	r->in_hz = in_hz;
+	r->out_hz = out_hz;
+	if (cutoff != r->cutoff) {
+		resampler__design(r, cutoff, beta);
+		r->cutoff = cutoff;
+	}
+	resampler__update_step(r);
+}
+
+void resampler_set_ppm(struct resampler *r, float ppm) {
+	r->ppm = ppm;
+	resampler__update_step(r);
+}
+
+size_t resampler_write(struct resampler *r, const int16_t *in, size_t n) {
+	/* drop what the filter has gone past */
+	size_t used = (size_t)(r->pos >> 32);
+	if (used > r->len)
+		used = r->len;
+	memmove(r->buf, r->buf + used, (r->len - used) * sizeof(int16_t));
+	r->len -= used;
+	r->pos -= (uint64_t)used << 32;
+
+	size_t room = sizeof(r->buf) / sizeof(r->buf[0]) - r->len;
+	if (n > room)
+		n = room;
+	memcpy(r->buf + r->len, in, n * sizeof(int16_t));
+	r->len += n;
+	return n;
+}
+
+size_t resampler_available(const struct resampler *r) {
+	if (r->len < (size_t)r->taps)
+		return 0;
+
+	/* the filter can start at any position up to len - taps, fraction included */
+	uint64_t end = (uint64_t)(r->len - r->taps + 1) << 32;
+	if (r->pos >= end)
+		return 0;
+	return (size_t)((end - 1 - r->pos) / r->step) + 1;
+}
+
+size_t resampler_read(struct resampler *r, int16_t *out, size_t n) {
+	size_t available = resampler_available(r);
+	if (n > available)
+		n = available;
+	if (r->swap)
+		n &= ~(size_t)1;  /* the pairs must be whole */
+
+	int taps = r->taps;
+	uint64_t pos = r->pos, step = r->step;
+	for (size_t i = 0; i < n; i++) {
+		const int16_t *x = r->buf + (pos >> 32);
+		uint32_t frac = (uint32_t)pos;
+		const int16_t *c0 = r->coefs + (frac >> (32 - RESAMPLER_PHASE_BITS)) * taps;
+		const int16_t *c1 = c0 + taps;
+		int32_t a0 = 0, a1 = 0;
+
+		for (int k = 0; k < taps; k++) {
+			a0 += x[k] * c0[k];
+			a1 += x[k] * c1[k];
+		}
+
+		/* in between the two phases, Q15 */
+		int32_t w = (frac >> (32 - RESAMPLER_PHASE_BITS - 15)) & 0x7fff;
+		int64_t y = (a0 + ((((int64_t)a1 - a0) * w) >> 15) + (1 << 14)) >> 15;
+		out[i ^ r->swap] = (int16_t)(y > 32767 ? 32767 : y < -32768 ? -32768 : y);
+		pos += step;
+	}
+	r->pos = pos;
+	return n;
+}
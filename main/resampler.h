@@ -0,0 +1,54 @@
+#ifndef GAGA_RESAMPLER_H
+#define GAGA_RESAMPLER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* fixed point polyphase resampler, for 16 bit mono samples at any ratio. the (windowed sinc) filter is tabulated at
+ * RESAMPLER_PHASES fractional positions between two input samples, and the output is interpolated linearly between the
+ * two nearest ones. the position in the input is 32.32 fixed point, so the ratio can also be trimmed by a few ppm
+ * (e.g. to follow the clock drift) without redesigning the filter */
+#define RESAMPLER_MAX_TAPS 32
+#define RESAMPLER_PHASE_BITS 6
+#define RESAMPLER_PHASES (1 << RESAMPLER_PHASE_BITS)
+#define RESAMPLER_BLOCK 576  /* most samples written or read at once, one granule */
+
+/* taps per phase: the cost per output sample is twice that many multiply-adds */
+#define RESAMPLER_FAST 8
+#define RESAMPLER_MEDIUM 16
+#define RESAMPLER_BEST 32
+
+struct resampler {
+	int taps;
+	int swap;  /* 1: store every two output samples swapped around, like mp3dec_layout_t.swap */
+	uint32_t in_hz, out_hz;
+	float ppm;
+	float cutoff;  /* of the filter in coefs, as a fraction of the input's nyquist */
+	uint64_t step;  /* input samples per output sample, 32.32 */
+	uint64_t pos;  /* where in buf the next output sample is, 32.32 */
+	size_t len;  /* samples in buf */
+	int16_t buf[3 * RESAMPLER_BLOCK + 2 * RESAMPLER_MAX_TAPS];
+	int16_t coefs[(RESAMPLER_PHASES + 1) * RESAMPLER_MAX_TAPS];  /* Q15, one row of taps per phase */
+};
+
+void resampler_init(struct resampler *r, int taps, uint32_t in_hz, uint32_t out_hz);
+
+/* switches to another ratio, keeping the samples buffered so far. the filter is the same for any ratio up, so it's
+ * only designed again for a new ratio down, which takes a while (it's all double maths): not something to do on the
+ * audio path. when upsampling (or not resampling at all), resampler_init() has designed it once and for all */
+void resampler_set_rate(struct resampler *r, uint32_t in_hz, uint32_t out_hz);
+
+/* consumes the input ppm faster (positive) or slower than the nominal ratio says, i.e. runs the output clock faster */
+void resampler_set_ppm(struct resampler *r, float ppm);
+
+/* appends up to n samples, returns how many fit: there's always room for RESAMPLER_BLOCK, as long as the output is
+ * read down to less than RESAMPLER_BLOCK samples available after each write, and the ratio is at most 2:1 down */
+size_t resampler_write(struct resampler *r, const int16_t *in, size_t n);
+
+/* output samples which can be read with what has been written so far */
+size_t resampler_available(const struct resampler *r);
+
+/* resamples up to n samples into out, returns how many. n should be even when swapping */
+size_t resampler_read(struct resampler *r, int16_t *out, size_t n);
+
+#endif //GAGA_RESAMPLER_H
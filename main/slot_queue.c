@@ -0,0 +1,56 @@
+#include "slot_queue.h"
+
+void slot_queue_init(struct slot_queue *q, void *storage, size_t slot_size, size_t depth) {
+	q->slots = storage;
+	q->slot_size = slot_size;
+	q->depth = depth;
+	atomic_init(&q->head, 0);
+	atomic_init(&q->tail, 0);
+	atomic_init(&q->producer, NULL);
+	atomic_init(&q->consumer, NULL);
+}
+
+/* the waiting side publishes its handle before checking the indices, and the other side reads the handle after
+ * updating them: either the waiter sees the update, or its peer sees the handle and wakes it up. the notification count
+ * is shared with anything else the task waits on, which only causes spurious wakeups, as conditions are rechecked */
+static void slot_queue__wake(_Atomic(TaskHandle_t) *task) {
+	TaskHandle_t handle = atomic_load(task);
+	if (handle != NULL)
+		xTaskNotifyGive(handle);
+}
+
+void *slot_queue_acquire(struct slot_queue *q, TickType_t ticks_to_wait) {
+	size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+
+	atomic_store(&q->producer, xTaskGetCurrentTaskHandle());
+	while (head - atomic_load(&q->tail) == q->depth) {
+		if (ulTaskNotifyTake(pdTRUE, ticks_to_wait) == 0)
+			return NULL;
+	}
+	return q->slots + (head % q->depth) * q->slot_size;
+}
+
+void slot_queue_commit(struct slot_queue *q) {
+	atomic_fetch_add(&q->head, 1);
+	slot_queue__wake(&q->consumer);
+}
+
+void *slot_queue_peek(struct slot_queue *q, TickType_t ticks_to_wait) {
+	size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+	atomic_store(&q->consumer, xTaskGetCurrentTaskHandle());
+	while (atomic_load(&q->head) == tail) {
+		if (ulTaskNotifyTake(pdTRUE, ticks_to_wait) == 0)
+			return NULL;
+	}
+	return q->slots + (tail % q->depth) * q->slot_size;
+}
+
+void slot_queue_release(struct slot_queue *q) {
+	atomic_fetch_add(&q->tail, 1);
+	slot_queue__wake(&q->producer);
+}
+
+size_t slot_queue_fill(struct slot_queue *q) {
+	return atomic_load(&q->head) - atomic_load(&q->tail);
+}
@@ -0,0 +1,38 @@
+#ifndef GAGA_SLOT_QUEUE_H
+#define GAGA_SLOT_QUEUE_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+
+/* bounded single-producer/single-consumer queue of fixed-size slots.
+ * the producer fills a slot in place and commits it, the consumer uses it in place and releases it, so data is never
+ * copied in or out of the queue. each index is only ever written by one side, so there are no locks: a side that has to
+ * wait sleeps on its task notification, and the other side gives it after every commit/release. */
+struct slot_queue {
+	uint8_t *slots;
+	size_t slot_size;
+	size_t depth;
+	atomic_size_t head;  /* total slots committed, only written by the producer */
+	atomic_size_t tail;  /* total slots released, only written by the consumer */
+	_Atomic(TaskHandle_t) producer;
+	_Atomic(TaskHandle_t) consumer;
+};
+
+/* storage must be depth * slot_size bytes */
+void slot_queue_init(struct slot_queue *q, void *storage, size_t slot_size, size_t depth);
+
+/* producer side: get the next free slot (the same one until it is committed), NULL on timeout */
+void *slot_queue_acquire(struct slot_queue *q, TickType_t ticks_to_wait);
+void slot_queue_commit(struct slot_queue *q);
+
+/* consumer side: get the oldest committed slot (the same one until it is released), NULL on timeout */
+void *slot_queue_peek(struct slot_queue *q, TickType_t ticks_to_wait);
+void slot_queue_release(struct slot_queue *q);
+
+/* number of committed slots not yet released */
+size_t slot_queue_fill(struct slot_queue *q);
+
+#endif //GAGA_SLOT_QUEUE_H
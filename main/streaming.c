@@ -1,9 +1,13 @@
 #include <sys/cdefs.h>
+#include <stdatomic.h>
+#include <stdlib.h>
 #include <string.h>
-#include <freertos/ringbuf.h>
+#include <strings.h>
 #include <esp_err.h>
 #include <freertos/FreeRTOS.h>
 #include <freertos/event_groups.h>
+#include <freertos/queue.h>
+#include <freertos/task.h>
 #include <esp_system.h>
 #include <esp_wifi.h>
 #include <esp_event.h>
@@ -11,6 +15,8 @@
 #include <esp_log.h>
 #include <esp_tls.h>
 #include <esp_http_client.h>
+#include <esp_random.h>
+#include <esp_timer.h>
 
 #define LOG_LOCAL_LEVEL ESP_LOG_DEBUG
 
@@ -44,7 +50,7 @@
 static EventGroupHandle_t s_wifi_event_group;
 
 /* The event group allows multiple bits for each event, but we only care about two events:
- * - we are connected to the AP with an IP
+ * - we are connected to the AP with an IP (cleared again when the link goes down)
  * - we failed to connect after the maximum amount of retries */
 #define WIFI_CONNECTED_BIT BIT0
 #define WIFI_FAIL_BIT      BIT1
@@ -52,6 +58,32 @@ static EventGroupHandle_t s_wifi_event_group;
 #define MAX_HTTP_RECV_BUFFER 512
 #define MAX_HTTP_OUTPUT_BUFFER 2048
 
+/* HTTP level recovery: a connection which has been streaming is opened again right away, then the delay doubles at
+ * each failure in a row up to the max, with jitter so that a bunch of radios behind the same AP don't all come back at
+ * once */
+#define STREAMING_RETRY_MIN_MS 250
+#define STREAMING_RETRY_MAX_MS 30000
+#define STREAMING_TIMEOUT_MS 3000  /* to connect, for the TLS handshake and for the response headers */
+
+/* with a hot standby mirror, a task of its own keeps a second connection open to it, and reads it along at the
+ * stream's pace into a window of the last few seconds, so that it's never further behind than that. as soon as the
+ * connection streaming stalls, the source takes the standby over: it finds where its stream stopped in the
+ * window, and carries on from there */
+#ifdef CONFIG_GAGA_FAILOVER
+#define STREAMING_CONNECTIONS 2
+#define STREAMING_STALL_MS CONFIG_GAGA_FAILOVER_STALL_MS
+#define STREAMING_STANDBY_WINDOW (1024*32)  /* 2 s at 128 kbps, a power of two */
+#define STREAMING_STANDBY_READ 256  /* small reads, so that the standby task answers a switch over quickly */
+#define STREAMING_STANDBY_STACK_SIZE 4096
+#define STREAMING_ALIGN_BYTES 64  /* how much of the end of the stream is looked for in the standby's window */
+#define STREAMING_ALIGN_SEARCH 4096  /* how far to look for a frame header, when it's not found */
+#else
+#define STREAMING_CONNECTIONS 1
+#define STREAMING_STALL_MS 5000  /* no data for this long: give up on the connection */
+#endif
+
+#define STREAMING_READ_TIMEOUT_MS (STREAMING_STALL_MS / 4)  /* for each read once streaming, so stalls are noticed */
+
 static const char *TAG = "a_streaming";
 
 static int s_retry_num = 0;
@@ -75,6 +107,7 @@ static void event_handler(void *arg, esp_event_base_t event_base,
 		while (1);
 		esp_wifi_connect();
 	} else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
+		xEventGroupClearBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
 		if (s_retry_num < EXAMPLE_ESP_MAXIMUM_RETRY) {
 			esp_wifi_connect();
 			s_retry_num++;
@@ -91,7 +124,7 @@ static void event_handler(void *arg, esp_event_base_t event_base,
 	}
 }
 
-bool wifi_init_sta() {
+void wifi_init_sta() {
 	esp_log_level_set("wifi", ESP_LOG_DEBUG);
 
 	s_wifi_event_group = xEventGroupCreate();
@@ -135,20 +168,26 @@ bool wifi_init_sta() {
 	ESP_ERROR_CHECK(esp_wifi_start());
 
 	ESP_LOGI(TAG, "wifi_init_sta finished.");
+}
+
+bool wifi_wait_connected() {
+	/* the event handler gave up after too many attempts in a row: have another go */
+	if (xEventGroupClearBits(s_wifi_event_group, WIFI_FAIL_BIT) & WIFI_FAIL_BIT) {
+		s_retry_num = 0;
+		esp_wifi_connect();
+	}
 
 	/* Waiting until either the connection is established (WIFI_CONNECTED_BIT) or connection failed for the maximum
 	 * number of re-tries (WIFI_FAIL_BIT). The bits are set by event_handler() (see above) */
 	EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group,
 	                                       WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
-	                                       pdTRUE,
+	                                       pdFALSE,
 	                                       pdFALSE,
 	                                       portMAX_DELAY);
 
 	/* xEventGroupWaitBits() returns the bits before the call returned, hence we can test which event actually
 	 * happened. */
 	if (bits & WIFI_CONNECTED_BIT) {
-		ESP_LOGI(TAG, "connected to ap SSID:%s password:%s",
-		         EXAMPLE_ESP_WIFI_SSID, EXAMPLE_ESP_WIFI_PASS);
 		return true;
 	} else if (bits & WIFI_FAIL_BIT) {
 		ESP_LOGI(TAG, "Failed to connect to SSID:%s, password:%s",
@@ -160,6 +199,17 @@ bool wifi_init_sta() {
 	}
 }
 
+struct streaming__conn {
+	const char *url;
+	esp_http_client_handle_t cl;  /* for good: reconnecting only closes and reopens its connection */
+	int open;  /* connected, and the response headers are in */
+	int fresh;  /* nothing of it in the ring yet: its first bytes don't follow on from what's there */
+	size_t metaint;  /* mp3 bytes between ICY metadata blocks, 0 if the server doesn't send any */
+	size_t audio_left;  /* before the next metadata block */
+};
+
+static struct streaming__conn streaming__conns[STREAMING_CONNECTIONS];
+
 esp_err_t _http_event_handler(esp_http_client_event_t *evt) {
 	switch (evt->event_id) {
 		case HTTP_EVENT_ERROR:
@@ -173,6 +223,8 @@ esp_err_t _http_event_handler(esp_http_client_event_t *evt) {
 			break;
 		case HTTP_EVENT_ON_HEADER:
 			ESP_LOGD(TAG, "HTTP_EVENT_ON_HEADER, key=%s, value=%s", evt->header_key, evt->header_value);
+			if (evt->user_data != NULL && strcasecmp(evt->header_key, "icy-metaint") == 0)
+				((struct streaming__conn *)evt->user_data)->metaint = strtoul(evt->header_value, NULL, 10);
 			break;
 		case HTTP_EVENT_ON_DATA:
 			ESP_LOGV(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
@@ -196,80 +248,536 @@ esp_err_t _http_event_handler(esp_http_client_event_t *evt) {
 	return ESP_OK;
 }
 
-char chunk_buf[STREAMING_FETCH_CHUNK_SIZE];
 volatile uint32_t streaming_total_chunks_read = 0;
 
-void fetch_radio(RingbufHandle_t rb) {
-	esp_http_client_config_t config = {
-		.user_agent = STREAMING_USER_AGENT,
-		.url = STREAMING_RADIO_URL,
-		.event_handler = _http_event_handler,
-		.crt_bundle_attach = esp_crt_bundle_attach,
+/* connects and reads the response headers, leaving the body for later */
+static int streaming__open(struct streaming__conn *c) {
+	c->metaint = 0;
+	esp_http_client_set_timeout_ms(c->cl, STREAMING_TIMEOUT_MS);
+	esp_err_t err = esp_http_client_open(c->cl, 0);
+	if (err != ESP_OK) {
+		ESP_LOGE(TAG, "HTTP GET request to %s failed: %s", c->url, esp_err_to_name(err));
+		return 0;
+	}
+
+	int64_t fetch_result;
+	do {
+		fetch_result = esp_http_client_fetch_headers(c->cl);
+	} while (fetch_result == -ESP_ERR_HTTP_EAGAIN);
+
+	int status = esp_http_client_get_status_code(c->cl);
+	ESP_LOGI(TAG, "HTTP GET %s Status = %d, content_length = %"PRIu64", chunked=%d",
+	         c->url,
+	         status,
+	         esp_http_client_get_content_length(c->cl),
+			 esp_http_client_is_chunked_response(c->cl));
+	if (fetch_result < 0 || status / 100 != 2) {
+		esp_http_client_close(c->cl);
+		return 0;
+	}
+
+	if (c->metaint > 0)
+		ESP_LOGI(TAG, "ICY metadata every %zu bytes", c->metaint);
+	c->audio_left = c->metaint;
+	/* the handshake is over: from now on, reads have to come back soon enough to tell a stall */
+	esp_http_client_set_timeout_ms(c->cl, STREAMING_READ_TIMEOUT_MS);
+	c->open = 1;
+	c->fresh = 1;
+	return 1;
+}
+
+/* after a read which got nothing: a live stream has no length, so the client can't tell when it's over, but a read
+ * which times out takes the whole timeout. one which comes back empty right away has found the connection closed, and
+ * would keep doing so */
+static bool streaming__closed(struct streaming__conn *c, int64_t read_us) {
+	return esp_http_client_is_complete_data_received(c->cl) ||
+	       esp_timer_get_time() - read_us < STREAMING_READ_TIMEOUT_MS * 1000LL / 2;
+}
+
+static streaming_title_cb_t streaming__title_cb;
+
+void streaming_set_title_callback(streaming_title_cb_t cb) {
+	streaming__title_cb = cb;
+}
+
+/* picks StreamTitle='...'; out of an ICY metadata block, which comes in pieces */
+static struct {
+	size_t matched;  /* how much of the key has been seen */
+	int in_title, quote;  /* quote: the last character was a ', which might be the end of the title */
+	size_t len;
+	char title[STREAMING_TITLE_MAX];
+	char last[STREAMING_TITLE_MAX];  /* the one last announced */
+} streaming__icy;
+
+static void streaming__icy_parse(const uint8_t *buf, size_t n) {
+	static const char key[] = "StreamTitle='";
+
+	for (size_t i = 0; i < n; i++) {
+		char ch = (char)buf[i];
+
+		if (!streaming__icy.in_title) {
+			streaming__icy.matched = ch == key[streaming__icy.matched] ? streaming__icy.matched + 1 : ch == key[0];
+			streaming__icy.in_title = streaming__icy.matched == sizeof(key) - 1;
+			continue;
+		}
+
+		/* the title ends at "';", a ' on its own is part of it */
+		if (streaming__icy.quote && ch == ';') {
+			streaming__icy.in_title = 0;
+			streaming__icy.matched = 0;
+			continue;
+		}
+		if (streaming__icy.quote && streaming__icy.len < STREAMING_TITLE_MAX - 1)
+			streaming__icy.title[streaming__icy.len++] = '\'';
+		streaming__icy.quote = ch == '\'';
+		if (!streaming__icy.quote && streaming__icy.len < STREAMING_TITLE_MAX - 1)
+			streaming__icy.title[streaming__icy.len++] = ch;
+	}
+}
+
+/* one read of the metadata, waiting out short stalls. <= 0 if the connection failed, or stalled for good */
+static int streaming__icy_read(struct streaming__conn *c, uint8_t *buf, size_t len) {
+	int64_t since_us = esp_timer_get_time();
+
+	while (1) {
+		int64_t read_us = esp_timer_get_time();
+		int ret = esp_http_client_read(c->cl, (char *)buf, len);
+		if (ret != 0 || streaming__closed(c, read_us) || esp_timer_get_time() - since_us >= STREAMING_STALL_MS * 1000LL)
+			return ret;
+	}
+}
+
+/* reads the metadata block which comes next into scratch (room bytes, at least one), and if announce is set, announces
+ * the title in it when it's a new one. false if the connection failed */
+static bool streaming__icy_block(struct streaming__conn *c, uint8_t *scratch, size_t room, bool announce) {
+	if (streaming__icy_read(c, scratch, 1) != 1)
+		return false;
+
+	size_t left = scratch[0] * 16;  /* usually 0: most servers only send the metadata again when it changes */
+	if (left == 0)
+		return true;
+
+	if (announce) {
+		streaming__icy.matched = 0;
+		streaming__icy.in_title = streaming__icy.quote = 0;
+		streaming__icy.len = 0;
+	}
+	while (left > 0) {
+		int ret = streaming__icy_read(c, scratch, room < left ? room : left);
+		if (ret <= 0)
+			return false;
+		if (announce)
+			streaming__icy_parse(scratch, ret);
+		left -= ret;
+	}
+	if (!announce)
+		return true;
+
+	streaming__icy.title[streaming__icy.len] = 0;
+	if (streaming__icy.len > 0 && strcmp(streaming__icy.title, streaming__icy.last) != 0) {
+		strcpy(streaming__icy.last, streaming__icy.title);
+		if (streaming__title_cb != NULL)
+			streaming__title_cb(streaming__icy.title);
+	}
+	return true;
+}
+
+static void streaming__close(struct streaming__conn *c) {
+	esp_http_client_close(c->cl);
+	c->open = 0;
+}
+
+/* the next delay before reconnecting: none the first time, then STREAMING_RETRY_MIN_MS doubling at each call up to
+ * STREAMING_RETRY_MAX_MS, with equal jitter (anywhere between half the delay and all of it), so the retries spread out
+ * but still back off */
+static uint32_t streaming__backoff_ms(uint32_t *delay_ms) {
+	if (*delay_ms == 0) {
+		*delay_ms = STREAMING_RETRY_MIN_MS;
+		return 0;
+	}
+
+	uint32_t ms = *delay_ms / 2 + esp_random() % (*delay_ms / 2 + 1);
+	*delay_ms = *delay_ms * 2 > STREAMING_RETRY_MAX_MS ? STREAMING_RETRY_MAX_MS : *delay_ms * 2;
+	return ms;
+}
+
+static void streaming__backoff(uint32_t *delay_ms) {
+	uint32_t ms = streaming__backoff_ms(delay_ms);
+	if (ms == 0)
+		return;
+
+	ESP_LOGI(TAG, "Reconnecting in %"PRIu32" ms", ms);
+	vTaskDelay(pdMS_TO_TICKS(ms));
+}
+
+#if STREAMING_CONNECTIONS > 1
+/* the standby's window, and the switch over: the source asks the standby task for the standby by sending it the
+ * connection which failed, and gets the standby back (NULL if it isn't streaming). it then has the window to itself,
+ * until it sends NULL to say it's done with it; the failed connection is the standby from then on */
+static struct {
+	uint8_t window[STREAMING_STANDBY_WINDOW];  /* the last bytes of the standby's stream, around and around */
+	atomic_size_t total;  /* stream bytes ever read into the window (they wrap around too): the window ends there */
+	size_t start;  /* total when the standby was opened: the window doesn't go back past that */
+	atomic_size_t mark;  /* total when the last bytes went into the ring */
+	atomic_int ready;  /* the standby is open, and streaming into the window */
+	QueueHandle_t request, reply;
+} streaming__standby;
+_Static_assert((STREAMING_STANDBY_WINDOW & (STREAMING_STANDBY_WINDOW - 1)) == 0, "positions must wrap with the window");
+
+static uint8_t streaming__window_at(size_t pos) {
+	return streaming__standby.window[pos % STREAMING_STANDBY_WINDOW];
+}
+
+/* how far apart two positions are, either way round */
+static size_t streaming__distance(size_t a, size_t b) {
+	return a - b < b - a ? a - b : b - a;
+}
+
+/* reads the next bit of the standby's stream into the window, over its oldest bytes. false once it has failed, or
+ * stalled for good */
+static bool streaming__standby_read(struct streaming__conn *c, int64_t *idle_us) {
+	size_t total = atomic_load_explicit(&streaming__standby.total, memory_order_relaxed);
+	size_t offset = total % STREAMING_STANDBY_WINDOW, room = STREAMING_STANDBY_WINDOW - offset;
+	if (room > STREAMING_STANDBY_READ)
+		room = STREAMING_STANDBY_READ;
+	if (c->metaint > 0 && room > c->audio_left)
+		room = c->audio_left;
+
+	int64_t read_us = esp_timer_get_time();
+	int ret = esp_http_client_read(c->cl, (char *)streaming__standby.window + offset, room);
+	if (ret > 0) {
+		atomic_store(&streaming__standby.total, total + ret);
+		*idle_us = 0;
+		if (c->metaint > 0 && (c->audio_left -= ret) == 0) {
+			/* skipped, not announced: the titles are the source's business */
+			uint8_t scratch[64];
+			if (!streaming__icy_block(c, scratch, sizeof(scratch), false))
+				return false;
+			c->audio_left = c->metaint;
+		}
+		return true;
+	}
+	if (ret < 0 || streaming__closed(c, read_us))
+		return false;
+
+	*idle_us += esp_timer_get_time() - read_us;
+	return *idle_us < STREAMING_STALL_MS * 1000LL;
+}
+
+/* keeps the standby open and streaming into the window, at a lower priority than the source: opening it, with its TLS
+ * handshake, takes a while, and nothing waits on it */
+static void streaming__standby_task(void *param) {
+	struct streaming__conn *c = param;
+	uint32_t delay_ms = 0;
+	int64_t retry_us = 0, idle_us = 0;
+
+	while (1) {
+		struct streaming__conn *failed;
+		if (xQueueReceive(streaming__standby.request, &failed, 0) == pdTRUE) {
+			struct streaming__conn *ready = atomic_load(&streaming__standby.ready) ? c : NULL;
+			xQueueSend(streaming__standby.reply, &ready, portMAX_DELAY);
+			if (ready != NULL) {
+				struct streaming__conn *done;
+				xQueueReceive(streaming__standby.request, &done, portMAX_DELAY);
+				atomic_store(&streaming__standby.ready, 0);
+				c = failed;
+				delay_ms = 0;
+				retry_us = 0;
+			}
+			continue;
+		}
+
+		if (c->open) {
+			if (streaming__standby_read(c, &idle_us))
+				continue;
+			ESP_LOGW(TAG, "Standby connection to %s lost", c->url);
+			atomic_store(&streaming__standby.ready, 0);
+			streaming__close(c);
+			retry_us = esp_timer_get_time() + streaming__backoff_ms(&delay_ms) * 1000LL;
+			continue;
+		}
+
+		/* waiting for the link, or for the next attempt: the source may still ask for the standby meanwhile, to be
+		 * told there isn't one */
+		if (esp_timer_get_time() < retry_us || !(xEventGroupGetBits(s_wifi_event_group) & WIFI_CONNECTED_BIT)) {
+			xQueuePeek(streaming__standby.request, &failed, pdMS_TO_TICKS(100));
+			continue;
+		}
+		if (streaming__open(c)) {
+			ESP_LOGI(TAG, "Standby connection to %s ready", c->url);
+			streaming__standby.start = atomic_load(&streaming__standby.total);
+			idle_us = 0;
+			delay_ms = 0;
+			atomic_store(&streaming__standby.ready, 1);
+		} else {
+			retry_us = esp_timer_get_time() + streaming__backoff_ms(&delay_ms) * 1000LL;
+		}
+	}
+}
+
+/* looks for the ring's last bytes in the window (between begin and end), and sets *from right after them. if they're
+ * there more than once (e.g. digital silence, the same frame over and over), the closest to mark wins */
+static bool streaming__align(struct byte_ring *ring, size_t begin, size_t end, size_t mark, size_t *from) {
+	uint8_t last[STREAMING_ALIGN_BYTES];
+	bool found = false;
+
+	byte_ring_last(ring, last, sizeof(last));
+	for (size_t pos = begin; end - pos >= sizeof(last); pos++) {
+		size_t i = 0;
+		while (i < sizeof(last) && streaming__window_at(pos + i) == last[i])
+			i++;
+		if (i == sizeof(last) && (!found || streaming__distance(pos + i, mark) < streaming__distance(*from, mark))) {
+			*from = pos + i;
+			found = true;
+		}
+	}
+	return found;
+}
+
+/* length of the layer III frame whose header this is, 0 if it isn't one (or if it's free format) */
+static size_t streaming__frame_bytes(const uint8_t h[4]) {
+	static const uint16_t kbps[2][15] = {
+		{ 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },  /* MPEG-2 and 2.5 */
+		{ 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },  /* MPEG-1 */
 	};
-	esp_http_client_handle_t cl = esp_http_client_init(&config);
-	esp_err_t err = esp_http_client_open(cl, 0);
-	if (err == ESP_OK) {
-		int64_t fetch_result;
-		do {
-			fetch_result = esp_http_client_fetch_headers(cl);
-		} while (fetch_result == -ESP_ERR_HTTP_EAGAIN);
-
-		ESP_LOGI(TAG, "HTTP GET Status = %d, content_length = %"PRIu64", chunked=%d",
-		         esp_http_client_get_status_code(cl),
-		         esp_http_client_get_content_length(cl),
-				 esp_http_client_is_chunked_response(cl));
-
-		int ret;
-		do {
-			/* fill the buffer */
-			size_t bytes_read_for_chunk = 0;
-			do {
-				assert(bytes_read_for_chunk < STREAMING_FETCH_CHUNK_SIZE);
-				ret = esp_http_client_read(cl,
-										   chunk_buf + bytes_read_for_chunk,
-										   STREAMING_FETCH_CHUNK_SIZE - bytes_read_for_chunk);
-				if (ret >= 0) {
-					bytes_read_for_chunk += ret;
-					streaming_total_chunks_read++;
-				}
-			} while (bytes_read_for_chunk != STREAMING_FETCH_CHUNK_SIZE && ret != ESP_FAIL);
+	static const uint32_t hz[3] = { 44100, 48000, 32000 };
+	unsigned version = (h[1] >> 3) & 3, bitrate = h[2] >> 4, rate = (h[2] >> 2) & 3;
+
+	if (h[0] != 0xff || (h[1] & 0xe0) != 0xe0 || version == 1 || ((h[1] >> 1) & 3) != 1 ||
+	    bitrate == 0 || bitrate == 15 || rate == 3)
+		return 0;
+	int mpeg1 = version == 3;
+	uint32_t sample_rate = hz[rate] >> (mpeg1 ? 0 : version == 2 ? 1 : 2);
+	return (mpeg1 ? 144 : 72) * 1000 * kbps[mpeg1][bitrate] / sample_rate + ((h[2] >> 1) & 1);
+}
 
-			ESP_LOGD(TAG, "Read chunk, status %d", ret);
+/* the first frame in the window from pos on, with another one like it right after, so the decoder starts on a whole
+ * frame. pos itself if there's none in sight */
+static size_t streaming__frame_start(size_t pos, size_t end) {
+	for (size_t p = pos; end - p >= 4 && p - pos < STREAMING_ALIGN_SEARCH; p++) {
+		uint8_t h[4], next[4];
+		for (int i = 0; i < 4; i++)
+			h[i] = streaming__window_at(p + i);
+		size_t len = streaming__frame_bytes(h);
+		if (len == 0 || end - p < len + 4)
+			continue;
+		for (int i = 0; i < 4; i++)
+			next[i] = streaming__window_at(p + len + i);
+		if (streaming__frame_bytes(next) > 0 && next[1] == h[1] && (next[2] & 0x0c) == (h[2] & 0x0c))
+			return p;
+	}
+	return pos;
+}
 
-			/* if the read was successful, put the chunk in the ring buffer. we ignore the return value of
-			 * xRingbufferSend, because if the send fails with MAX_DELAY there's not much we can do anyway. the docs
-			 * are very vague about the reasons why it might fail. */
-			if (bytes_read_for_chunk == STREAMING_FETCH_CHUNK_SIZE && ret != ESP_FAIL)
-				xRingbufferSend(rb, chunk_buf, STREAMING_FETCH_CHUNK_SIZE, portMAX_DELAY);
-		} while (ret != ESP_FAIL);
-	} else {
-		ESP_LOGE(TAG, "HTTP GET request failed: %s", esp_err_to_name(err));
+static void streaming__window_to_ring(size_t from, size_t end, struct byte_ring *ring) {
+	while (from != end) {
+		size_t room, len = end - from, offset = from % STREAMING_STANDBY_WINDOW;
+		uint8_t *dst = byte_ring_reserve(ring, 1, &room, portMAX_DELAY);
+		if (len > STREAMING_STANDBY_WINDOW - offset)
+			len = STREAMING_STANDBY_WINDOW - offset;
+		if (len > room)
+			len = room;
+		memcpy(dst, streaming__standby.window + offset, len);
+		byte_ring_commit(ring, len);
+		from += len;
 	}
+	streaming_total_chunks_read++;
 }
 
+/* takes the standby over in place of c (closed, it becomes the standby), and puts what the window has that the ring
+ * doesn't yet into the ring. the mirrors usually relay the same bytes, so the ring's last ones are in the window
+ * somewhere: carrying on right after them, the decoder doesn't even notice. if they aren't (the mirrors encode the
+ * programme themselves, or the standby is behind), it carries on from the first whole frame which came in after the
+ * ring's last bytes did, after a cut, and the programme jumps by however far apart the mirrors are. NULL if the
+ * standby isn't streaming */
+static struct streaming__conn *streaming__switch_over(struct streaming__conn *c, size_t got, struct byte_ring *ring) {
+	struct streaming__conn *next;
+
+	if (!atomic_load(&streaming__standby.ready))
+		return NULL;
+	xQueueSend(streaming__standby.request, &c, portMAX_DELAY);
+	xQueueReceive(streaming__standby.reply, &next, portMAX_DELAY);
+	if (next == NULL)
+		return NULL;
+
+	size_t end = atomic_load(&streaming__standby.total), start = streaming__standby.start;
+	size_t begin = end - start > STREAMING_STANDBY_WINDOW ? end - STREAMING_STANDBY_WINDOW : start;
+	size_t mark = atomic_load(&streaming__standby.mark), from;
+	if (mark - begin > end - begin)
+		mark = begin;  /* from before the window, or before the standby was opened */
+
+	/* the ring's last bytes have to be this connection's, not some other's before a cut */
+	bool in_step = got >= STREAMING_ALIGN_BYTES && streaming__align(ring, begin, end, mark, &from);
+	if (!in_step) {
+		from = streaming__frame_start(mark, end);
+		if (streaming_total_chunks_read > 0 && !byte_ring_cut(ring))
+			ESP_LOGW(TAG, "Last stream cut not reached yet, the decoder will have to resynchronize");
+	}
+	ESP_LOGW(TAG, "Switched over to %s %s, %zu bytes to catch up", next->url, in_step ? "in step" : "after a cut",
+	         end - from);
+	streaming__window_to_ring(from, end, ring);
+	next->fresh = 0;
+
+	struct streaming__conn *done = NULL;
+	xQueueSend(streaming__standby.request, &done, portMAX_DELAY);
+	return next;
+}
+#endif
+
+/* reads the response into the ring until the connection drops or stalls. returns how many bytes it got */
+static size_t streaming__pump(struct streaming__conn *c, struct byte_ring *ring, int64_t down_since_us) {
+	size_t total = 0;
+	int ret;
+	int64_t idle_us = 0;  /* spent in reads which brought nothing */
+
+	do {
+		/* reserve room for a batch in the ring (less right before the wrap), and have the client read straight
+		 * into it */
+		size_t room;
+		char *batch = (char *)byte_ring_reserve(ring, STREAMING_READ_BATCH, &room, portMAX_DELAY);
+		if (room > STREAMING_READ_BATCH)
+			room = STREAMING_READ_BATCH;
+		if (c->metaint > 0 && room > c->audio_left)
+			room = c->audio_left;  /* stop right before the metadata */
+		int64_t read_us = esp_timer_get_time();
+		ret = esp_http_client_read(c->cl, batch, room);
+
+		/* hand over whatever came in, even if it's less than we asked for: that only happens when the network is
+		 * slow or the connection is going away, and holding on to it would just make the decoder wait, or throw
+		 * the stream's last bytes away. those stay in the ring, and the decoder picks up from there */
+		if (ret > 0) {
+			if (c->fresh) {
+				ESP_LOGI(TAG, "Stream back after %"PRId64" ms", (esp_timer_get_time() - down_since_us) / 1000);
+				/* this connection starts somewhere else in the stream than where the last one stopped (if it's not
+				 * another server altogether): tell the decoder. the bytes before the cut are not touched */
+				if (streaming_total_chunks_read > 0 && !byte_ring_cut(ring))
+					ESP_LOGW(TAG, "Last stream cut not reached yet, the decoder will have to resynchronize");
+				c->fresh = 0;
+			}
+			byte_ring_commit(ring, ret);
+			streaming_total_chunks_read++;
+			total += ret;
+			idle_us = 0;
+#if STREAMING_CONNECTIONS > 1
+			/* the standby had got this far when these bytes came in: if they can't be found in its window on a switch
+			 * over, it carries on from there */
+			atomic_store(&streaming__standby.mark, atomic_load(&streaming__standby.total));
+#endif
+
+			if (c->metaint > 0 && (c->audio_left -= ret) == 0) {
+				/* the metadata block goes into the free room of the ring, without committing it: the next read just
+				 * overwrites it, so the decoder never sees any of it, and it needs no buffer of its own */
+				uint8_t *scratch = byte_ring_reserve(ring, 1, &room, portMAX_DELAY);
+				if (!streaming__icy_block(c, scratch, room, true)) {
+					ret = ESP_FAIL;
+					break;
+				}
+				c->audio_left = c->metaint;
+			}
+		} else if (ret == 0 && streaming__closed(c, read_us)) {
+			break;  /* the server has closed the stream */
+		} else {
+			idle_us += esp_timer_get_time() - read_us;
+		}
+		ESP_LOGV(TAG, "Read %zu bytes, status %d", room, ret);
+	} while (ret != ESP_FAIL && idle_us < STREAMING_STALL_MS * 1000LL);
+
+	ESP_LOGW(TAG, "Stream from %s interrupted after %zu bytes (status %d)", c->url, total, ret);
+	return total;
+}
+
+void stream_radio(struct byte_ring *ring) {
+	static const char *const urls[STREAMING_CONNECTIONS] = {
+		STREAMING_RADIO_URL,
+#if STREAMING_CONNECTIONS > 1
+		STREAMING_BACKUP_URL,
+#endif
+	};
+
+	for (int i = 0; i < STREAMING_CONNECTIONS; i++) {
+		esp_http_client_config_t config = {
+			.user_agent = STREAMING_USER_AGENT,
+			.url = urls[i],
+			.event_handler = _http_event_handler,
+			.crt_bundle_attach = esp_crt_bundle_attach,
+			.timeout_ms = STREAMING_TIMEOUT_MS,
+			.user_data = &streaming__conns[i],
+		};
+		streaming__conns[i].url = urls[i];
+		streaming__conns[i].cl = esp_http_client_init(&config);
+		/* ask for the titles. servers which do send them interleave them with the mp3 data, they're taken out
+		 * before they get to the decoder */
+		esp_http_client_set_header(streaming__conns[i].cl, "Icy-MetaData", "1");
+	}
+
+#if STREAMING_CONNECTIONS > 1
+	streaming__standby.request = xQueueCreate(1, sizeof(struct streaming__conn *));
+	streaming__standby.reply = xQueueCreate(1, sizeof(struct streaming__conn *));
+	if (xTaskCreatePinnedToCore(streaming__standby_task, "STANDBY", STREAMING_STANDBY_STACK_SIZE, &streaming__conns[1],
+	                            tskIDLE_PRIORITY + 1, NULL, xPortGetCoreID()) != pdPASS)
+		ESP_LOGE(TAG, "Could not create task STANDBY");
+#endif
+
+	struct streaming__conn *c = &streaming__conns[0];
+	uint32_t delay_ms = 0;  /* before the next attempt */
+	int64_t down_since_us = esp_timer_get_time();
+
+	while (1) {
+		/* link level: the Wi-Fi event handler keeps reassociating by itself, wait for it. if it gives up, back off
+		 * before it has another go */
+		if (!wifi_wait_connected()) {
+			streaming__backoff(&delay_ms);
+			continue;
+		}
+
+		/* HTTP level. the decoder is left alone the whole time: it plays what's still in the ring, and then picks up
+		 * the new connection's bytes where the old ones stop */
+		size_t got = 0;
+		if (c->open || streaming__open(c)) {
+			got = streaming__pump(c, ring, down_since_us);
+			streaming__close(c);
+			if (got > 0) {
+				down_since_us = esp_timer_get_time();
+				delay_ms = 0;
+			}
+		}
+
+#if STREAMING_CONNECTIONS > 1
+		/* if the standby is streaming, carry on with it right away */
+		struct streaming__conn *next = streaming__switch_over(c, got, ring);
+		if (next != NULL) {
+			c = next;
+			delay_ms = 0;
+			continue;
+		}
+#endif
+		streaming__backoff(&delay_ms);
+	}
+}
 
 #include "data.h"
 
-_Noreturn void stream_embedded_data(RingbufHandle_t rb) {
+_Noreturn void stream_embedded_data(struct byte_ring *ring) {
 	/* get MP3 data pointer */
 	const uint8_t *audio_data = audio_data_start;
 	size_t audio_data_len = audio_data_end - audio_data_start;
 	size_t cur_pos = 0;
 
 	do {
-		/* fill the buffer */
-		size_t amt_to_read = STREAMING_FETCH_CHUNK_SIZE;
+		/* fill a chunk of the ring, or less of it right before the wrap */
+		size_t room;
+		uint8_t *chunk = byte_ring_reserve(ring, STREAMING_FETCH_CHUNK_SIZE, &room, portMAX_DELAY);
+		size_t amt_to_read = room < STREAMING_FETCH_CHUNK_SIZE ? room : STREAMING_FETCH_CHUNK_SIZE;
 		if (amt_to_read > audio_data_len - cur_pos)
 			amt_to_read = audio_data_len - cur_pos;
 
-		memcpy(chunk_buf, audio_data + cur_pos, amt_to_read);
-		memset(chunk_buf + amt_to_read, 0, STREAMING_FETCH_CHUNK_SIZE - amt_to_read);
+		memcpy(chunk, audio_data + cur_pos, amt_to_read);
 
 		cur_pos += amt_to_read;
 		if (cur_pos == audio_data_len)
 			cur_pos = 0;
 
-		xRingbufferSend(rb, chunk_buf, STREAMING_FETCH_CHUNK_SIZE, portMAX_DELAY);
-		//ESP_LOGD(TAG, "Sent %d bytes with ck %x", STREAMING_FETCH_CHUNK_SIZE, checksum((uint8_t*)chunk_buf, STREAMING_FETCH_CHUNK_SIZE));
+		byte_ring_commit(ring, amt_to_read);
+		//ESP_LOGD(TAG, "Sent %d bytes with ck %x", amt_to_read, checksum(chunk, amt_to_read));
 	} while (1);
 }
@@ -2,11 +2,19 @@
 
 #ifndef _H_STREAMING_
 
-#include <freertos/ringbuf.h>
+#include "byte_ring.h"
 
-/* chunk size to put in the ring buffer */
+/* chunk size to put in the ring, when streaming embedded data */
 #define STREAMING_FETCH_CHUNK_SIZE 1024
 
+/* bytes to ask the HTTP client for at a time. it only returns when it has them all, or on a timeout or a connection
+ * loss, so this is how much the decoder waits for at most; smaller batches wake it up more often for less data */
+#ifdef CONFIG_GAGA_STREAMING_READ_BATCH
+	#define STREAMING_READ_BATCH CONFIG_GAGA_STREAMING_READ_BATCH
+#else
+	#define STREAMING_READ_BATCH 512
+#endif
+
 #ifndef STREAMING_USER_AGENT
 	#define STREAMING_USER_AGENT "RadioGaga/0.1 (bestov.io -- Slava Ukraini from Italy)"
 #endif
@@ -15,18 +23,34 @@
 	#define STREAMING_RADIO_URL "https://radio3.ukr.radio/ur3-mp3-m"
 #endif
 
-/* total chunks ever read from streaming module.
+/* mirror of the same station, kept connected as a hot standby (see "Hot standby mirror" in menuconfig) */
+#if defined(CONFIG_GAGA_FAILOVER) && !defined(STREAMING_BACKUP_URL)
+	#define STREAMING_BACKUP_URL CONFIG_GAGA_FAILOVER_URL
+#endif
+
+#define STREAMING_TITLE_MAX 128  /* longer titles are cut short */
+
+/* called by the source task whenever the station announces a new title (ICY metadata) */
+typedef void (*streaming_title_cb_t)(const char *title);
+void streaming_set_title_callback(streaming_title_cb_t cb);
+
+/* total reads (or chunks, for embedded data) ever done by the streaming module.
  * with 128kbit/s MP3 uint32_t lasts ~1 year.
  * TODO synchronization */
 extern volatile uint32_t streaming_total_chunks_read;
 
-/* start fetching chunks and put the in given ring buffer */
-void fetch_radio(RingbufHandle_t);
+/* stream the radio straight into the given ring, for good: dropped connections are opened again (with a backoff if
+ * they keep failing), and the Wi-Fi reassociates by itself, so the decoder just sees the stream carry on */ _Noreturn
+void stream_radio(struct byte_ring *);
+
+/* stream embedded data to the given ring */ _Noreturn
+void stream_embedded_data(struct byte_ring *);
 
-/* stream embedded data to the given ring buffer */ _Noreturn
-void stream_embedded_data(RingbufHandle_t);
+/* initialize The Internet(TM), once: netif, event loop and Wi-Fi stay up from then on */
+void wifi_init_sta();
 
-/* initialize The Internet(TM) */
-bool wifi_init_sta();
+/* wait for the station to be associated and have an IP. false if it has given up for now, in which case the next call
+ * starts a new round of attempts */
+bool wifi_wait_connected();
 
 #endif
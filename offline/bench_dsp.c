@@ -0,0 +1,123 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MINIMP3_ONLY_MP3
+#define MINIMP3_NONSTANDARD_BUT_LOGICAL
+#define MINIMP3_IMPLEMENTATION
+#include "../main/minimp3.h"
+#include "../main/dsp.c"
+#include "data.h"
+
+/* DSP chain benchmark: decodes data.h downmixed to mono, like the radio does, and runs it through main/dsp.c set up
+ * like the menuconfig defaults (bass cut, presence boost, limiter), in granule sized blocks, reporting the cycles per
+ * sample of each stage. then it measures the chain's response to a few sine waves, and how well the limiter holds a
+ * loud one under its threshold. the cycles are the host's (rdtsc), so only compare them with each other.
+ *
+ * usage: gcc -O2 bench_dsp.c -lm -o bench_dsp && ./bench_dsp */
+
+#define RUNS 5
+#define BLOCK 576
+#define HZ 48000
+#define HIGHPASS_HZ 120
+#define PRESENCE_HZ 3000
+#define PRESENCE_DB 4
+#define LIMITER_DBFS -1
+
+static struct dsp dsp;
+
+static void setup(int swap) {
+	dsp_init(&dsp, HZ);
+	dsp.swap = swap;
+	dsp_add_biquad(&dsp, DSP_HIGHPASS, HIGHPASS_HZ, 0.707f, 0);
+	dsp_add_biquad(&dsp, DSP_PEAK, PRESENCE_HZ, 1.0f, PRESENCE_DB);
+	dsp_set_limiter(&dsp, LIMITER_DBFS, 200);
+}
+
+/* runs a second of a sine through the chain, returns the output's rms over the input's (dB), and its peak */
+static double sine(double freq, double amplitude, int *peak) {
+	static int16_t buf[HZ];
+	double in = 0, out = 0;
+
+	setup(0);
+	for (int i = 0; i < HZ; i++)
+		buf[i] = (int16_t)lrint(amplitude * sin(2 * M_PI * freq * i / HZ));
+	for (int i = HZ / 2; i < HZ; i++)
+		in += (double)buf[i] * buf[i];
+	for (int i = 0; i + BLOCK <= HZ; i += BLOCK)
+		dsp_process(&dsp, buf + i, BLOCK);
+
+	*peak = 0;
+	/* the second half, when the filters have settled */
+	for (int i = HZ / 2; i < HZ / BLOCK * BLOCK; i++) {
+		out += (double)buf[i] * buf[i];
+		if (abs(buf[i]) > *peak)
+			*peak = abs(buf[i]);
+	}
+	return 10 * log10(out / in * HZ / 2 / (HZ / BLOCK * BLOCK - HZ / 2));
+}
+
+int main(void) {
+	static mp3dec_t mp3d;
+	static mp3d_sample_t frame[MINIMP3_MAX_SAMPLES_PER_FRAME];
+	mp3dec_frame_info_t info;
+	int16_t *pcm = malloc(audio_data_len * 16 * sizeof(int16_t));
+	size_t pcm_len = 0, pos = 0;
+
+	mp3dec_init(&mp3d);
+	mp3dec_set_mono(&mp3d, MINIMP3_MONO_MIX);
+	while (pos < audio_data_len) {
+		int samples = mp3dec_decode_frame(&mp3d, audio_data + pos, (int)(audio_data_len - pos), frame, &info);
+		if (info.frame_bytes == 0)
+			break;
+		pos += info.frame_bytes;
+		memcpy(pcm + pcm_len, frame, samples * sizeof(int16_t));
+		pcm_len += samples;
+	}
+	pcm_len -= pcm_len % BLOCK;
+	printf("%zu samples decoded; highpass at %d Hz, +%d dB at %d Hz, limiter at %d dBFS\n\n",
+	       pcm_len, HIGHPASS_HZ, PRESENCE_DB, PRESENCE_HZ, LIMITER_DBFS);
+
+	printf("%6s %10s %10s %10s %10s %10s\n", "swap", dsp_stage_name(DSP_STAGE_GAIN), dsp_stage_name(DSP_STAGE_EQ),
+	       dsp_stage_name(DSP_STAGE_LIMITER), "total", "limited");
+	int16_t *buf = malloc(pcm_len * sizeof(int16_t));
+	for (int swap = 0; swap < 2; swap++) {
+		struct dsp_stats best = {0};
+		double best_total = 1e30;
+
+		for (int run = 0; run < RUNS; run++) {
+			double total = 0;
+			memcpy(buf, pcm, pcm_len * sizeof(int16_t));
+			setup(swap);
+			for (size_t i = 0; i < pcm_len; i += BLOCK)
+				dsp_process(&dsp, buf + i, BLOCK);
+			for (int s = 0; s < DSP_STAGES; s++)
+				total += (double)dsp.stats.cycles[s] / dsp.stats.samples;
+			if (total < best_total) {
+				best_total = total;
+				best = dsp.stats;
+			}
+		}
+
+		printf("%6d", swap);
+		for (int s = 0; s < DSP_STAGES; s++)
+			printf(" %10.2f", (double)best.cycles[s] / best.samples);
+		printf(" %10.2f %9.1f%%\n", best_total, 100.0 * best.limited * DSP_CHUNK / best.samples);
+	}
+	free(buf);
+	printf("(cycles per sample)\n\n");
+
+	static const double freqs[] = {30, 60, 120, 250, 1000, 2000, 3000, 5000, 10000, 20000};
+	printf("%8s %10s %10s\n", "Hz", "-20 dBFS", "+6 dBFS");
+	for (size_t f = 0; f < sizeof(freqs) / sizeof(freqs[0]); f++) {
+		int quiet_peak, loud_peak;
+		double quiet = sine(freqs[f], 3277, &quiet_peak);
+		sine(freqs[f], 32767, &loud_peak);  /* clipped at the input already, the chain boosts it further */
+		printf("%8.0f %+9.1f %10d\n", freqs[f], quiet, loud_peak);
+	}
+	printf("(response in dB, and the peak of a full scale tone, which should be at most %d)\n",
+	       (int)lrint(32767 * pow(10, LIMITER_DBFS / 20.0)));
+	free(pcm);
+	return 0;
+}
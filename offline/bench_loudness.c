@@ -0,0 +1,277 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MINIMP3_ONLY_MP3
+#define MINIMP3_NONSTANDARD_BUT_LOGICAL
+#define MINIMP3_IMPLEMENTATION
+#include "../main/minimp3.h"
+#include "../main/dsp.c"
+#include "../main/loudness.c"
+#include "data.h"
+
+/* loudness normalization benchmark: plays a few "stations" back to back through main/loudness.c and the DSP chain's
+ * gain, like the radio does, and reports how loud each one is going in and coming out once the gain has settled,
+ * measured independently in floating point (BS.1770 K-weighting and gating). the stations are the test
+ * stream and any captured streams given on the command line, each at its own level and 8 dB quieter. it also reports
+ * how far the fixed point estimate strays from the float one, and what it costs: the cycles are the host's (rdtsc),
+ * so only compare them with each other.
+ *
+ * usage: gcc -O2 bench_loudness.c -lm -o bench_loudness && ./bench_loudness [captured.mp3 ...]
+ * (e.g. curl -m 60 -o captured.mp3 <station url>) */
+
+#define BLOCK 576
+#define STATION_SECONDS 30
+#define SETTLED_SECONDS 10  /* the output is measured over the end of each station */
+#define TARGET_LUFS -18.0f
+#define MAX_GAIN_DB 12.0f
+#define MAX_STATIONS 16
+
+struct station {
+	const char *name;
+	int16_t *pcm;
+	size_t len;
+	uint32_t hz;
+	float level_db;
+};
+
+/* float reference: BS.1770 K-weighting (the standard's coefficients at 48 kHz, RBJ designs otherwise) */
+struct reference {
+	double b[2][3], a[2][3], z[2][2];
+	double blocks[LOUDNESS_WINDOW_BLOCKS], energy;
+	size_t block_len, block_samples;
+	int next, filled;
+};
+
+static void reference_design(double *b, double *a, int shelf, double hz) {
+	double f = shelf ? LOUDNESS_SHELF_HZ : LOUDNESS_HIGHPASS_HZ, q = shelf ? LOUDNESS_SHELF_Q : LOUDNESS_HIGHPASS_Q;
+	double w0 = 2 * M_PI * f / hz, cosw = cos(w0), alpha = sin(w0) / (2 * q), g = pow(10, LOUDNESS_SHELF_DB / 40);
+	double a0;
+	if (shelf) {
+		b[0] = g * ((g + 1) + (g - 1) * cosw + 2 * sqrt(g) * alpha);
+		b[1] = -2 * g * ((g - 1) + (g + 1) * cosw);
+		b[2] = g * ((g + 1) + (g - 1) * cosw - 2 * sqrt(g) * alpha);
+		a0 = (g + 1) - (g - 1) * cosw + 2 * sqrt(g) * alpha;
+		a[1] = 2 * ((g - 1) - (g + 1) * cosw);
+		a[2] = (g + 1) - (g - 1) * cosw - 2 * sqrt(g) * alpha;
+	} else {
+		b[0] = b[2] = (1 + cosw) / 2;
+		b[1] = -(1 + cosw);
+		a0 = 1 + alpha;
+		a[1] = -2 * cosw;
+		a[2] = 1 - alpha;
+	}
+	for (int i = 0; i < 3; i++) {
+		b[i] /= a0;
+		a[i] /= a0;
+	}
+}
+
+static void reference_init(struct reference *r, uint32_t hz) {
+	static const double b48[2][3] = {{1.53512485958697, -2.69169618940638, 1.19839281085285}, {1, -2, 1}};
+	static const double a48[2][3] = {{1, -1.69065929318241, 0.73248077421585}, {1, -1.99004745483398, 0.99007225036621}};
+	memset(r, 0, sizeof(*r));
+	for (int s = 0; s < 2; s++) {
+		if (hz == 48000) {
+			memcpy(r->b[s], b48[s], sizeof(r->b[s]));
+			memcpy(r->a[s], a48[s], sizeof(r->a[s]));
+		} else {
+			reference_design(r->b[s], r->a[s], s == 0, hz);
+		}
+	}
+	r->block_len = hz * LOUDNESS_BLOCK_MS / 1000;
+}
+
+static double reference_lufs(double mean_square) {
+	return -0.691 + 10 * log10(mean_square + 1e-12);
+}
+
+static double reference_gated(const struct reference *r) {
+	double sum = 0, gate;
+	int count = 0;
+	for (int pass = 0; pass < 2; pass++) {
+		gate = pass ? reference_lufs(count ? sum / count : 0) + LOUDNESS_RELATIVE_GATE : LOUDNESS_ABSOLUTE_GATE;
+		sum = 0;
+		count = 0;
+		for (int i = 0; i < r->filled; i++) {
+			if (reference_lufs(r->blocks[i]) > gate) {
+				sum += r->blocks[i];
+				count++;
+			}
+		}
+	}
+	return count ? reference_lufs(sum / count) : LOUDNESS_ABSOLUTE_GATE - 1;
+}
+
+/* BS.1770 integrated loudness of some blocks: gated like the short-term one, over all of them */
+static double integrated(const double *blocks, int n) {
+	double sum = 0, gate;
+	int count = 0;
+	for (int pass = 0; pass < 2; pass++) {
+		gate = pass ? reference_lufs(count ? sum / count : 0) + LOUDNESS_RELATIVE_GATE : LOUDNESS_ABSOLUTE_GATE;
+		sum = 0;
+		count = 0;
+		for (int i = 0; i < n; i++) {
+			if (reference_lufs(blocks[i]) > gate) {
+				sum += blocks[i];
+				count++;
+			}
+		}
+	}
+	return count ? reference_lufs(sum / count) : LOUDNESS_ABSOLUTE_GATE - 1;
+}
+
+/* returns 1 when a block is done */
+static int reference_sample(struct reference *r, int16_t sample) {
+	double x = sample / 32768.0;
+	for (int s = 0; s < 2; s++) {
+		/* transposed direct form II */
+		double y = r->b[s][0] * x + r->z[s][0];
+		r->z[s][0] = r->b[s][1] * x - r->a[s][1] * y + r->z[s][1];
+		r->z[s][1] = r->b[s][2] * x - r->a[s][2] * y;
+		x = y;
+	}
+	r->energy += x * x;
+	if (++r->block_samples < r->block_len)
+		return 0;
+	r->blocks[r->next] = r->energy / r->block_samples;
+	r->next = (r->next + 1) % LOUDNESS_WINDOW_BLOCKS;
+	if (r->filled < LOUDNESS_WINDOW_BLOCKS)
+		r->filled++;
+	r->energy = 0;
+	r->block_samples = 0;
+	return 1;
+}
+
+static int decode(struct station *st, const uint8_t *mp3, size_t len) {
+	static mp3dec_t mp3d;
+	static mp3d_sample_t frame[MINIMP3_MAX_SAMPLES_PER_FRAME];
+	mp3dec_frame_info_t info;
+	size_t pos = 0;
+
+	st->pcm = malloc(len * 16 * sizeof(int16_t));
+	st->len = 0;
+	st->hz = 0;
+	mp3dec_init(&mp3d);
+	mp3dec_set_mono(&mp3d, MINIMP3_MONO_MIX);
+	while (pos < len) {
+		int samples = mp3dec_decode_frame(&mp3d, mp3 + pos, (int)(len - pos), frame, &info);
+		if (info.frame_bytes == 0)
+			break;
+		pos += info.frame_bytes;
+		if (samples == 0)
+			continue;
+		if (st->hz != 0 && (uint32_t)info.hz != st->hz)
+			break;  /* keep it simple: one rate per station */
+		st->hz = info.hz;
+		memcpy(st->pcm + st->len, frame, samples * sizeof(int16_t));
+		st->len += samples;
+	}
+	st->len -= st->len % BLOCK;
+	return st->len > 0;
+}
+
+int main(int argc, char **argv) {
+	static struct station stations[MAX_STATIONS];
+	static struct loudness loudness;
+	static struct dsp dsp;
+	static struct reference in_ref, out_ref;
+	static int16_t in[BLOCK], out[BLOCK];
+	int nstations = 0;
+
+	for (int i = 0; i < argc && nstations + 2 <= MAX_STATIONS; i++) {
+		struct station *st = &stations[nstations];
+		if (i == 0) {
+			st->name = "data.h";
+			if (!decode(st, audio_data, audio_data_len))
+				return 1;
+		} else {
+			FILE *f = fopen(argv[i], "rb");
+			if (f == NULL) {
+				perror(argv[i]);
+				return 1;
+			}
+			fseek(f, 0, SEEK_END);
+			size_t len = (size_t)ftell(f);
+			fseek(f, 0, SEEK_SET);
+			uint8_t *mp3 = malloc(len);
+			if (fread(mp3, 1, len, f) != len || !decode(st, mp3, len)) {
+				fprintf(stderr, "%s: nothing to decode\n", argv[i]);
+				return 1;
+			}
+			fclose(f);
+			free(mp3);
+			st->name = argv[i];
+		}
+		/* the same station, 8 dB quieter */
+		stations[nstations + 1] = *st;
+		stations[nstations + 1].level_db = -8;
+		nstations += 2;
+	}
+
+	loudness_init(&loudness, stations[0].hz, TARGET_LUFS, MAX_GAIN_DB);
+	dsp_init(&dsp, stations[0].hz);
+
+	printf("target %.0f LUFS, gain up to %+.0f dB, %d s per station, output measured over the last %d s\n\n",
+	       TARGET_LUFS, MAX_GAIN_DB, STATION_SECONDS, SETTLED_SECONDS);
+	printf("%-24s %6s %10s %10s %10s %12s\n", "station", "level", "in (LUFS)", "out (LUFS)", "gain (dB)", "error (LU)");
+
+	uint64_t cycles = 0, samples = 0;
+	for (int s = 0; s < nstations; s++) {
+		struct station *st = &stations[s];
+		int16_t scale = (int16_t)lrint(32767 * pow(10, st->level_db / 20));
+		size_t total = (size_t)st->hz * STATION_SECONDS / BLOCK * BLOCK, settled = (size_t)st->hz * SETTLED_SECONDS;
+		static double in_blocks[SETTLED_SECONDS * 1000 / LOUDNESS_BLOCK_MS], out_blocks[SETTLED_SECONDS * 1000 / LOUDNESS_BLOCK_MS];
+		int in_count = 0, out_count = 0;
+		double max_error = 0;
+
+		/* a new station: the stream starts over */
+		if (st->hz != loudness.hz) {
+			loudness_set_rate(&loudness, st->hz);
+			dsp_set_rate(&dsp, st->hz);
+		}
+		loudness_restart(&loudness);
+		reference_init(&in_ref, st->hz);
+		reference_init(&out_ref, st->hz);
+
+		for (size_t t = 0; t < total; t += BLOCK) {
+			for (int i = 0; i < BLOCK; i++)
+				in[i] = (int16_t)((st->pcm[(t + i) % st->len] * scale) >> 15);
+
+			uint32_t t0 = DSP_CYCLES();
+			if (loudness_update(&loudness, in, BLOCK, 0))
+				dsp_set_gain(&dsp, loudness.gain_db);
+			cycles += DSP_CYCLES() - t0;
+			samples += BLOCK;
+			memcpy(out, in, sizeof(in));
+			dsp_process(&dsp, out, BLOCK);
+
+			for (int i = 0; i < BLOCK; i++) {
+				int in_block = reference_sample(&in_ref, in[i]);
+				int out_block = reference_sample(&out_ref, out[i]);
+				int last = (in_ref.next + LOUDNESS_WINDOW_BLOCKS - 1) % LOUDNESS_WINDOW_BLOCKS;
+				/* the short-term loudness, both ways, when loudness.c is at the same block boundary, and past the
+				 * first window (the filters' state carried over from the last station would make a difference) */
+				if (in_block && in_ref.filled == LOUDNESS_WINDOW_BLOCKS && i == BLOCK - 1 &&
+				    loudness.block_samples == 0 && reference_gated(&in_ref) > LOUDNESS_ABSOLUTE_GATE) {
+					double error = fabs(reference_gated(&in_ref) - loudness.lufs);
+					max_error = error > max_error ? error : max_error;
+				}
+				if (t + i >= total - settled) {
+					if (in_block)
+						in_blocks[in_count++] = in_ref.blocks[last];
+					if (out_block)
+						out_blocks[out_count++] = out_ref.blocks[last];
+				}
+			}
+		}
+
+		char name[24];
+		snprintf(name, sizeof(name), "%s", st->name);
+		printf("%-24s %+6.0f %10.1f %10.1f %+10.1f %12.2f\n", name, st->level_db,
+		       integrated(in_blocks, in_count), integrated(out_blocks, out_count), loudness.gain_db, max_error);
+	}
+	printf("\n%.2f cycles per sample for the loudness measurement\n", (double)cycles / samples);
+	return 0;
+}
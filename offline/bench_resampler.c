@@ -0,0 +1,160 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define MINIMP3_ONLY_MP3
+#define MINIMP3_NONSTANDARD_BUT_LOGICAL
+#define MINIMP3_IMPLEMENTATION
+#include "../main/minimp3.h"
+#include "../main/resampler.c"
+#include "data.h"
+
+/* resampler benchmark: decodes data.h with mp3dec_decode_frame() (downmixed to mono, like the radio does), then runs
+ * it through main/resampler.c at each quality level for a few ratios, in granule sized blocks like the decoder does,
+ * and reports the cost per output sample. it also resamples a few sine waves and reports how far off the result is from
+ * the ideal one (in band), or how much is left of them (past the output's nyquist, where they'd alias).
+ * the cycles are the host's (rdtsc), so only compare them with each other.
+ *
+ * usage: gcc -O2 bench_resampler.c -lm -o bench_resampler && ./bench_resampler */
+
+#define RUNS 5
+#define SINE_SECONDS 1
+
+struct ratio {
+	uint32_t in_hz, out_hz;
+	float ppm;
+};
+
+static const struct ratio ratios[] = {
+	{44100, 48000, 0},
+	{48000, 48000, 100},
+	{32000, 48000, 0},
+	{24000, 48000, 0},
+	{22050, 48000, 0},
+	{48000, 44100, 0},
+};
+
+static const int qualities[] = {RESAMPLER_FAST, RESAMPLER_MEDIUM, RESAMPLER_BEST};
+
+static struct resampler resampler;
+static int16_t out[RESAMPLER_BLOCK];
+
+static uint64_t now_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+	return __rdtsc();
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ull + ts.tv_nsec;  /* not cycles, nanoseconds */
+#endif
+}
+
+/* feeds the input in granules, and reads the output in granules, as the decoder does. returns the output samples,
+ * storing them in dst if not NULL */
+static size_t run(const int16_t *src, size_t len, int16_t *dst, size_t dst_len) {
+	size_t produced = 0;
+
+	for (size_t i = 0; i < len; i += RESAMPLER_BLOCK) {
+		size_t n = len - i < RESAMPLER_BLOCK ? len - i : RESAMPLER_BLOCK;
+		if (resampler_write(&resampler, src + i, n) != n) {
+			fprintf(stderr, "resampler_write() dropped samples\n");
+			exit(1);
+		}
+		while (resampler_available(&resampler) >= RESAMPLER_BLOCK) {
+			resampler_read(&resampler, out, RESAMPLER_BLOCK);
+			if (dst != NULL && produced + RESAMPLER_BLOCK <= dst_len)
+				memcpy(dst + produced, out, sizeof(out));
+			produced += RESAMPLER_BLOCK;
+		}
+	}
+	return produced;
+}
+
+/* error against the ideal sine, in dB relative to the sine (in band), or what's left of it (past nyquist) */
+static double sine_test(int taps, const struct ratio *ratio, double freq) {
+	size_t in_len = ratio->in_hz * SINE_SECONDS, out_len = ratio->out_hz * SINE_SECONDS;
+	int16_t *in = malloc(in_len * sizeof(int16_t)), *res = calloc(out_len, sizeof(int16_t));
+	double amplitude = 16384, error = 0, signal = 0;
+
+	for (size_t i = 0; i < in_len; i++)
+		in[i] = (int16_t)lrint(amplitude * sin(2 * M_PI * freq * i / ratio->in_hz));
+	resampler_init(&resampler, taps, ratio->in_hz, ratio->out_hz);
+	size_t produced = run(in, in_len, res, out_len);
+
+	int alias = freq > ratio->out_hz / 2.0;
+	/* skip the start, where the filter isn't full yet */
+	for (size_t i = RESAMPLER_MAX_TAPS * 2; i < produced && i < out_len; i++) {
+		double ideal = alias ? 0 : amplitude * sin(2 * M_PI * freq * i / ratio->out_hz);
+		error += (res[i] - ideal) * (res[i] - ideal);
+		signal += amplitude * amplitude / 2;
+	}
+	free(in);
+	free(res);
+	return 10 * log10(error / signal + 1e-20);
+}
+
+int main(void) {
+	static mp3dec_t mp3d;
+	static mp3d_sample_t frame[MINIMP3_MAX_SAMPLES_PER_FRAME];
+	mp3dec_frame_info_t info;
+	int16_t *pcm = malloc(audio_data_len * 16 * sizeof(int16_t));
+	size_t pcm_len = 0, pos = 0;
+	int hz = 0;
+
+	mp3dec_init(&mp3d);
+	mp3dec_set_mono(&mp3d, MINIMP3_MONO_MIX);
+	while (pos < audio_data_len) {
+		int samples = mp3dec_decode_frame(&mp3d, audio_data + pos, (int)(audio_data_len - pos), frame, &info);
+		if (info.frame_bytes == 0)
+			break;
+		pos += info.frame_bytes;
+		memcpy(pcm + pcm_len, frame, samples * sizeof(int16_t));
+		pcm_len += samples;
+		hz = info.hz;
+	}
+	printf("%zu samples decoded at %d Hz, played back as if they were at each input rate\n\n", pcm_len, hz);
+
+	printf("tones at a fraction of the lower nyquist: error against the ideal resampled tone (dB), and what's left of a\n"
+	       "tone between the output's and the input's nyquist, when downsampling\n");
+	printf("%6s %16s %14s %10s %10s %10s %10s\n",
+	       "taps", "ratio", "cycles/sample", "0.1 nyq", "0.5 nyq", "0.8 nyq", "alias");
+	for (size_t q = 0; q < sizeof(qualities) / sizeof(qualities[0]); q++) {
+		for (size_t r = 0; r < sizeof(ratios) / sizeof(ratios[0]); r++) {
+			const struct ratio *ratio = &ratios[r];
+			uint64_t best = UINT64_MAX;
+			size_t produced = 0;
+
+			for (int i = 0; i < RUNS; i++) {
+				resampler_init(&resampler, qualities[q], ratio->in_hz, ratio->out_hz);
+				resampler_set_ppm(&resampler, ratio->ppm);
+				uint64_t t0 = now_cycles();
+				produced = run(pcm, pcm_len, NULL, 0);
+				uint64_t t1 = now_cycles();
+				if (t1 - t0 < best)
+					best = t1 - t0;
+			}
+
+			double nyquist = (ratio->in_hz < ratio->out_hz ? ratio->in_hz : ratio->out_hz) / 2.0;
+			double tones[3] = {0.1, 0.5, 0.8}, db[3];
+			for (int t = 0; t < 3; t++)
+				db[t] = sine_test(qualities[q], ratio, tones[t] * nyquist);
+			/* nothing can alias when upsampling */
+			char alias[16] = "-";
+			if (ratio->in_hz > ratio->out_hz)
+				snprintf(alias, sizeof(alias), "%.1f",
+				         sine_test(qualities[q], ratio, (ratio->out_hz / 2.0 + ratio->in_hz / 2.0) / 2));
+
+			char name[32];
+			snprintf(name, sizeof(name), "%u->%u%s", ratio->in_hz, ratio->out_hz, ratio->ppm != 0 ? "+ppm" : "");
+			printf("%6d %16s %14.1f %10.1f %10.1f %10.1f %10s\n", qualities[q], name, (double)best / produced,
+			       db[0], db[1], db[2], alias);
+		}
+	}
+	free(pcm);
+	return 0;
+}
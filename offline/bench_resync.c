@@ -0,0 +1,266 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define MINIMP3_ONLY_MP3
+#define MINIMP3_NONSTANDARD_BUT_LOGICAL
+#define MINIMP3_IMPLEMENTATION
+#ifdef MINIMP3_HEADER
+#include MINIMP3_HEADER
+#else
+#include "../main/minimp3.h"
+#endif
+#include "data.h"
+
+/* resync benchmark: corrupts data.h in a few different ways, then feeds it to minimp3 the same way decoder_task does
+ * (through a model of main/byte_ring.c, wrap and guard included, topped up with TCP-sized chunks) and reports how long
+ * it takes to get back in sync and how much audio gets lost on the way. the last kind of corruption puts something
+ * minimp3 can't make its mind up about right before the ring's wrap, where the decoder must get the ring to hand over
+ * more than a frame in one piece: "stuck" means it waited for data which could never make a difference instead.
+ *
+ * usage: gcc -O2 bench_resync.c -lm -o bench_resync && ./bench_resync
+ * to compare against another version of minimp3 (e.g. git show <commit>:main/minimp3.h > /tmp/minimp3.h), add
+ * -DMINIMP3_HEADER='"/tmp/minimp3.h"' */
+
+#define RING_SIZE (1024*24)  /* MP3_RING_SIZE */
+#define RING_GUARD (1024*16)  /* MP3_RING_GUARD */
+#define SYNCHRONIZATION_BYTES (RING_SIZE * 2 / 3)
+#define MIN_DECODE_BYTES (1441 + 4)
+#define MAX_SEEK_RETIES 10
+#define CHUNK_SIZE 1436  /* about what a TCP segment carries */
+#define EVENTS 12  /* corruptions per stream */
+#define GARBAGE_SIZE 1000
+#define DROP_SIZE 700
+#define FLIP_SPAN 64
+#define WRAP_DISTANCE 2000  /* from the free format header to the ring's wrap */
+
+enum corruption { GARBAGE, FAKE_HEADERS, DROP, FLIP, WRAP, CORRUPTIONS };
+static const char *corruption_names[] = {"garbage", "fake headers", "drop", "bit flips", "near the wrap"};
+
+struct event {
+	size_t start, end;  /* corrupted bytes, in the corrupted stream */
+	int resolved;
+};
+
+struct result {
+	long good_frames;
+	size_t resync_bytes_max, resync_bytes_total;
+	int unresolved, stuck;
+	double resync_us;  /* time spent in decode calls which didn't output anything */
+};
+
+static uint32_t rng = 12345;
+static uint32_t rnd(void) {
+	rng = rng * 1664525 + 1013904223;
+	return rng >> 8;
+}
+
+static double now_us(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/* builds a corrupted copy of the stream, with EVENTS corruptions spread over it (fewer near the wrap: one per lap of
+ * the ring), returns its length and the number of corruptions in *n_events */
+static size_t corrupt(uint8_t *out, enum corruption type, struct event *events, int *n_events) {
+	size_t in = 0, len = 0;
+	int e;
+	for (e = 0; e < EVENTS; e++) {
+		size_t at = (size_t)audio_data_len * (e + 1) / (EVENTS + 1) + rnd() % 1000;
+		if (type == WRAP) {
+			/* the stream's bytes go through the ring in order from its start: the garbage ends, and the header is,
+			 * WRAP_DISTANCE bytes before the end of lap e + 1, with plenty of the stream left after it */
+			at = (e + 1) * RING_SIZE - WRAP_DISTANCE - GARBAGE_SIZE - len + in;
+			if (at + RING_SIZE > audio_data_len)
+				break;
+		}
+		memcpy(out + len, audio_data + in, at - in);
+		len += at - in;
+		in = at;
+
+		events[e].start = len;
+		events[e].resolved = 0;
+		switch (type) {
+		case GARBAGE:
+			for (int i = 0; i < GARBAGE_SIZE; i++)
+				out[len++] = rnd();
+			break;
+		case FAKE_HEADERS:
+			/* garbage which looks a lot like mp3: plenty of valid headers of the right kind */
+			for (int i = 0; i < GARBAGE_SIZE; i++)
+				out[len++] = (i % 97 == 0) ? 0xff : (i % 97 == 1) ? 0xfb : (i % 97 == 2) ? 0x94 : rnd();
+			break;
+		case DROP:
+			in += DROP_SIZE;
+			break;
+		case FLIP:
+			memcpy(out + len, audio_data + in, FLIP_SPAN);
+			for (int i = 0; i < 8; i++)
+				out[len + rnd() % FLIP_SPAN] ^= 1 << (rnd() % 8);
+			len += FLIP_SPAN;
+			in += FLIP_SPAN;
+			break;
+		case WRAP:
+			/* garbage, then a free format header: minimp3 needs about twice the biggest free format frame after it
+			 * to rule it out */
+			for (int i = 0; i < GARBAGE_SIZE; i++)
+				out[len++] = rnd();
+			memcpy(out + len, "\xff\xfb\x04\x44", 4);
+			len += 4;
+			break;
+		default:
+			break;
+		}
+		events[e].end = len;
+	}
+	memcpy(out + len, audio_data + in, audio_data_len - in);
+	*n_events = e;
+	return len + audio_data_len - in;
+}
+
+/* main/byte_ring.c without the tasks: the same layout and the same peek. the positions count stream bytes */
+struct ring {
+	uint8_t storage[RING_GUARD + RING_SIZE];
+	size_t head, tail;
+	int mirrored;
+};
+
+static struct ring ring;
+static mp3d_sample_t pcm[MINIMP3_MAX_SAMPLES_PER_FRAME];
+
+static const uint8_t *ring_peek(struct ring *r, size_t want, size_t *len) {
+	uint8_t *buf = r->storage + RING_GUARD;
+	size_t fill = r->head - r->tail, offset = r->tail % RING_SIZE, before_wrap = RING_SIZE - offset;
+
+	*len = fill <= before_wrap ? fill : before_wrap;
+	if (fill <= before_wrap || (!r->mirrored && before_wrap >= want))
+		return buf + offset;
+	if (!r->mirrored) {
+		memcpy(buf - before_wrap, buf + offset, before_wrap);
+		r->mirrored = 1;
+	}
+	*len = fill;
+	return buf - before_wrap;
+}
+
+static void ring_consume(struct ring *r, size_t bytes) {
+	if (r->tail % RING_SIZE + bytes >= RING_SIZE)
+		r->mirrored = 0;
+	r->tail += bytes;
+}
+
+/* tops the ring up by a chunk, less right before the wrap, like the streaming task. 0 if there's no room or no more */
+static size_t ring_fill(struct ring *r, const uint8_t *stream, size_t stream_len, size_t *fed) {
+	size_t offset = r->head % RING_SIZE, n = stream_len - *fed;
+	n = n < CHUNK_SIZE ? n : CHUNK_SIZE;
+	n = n < RING_SIZE - (r->head - r->tail) ? n : RING_SIZE - (r->head - r->tail);
+	n = n < RING_SIZE - offset ? n : RING_SIZE - offset;
+	memcpy(r->storage + RING_GUARD + offset, stream + *fed, n);
+	r->head += n;
+	*fed += n;
+	return n;
+}
+
+static void run(const uint8_t *stream, size_t stream_len, struct event *events, int n_events, struct result *res) {
+	static mp3dec_t dec;
+	mp3dec_frame_info_t info;
+	size_t fed = 0;
+	int synchronized = 0, need_more = 0;
+
+	memset(res, 0, sizeof(*res));
+	memset(&ring, 0, sizeof(ring));
+	mp3dec_init(&dec);
+
+	while (1) {
+		/* wait for a frame, or enough to synchronize, or anything new, like decoder_task */
+		size_t wanted = synchronized ? MIN_DECODE_BYTES : SYNCHRONIZATION_BYTES;
+		while ((need_more || ring.head - ring.tail < wanted) && ring_fill(&ring, stream, stream_len, &fed))
+			need_more = 0;
+		if (need_more && fed < stream_len) {
+			res->stuck = 1;  /* the ring is full, and more data wouldn't help either */
+			break;
+		}
+		if (need_more || ring.head == ring.tail)
+			break;  /* end of stream */
+
+		int samples = 0, retries = MAX_SEEK_RETIES;
+		size_t want = synchronized ? MIN_DECODE_BYTES : SYNCHRONIZATION_BYTES;
+		while (samples == 0 && --retries) {
+			size_t len;
+			const uint8_t *data = ring_peek(&ring, want, &len);
+			info.frame_bytes = 0;
+			double t0 = now_us();
+			samples = mp3dec_decode_frame(&dec, data, (int)len, pcm, &info);
+			if (!samples)
+				res->resync_us += now_us() - t0;
+			ring_consume(&ring, info.frame_bytes);
+
+			if (!samples && !info.frame_bytes) {
+				if (len < ring.head - ring.tail && want < SYNCHRONIZATION_BYTES) {
+					want = SYNCHRONIZATION_BYTES;  /* the span stopped at the wrap */
+					retries++;
+					continue;
+				}
+				need_more = 1;
+				break;
+			}
+		}
+
+		if (need_more)
+			continue;
+		if (!retries) {
+			synchronized = 0;  /* "Sync fail!", the ring is kept */
+			continue;
+		}
+
+		synchronized = 1;
+		res->good_frames++;
+		for (int e = 0; e < n_events; e++) {
+			if (!events[e].resolved && ring.tail >= events[e].end) {
+				size_t bytes = ring.tail - events[e].end;
+				events[e].resolved = 1;
+				res->resync_bytes_total += bytes;
+				if (bytes > res->resync_bytes_max)
+					res->resync_bytes_max = bytes;
+			}
+		}
+	}
+
+	for (int e = 0; e < n_events; e++)
+		res->unresolved += !events[e].resolved;
+}
+
+int main(void) {
+	static uint8_t stream[sizeof(audio_data) + EVENTS * GARBAGE_SIZE];
+	struct event events[EVENTS];
+	struct result clean, res;
+
+	run(audio_data, audio_data_len, NULL, 0, &clean);
+	mp3dec_frame_info_t info;
+	mp3dec_t dec;
+	mp3dec_init(&dec);
+	mp3dec_decode_frame(&dec, audio_data, audio_data_len, pcm, &info);
+	double frame_ms = 1152 * 1000.0 / info.hz;
+	double byte_ms = 8.0 / info.bitrate_kbps;
+
+	printf("clean stream: %ld frames, %d kbps, %d Hz\n", clean.good_frames, info.bitrate_kbps, info.hz);
+	printf("%d corruptions per stream (fewer near the wrap); resync is measured in stream time, from the end of the\n"
+	       "corruption to the end of the first frame decoded after it\n", EVENTS);
+	printf("%-13s %18s %16s %16s %12s %10s %6s\n",
+	       "corruption", "lost frames", "avg resync (ms)", "max resync (ms)", "resync (us)", "unsynced", "stuck");
+	for (int c = 0; c < CORRUPTIONS; c++) {
+		rng = 12345 + c;
+		int n_events;
+		size_t len = corrupt(stream, c, events, &n_events);
+		run(stream, len, events, n_events, &res);
+		/* dropping bytes takes whole frames with it, those are lost no matter what */
+		long lost = clean.good_frames - res.good_frames;
+		printf("%-13s %7ld (%6.0fms) %16.1f %16.1f %12.0f %10d %6s\n",
+		       corruption_names[c], lost, lost * frame_ms,
+		       (double)res.resync_bytes_total / n_events * byte_ms, res.resync_bytes_max * byte_ms,
+		       res.resync_us, res.unresolved, res.stuck ? "yes" : "no");
+	}
+	return 0;
+}
@@ -0,0 +1,114 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+/* writes a short MPEG-2 (or MPEG-2.5) layer III stream whose frames are all intensity stereo, to run through main.c
+ * alongside data.h: the test stream is MPEG-1, and MPEG-1 intensity stereo goes through a different table than the
+ * LSF one, so this is the only way the PSNR run gets to check the latter.
+ * the left channel is a pseudo random spectrum of +-1 lines coded with count1 table B, the right channel carries no
+ * lines at all, only intensity positions (odd and even ones, with both intensity scales), so the right channel is
+ * entirely made up by the intensity stereo processing.
+ *
+ * usage: gcc -O2 gen_lsf_is.c -o gen_lsf_is && ./gen_lsf_is lsf.mp3 && ./gen_lsf_is lsf25.mp3 2.5
+ * then e.g. ./float float_lsf.pcm lsf.mp3 && ./fixed fixed_lsf.pcm lsf.mp3 && ./psnr float_lsf.pcm fixed_lsf.pcm */
+
+#define FRAMES 200
+#define FRAME_BYTES 192  /* 64 kbps at 24 kHz, or 32 kbps at 12 kHz: no padding needed */
+#define SIDE_INFO_BYTES 17  /* MPEG-2, stereo */
+#define QUADS 96  /* count1 quadruples in the left channel, 384 lines out of 576 */
+#define IS_BANDS 21  /* long block scalefactor bands carrying an intensity position */
+#define IS_SLEN 3  /* bits per intensity position: 0..6, 7 means "not intensity stereo" */
+
+struct bits {
+	uint8_t *buf;
+	size_t pos;
+};
+
+static void put(struct bits *b, uint32_t value, int n) {
+	while (n--) {
+		if ((value >> n) & 1)
+			b->buf[b->pos / 8] |= 0x80 >> (b->pos % 8);
+		b->pos++;
+	}
+}
+
+static uint32_t rng = 4321;
+static uint32_t rnd(void) {
+	rng = rng * 1664525 + 1013904223;
+	return rng >> 8;
+}
+
+static void side_info_channel(struct bits *b, int part2_3_length, int global_gain, int scalefac_compress) {
+	put(b, part2_3_length, 12);
+	put(b, 0, 9);  /* big_values: everything is in the count1 region */
+	put(b, global_gain, 8);
+	put(b, scalefac_compress, 9);
+	put(b, 0, 1);  /* window_switching_flag: long blocks */
+	put(b, 0, 15);  /* table_select */
+	put(b, 0, 4);  /* region0_count */
+	put(b, 0, 3);  /* region1_count */
+	put(b, 0, 1);  /* scalefac_scale */
+	put(b, 1, 1);  /* count1table_select: table B, 4 bits per quadruple */
+}
+
+int main(int argc, char **argv) {
+	if (argc < 2) {
+		fprintf(stderr, "usage: %s output.mp3 [2.5]\n", argv[0]);
+		return 2;
+	}
+	int mpeg25 = argc > 2 && strcmp(argv[2], "2.5") == 0;
+
+	FILE *f = fopen(argv[1], "wb");
+	if (f == NULL) {
+		fprintf(stderr, "can't open %s\n", argv[1]);
+		return 2;
+	}
+
+	for (int frame = 0; frame < FRAMES; frame++) {
+		uint8_t buf[FRAME_BYTES] = {0};
+		struct bits b = {buf, 0};
+
+		/* header: layer III, no CRC, 64 kbps at 24 kHz (or 32 kbps at 12 kHz), joint stereo with intensity stereo only */
+		put(&b, 0x7ff, 11);
+		put(&b, mpeg25 ? 0 : 2, 2);
+		put(&b, 1, 2);
+		put(&b, 1, 1);
+		put(&b, mpeg25 ? 4 : 8, 4);
+		put(&b, 1, 2);
+		put(&b, 0, 2);
+		put(&b, 1, 2);
+		put(&b, 1, 2);
+		put(&b, 0, 4);
+
+		/* the main data, left then right, goes right after the side info, which is filled in once its size is known */
+		uint8_t main_data[FRAME_BYTES - 4 - SIDE_INFO_BYTES] = {0};
+		struct bits m = {main_data, 0};
+		for (int q = 0; q < QUADS; q++) {
+			int mask = 0;
+			for (int i = 0; i < 4; i++)
+				mask = mask << 1 | (rnd() % 5 < 2);
+			put(&m, 15 - mask, 4);
+			for (int i = 0; i < 4; i++) {
+				if ((mask >> (3 - i)) & 1)
+					put(&m, rnd() & 1, 1);
+			}
+		}
+		int left_bits = (int)m.pos;
+		for (int i = 0; i < IS_BANDS; i++)
+			put(&m, rnd() % 7, IS_SLEN);
+		int right_bits = (int)m.pos - left_bits;
+
+		put(&b, 0, 8);  /* main_data_begin */
+		put(&b, 0, 2);  /* private bits */
+		side_info_channel(&b, left_bits, 170 + frame % 20, 0);
+		/* with intensity stereo, the right channel's scalefac_compress is slen0 * 36 + slen1 * 6 + slen2, then the
+		 * intensity scale in the lowest bit */
+		side_info_channel(&b, right_bits, 170, (IS_SLEN * 36 + IS_SLEN * 6 + IS_SLEN) << 1 | (frame & 1));
+
+		memcpy(buf + b.pos / 8, main_data, sizeof(main_data));
+		fwrite(buf, 1, sizeof(buf), f);
+	}
+
+	fclose(f);
+	return 0;
+}
@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include <stdbool.h>
 
@@ -13,10 +14,32 @@
 mp3d_sample_t buf[AUDIO_BUF_SIZE];
 size_t useful_size = 0;  /* used by the source to signal available bytes, used by the sink to signal used bytes */
 
-int main() {
+/* usage: ./main [output.pcm [input.mp3]], data.h if no input is given
+ * build with -DMINIMP3_FIXED_POINT to use the integer backend, then compare it against a float build using psnr.c */
+int main(int argc, char **argv) {
+  const unsigned char *input = audio_data;
+  size_t input_len = audio_data_len;
+  if (argc > 2) {
+    FILE *in = fopen(argv[2], "rb");
+    if (in == NULL) {
+      fprintf(stderr, "can't open %s\n", argv[2]);
+      return 2;
+    }
+    fseek(in, 0, SEEK_END);
+    input_len = (size_t)ftell(in);
+    fseek(in, 0, SEEK_SET);
+    unsigned char *data = malloc(input_len);
+    if (data == NULL || fread(data, 1, input_len, in) != input_len) {
+      fprintf(stderr, "can't read %s\n", argv[2]);
+      return 2;
+    }
+    fclose(in);
+    input = data;
+  }
+
   printf("First 16 bytes:\n%02x %02x %02x %02x %02x %02x %02x %02x\n%02x %02x %02x %02x %02x %02x %02x %02x\n",
-         audio_data[0],  audio_data[1],  audio_data[2],  audio_data[3],  audio_data[4],  audio_data[5],  audio_data[6],  audio_data[7],
-         audio_data[8],  audio_data[9],  audio_data[10], audio_data[11], audio_data[12], audio_data[13], audio_data[14], audio_data[15]);
+         input[0],  input[1],  input[2],  input[3],  input[4],  input[5],  input[6],  input[7],
+         input[8],  input[9],  input[10], input[11], input[12], input[13], input[14], input[15]);
 
 	mp3dec_frame_info_t info;
 	size_t cur_pos = 0;
@@ -25,9 +48,12 @@ int main() {
   /* init MP3 decoder */
 	mp3dec_t mp3d;
 	mp3dec_init(&mp3d);
+#ifdef MONO_POLICY
+	mp3dec_set_mono(&mp3d, MONO_POLICY);  /* e.g. -DMONO_POLICY=MINIMP3_MONO_MIX */
+#endif
 
   /* save output file */
-  FILE *f = fopen("out.wav", "w");
+  FILE *f = fopen(argc > 1 ? argv[1] : "out.wav", "w");
 
 	while (1) {
     printf(" * begin cycle\n");
@@ -35,17 +61,19 @@ int main() {
 		samples = 0;
 		retries = 5;
 
-		while (samples == 0 && cur_pos < audio_data_len && --retries) {
+		while (samples == 0 && cur_pos < input_len && --retries) {
       info.frame_bytes = 0;
-			samples = mp3dec_decode_frame(&mp3d, audio_data + cur_pos, audio_data_len - cur_pos, buf, &info);
+			samples = mp3dec_decode_frame(&mp3d, input + cur_pos, input_len - cur_pos, buf, &info);
       cur_pos += info.frame_bytes;
       printf(" ** Samples: %lu\n", samples);
       if (info.frame_bytes > 0)
         printf(" ** Advancing by %d bytes\n", info.frame_bytes);
+      else if (samples == 0)
+        cur_pos = input_len;  /* minimp3 wants more data, and there is none: whatever is left isn't a frame */
 		}
 
 		printf(" ** Tries: %lu, Used bytes: %d\n", 5 - retries, info.frame_bytes);
-    printf(" ** Pos: %09lu / %d\n", cur_pos, audio_data_len);
+    printf(" ** Pos: %09lu / %lu\n", cur_pos, input_len);
 
 		if (!retries) {
 			printf(" ** Failed, resetting source task\n");
@@ -53,8 +81,12 @@ int main() {
 		} else {  
       printf(" ** Decoded audio info: channels=%d, bitrate=%d kbps, hz=%d, layer=%d\n", info.channels, info.bitrate_kbps, info.hz, info.layer);
       if (f != NULL)
+#ifdef MONO_POLICY
+        fwrite(buf, 1, samples * sizeof(int16_t), f);
+#else
         fwrite(buf, 1, samples * sizeof(int16_t) * 2, f);
-			if (cur_pos >= audio_data_len) {
+#endif
+			if (cur_pos >= input_len) {
 				cur_pos = 0;
         if (f != NULL) {
           fclose(f);
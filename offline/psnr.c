@@ -0,0 +1,47 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+
+/* compares two raw 16-bit pcm files (e.g. out.wav from a float and a MINIMP3_FIXED_POINT build of main.c) */
+int main(int argc, char **argv) {
+	if (argc != 3) {
+		fprintf(stderr, "usage: %s reference.pcm test.pcm\n", argv[0]);
+		return 2;
+	}
+
+	FILE *ref = fopen(argv[1], "rb");
+	FILE *test = fopen(argv[2], "rb");
+	if (ref == NULL || test == NULL) {
+		fprintf(stderr, "can't open input files\n");
+		return 2;
+	}
+
+	int16_t a, b;
+	double signal = 0, noise = 0;
+	long n = 0;
+	int max_diff = 0;
+	while (fread(&a, sizeof(a), 1, ref) == 1 && fread(&b, sizeof(b), 1, test) == 1) {
+		int diff = a - b;
+		signal += (double)a * a;
+		noise += (double)diff * diff;
+		if (diff < 0)
+			diff = -diff;
+		if (diff > max_diff)
+			max_diff = diff;
+		n++;
+	}
+
+	if (n == 0) {
+		fprintf(stderr, "no samples\n");
+		return 2;
+	}
+
+	printf("samples: %ld, max abs diff: %d\n", n, max_diff);
+	if (noise == 0) {
+		printf("identical\n");
+	} else {
+		printf("PSNR: %.2f dB\n", 10 * log10(32767.0 * 32767.0 * n / noise));
+		printf("SNR: %.2f dB\n", 10 * log10(signal / noise));
+	}
+	return 0;
+}
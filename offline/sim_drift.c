@@ -0,0 +1,138 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../main/drift.c"
+
+/* clock drift simulation: a 128 kbps stream, encoded on a clock which is off by some ppm, comes in over a bursty
+ * network into our mp3 buffers (ring buffer + decoder window), and is played on our clock, trimmed by the drift
+ * controller in steps as fine as the APLL can do. reports how far the buffer level wanders off over a few hours, with
+ * and without the controller (the dips below the setpoint are the network stalls), and what the correction settles to.
+ *
+ * usage: gcc -O2 sim_drift.c -lm -o sim_drift && ./sim_drift */
+
+#define HOURS 12
+#define STEP_S 0.01
+#define BITRATE_BPS (128000 / 8)
+#define CAPACITY (8 * 1024 + 24 * 1024)  /* MP3_RINGBUF_SIZE + MP3_DECODER_BUF_SIZE */
+#define FRAME_BYTES 417  /* 128 kbps @ 44.1/48 kHz, near enough */
+#define SEGMENT 1436  /* the network delivers data in TCP segment sized pieces... */
+#define JITTER_S 0.05  /* ...which are up to this late... */
+#define STALL_EVERY_S 600  /* ...and every now and then it stops for a while, then catches up */
+#define STALL_S 0.5
+#define INITIAL_BURST 16384  /* what the server sends right away when connecting */
+#define START_BYTES 4096  /* fast start: playback starts with this much buffered, and after an underrun */
+#define APLL_STEP_PPM 1.5  /* resolution of the APLL fractional divider at our frequency */
+#define MAX_PPM 300
+
+struct result {
+	double setpoint_ms, min_ms, max_ms, mean_ppm, min_ppm, max_ppm;
+	long underruns, overflows;
+};
+
+static uint32_t rng;
+static double rnd(void) {
+	rng = rng * 1664525 + 1013904223;
+	return (rng >> 8) / (double)(1 << 24);
+}
+
+static void run(double drift_ppm, int compensate, struct result *res) {
+	struct drift_ctl ctl;
+	double produced = INITIAL_BURST;  /* bytes the server has sent so far */
+	double delivered = 0;  /* bytes which made it to us */
+	double level = 0;  /* bytes in our buffers */
+	double next_segment_at = 0, since_update = 0;
+	double ppm = 0;
+	int playing = 0;
+
+	rng = 1234;
+	drift_init(&ctl, MAX_PPM);
+	res->min_ms = 1e9;
+	res->max_ms = 0;
+	res->underruns = 0;
+	res->overflows = 0;
+	res->setpoint_ms = -1;
+	res->mean_ppm = 0;
+	res->min_ppm = 1e9;
+	res->max_ppm = -1e9;
+	long samples = 0;
+
+	for (double t = 0; t < HOURS * 3600.0; t += STEP_S) {
+		/* the server encodes in real time on its own clock */
+		produced += BITRATE_BPS * (1 + drift_ppm * 1e-6) * STEP_S;
+
+		/* network: segments arrive late and in bunches, or not at all during a stall */
+		int stalled = fmod(t, STALL_EVERY_S) > STALL_EVERY_S - STALL_S;
+		while (!stalled && t >= next_segment_at && produced - delivered >= SEGMENT) {
+			if (level + SEGMENT > CAPACITY) {
+				res->overflows++;  /* the source blocks */
+				break;
+			}
+			delivered += SEGMENT;
+			level += SEGMENT;
+			next_segment_at = t + rnd() * JITTER_S;
+		}
+
+		/* we play at our own clock, trimmed by the controller */
+		double want = BITRATE_BPS * (1 + ppm * 1e-6) * STEP_S;
+		if (!playing) {
+			if (level < START_BYTES)
+				continue;
+			playing = 1;
+			drift_restart(&ctl);
+		}
+		if (level < want) {
+			res->underruns++;
+			playing = 0;
+			continue;
+		}
+		level -= want;
+
+		/* the decoder feeds the controller once a second, seeing the level right after a whole frame */
+		since_update += STEP_S;
+		if (since_update >= 1.0) {
+			double seen = level - fmod(level, FRAME_BYTES);
+			double level_ms = seen * 1000.0 / BITRATE_BPS;
+			if (compensate) {
+				float p = drift_update(&ctl, (float)level_ms, (float)since_update);
+				ppm = round(p / APLL_STEP_PPM) * APLL_STEP_PPM;
+			}
+			since_update = 0;
+
+			if (t > 3600) {
+				/* after the first hour: how far off it wanders */
+				if (level_ms < res->min_ms)
+					res->min_ms = level_ms;
+				if (level_ms > res->max_ms)
+					res->max_ms = level_ms;
+				if (ppm < res->min_ppm)
+					res->min_ppm = ppm;
+				if (ppm > res->max_ppm)
+					res->max_ppm = ppm;
+				res->mean_ppm += ppm;
+				samples++;
+			}
+		}
+	}
+	res->setpoint_ms = ctl.setpoint;
+	res->mean_ppm /= samples;
+}
+
+int main(void) {
+	static const double drifts[] = {-100, -30, 0, 30, 100};
+	struct result res;
+
+	printf("%d hours at 128 kbps, %d KB of buffers; level and correction ranges are after the first hour\n",
+	       HOURS, CAPACITY / 1024);
+	printf("%10s %12s %14s %16s %22s %10s %10s\n",
+	       "drift", "controller", "setpoint (ms)", "level (ms)", "ppm (mean, range)", "underruns", "blocked");
+	for (size_t i = 0; i < sizeof(drifts) / sizeof(drifts[0]); i++) {
+		for (int compensate = 0; compensate < 2; compensate++) {
+			run(drifts[i], compensate, &res);
+			printf("%+10.0f %12s %14.0f %7.0f - %6.0f %+8.1f (%+5.0f - %+4.0f) %10ld %10ld\n",
+			       drifts[i], compensate ? "on" : "off", compensate ? res.setpoint_ms : 0,
+			       res.min_ms, res.max_ms, res.mean_ppm, res.min_ppm, res.max_ppm, res.underruns, res.overflows);
+		}
+	}
+	return 0;
+}
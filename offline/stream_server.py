@@ -0,0 +1,111 @@
+#!/usr/bin/env python3
+
+"""Stand-in for a web radio server, to try out reconnections and the hot standby mirror on the bench.
+
+Serves an mp3 file over plain HTTP, looped, at its bitrate, after a burst on connect like Icecast does. Like a live
+station, every connection joins the programme where it's at by the clock, so two of them on the same computer are
+mirrors in step (--delay puts one behind). Clients which ask for ICY metadata get a new title every other metadata
+block. It can be told to stall or drop every connection after a while: run two of them, point STREAMING_RADIO_URL and
+the mirror URL in menuconfig at them (http://<your computer>:<port>/), and stall the first one:
+
+    ./stream_server.py captured.mp3 --port 8001 --stall-after 20 --stall-for 10
+    ./stream_server.py captured.mp3 --port 8002 --delay 0.5
+"""
+
+import argparse
+import http.server
+import socketserver
+import time
+
+
+def serve(args, data):
+    class Handler(http.server.BaseHTTPRequestHandler):
+        protocol_version = 'HTTP/1.0'
+
+        def do_GET(self):
+            metaint = args.metaint if self.headers.get('Icy-MetaData') == '1' else 0
+            self.send_response(200)
+            self.send_header('Content-Type', 'audio/mpeg')
+            self.send_header('Cache-Control', 'no-cache')
+            if metaint:
+                self.send_header('icy-metaint', str(metaint))
+            self.end_headers()
+
+            audio_left = metaint
+            titles_sent = 0
+
+            def write(buf):
+                nonlocal audio_left, titles_sent
+                while metaint and len(buf) >= audio_left:
+                    # a new title every other block, nothing in between
+                    meta = b''
+                    if titles_sent % 2 == 0:
+                        meta = f"StreamTitle='{args.title} #{titles_sent // 2}';".encode()
+                        meta += b'\0' * (-len(meta) % 16)
+                    titles_sent += 1
+                    self.wfile.write(buf[:audio_left] + bytes([len(meta) // 16]) + meta)
+                    buf = buf[audio_left:]
+                    audio_left = metaint
+                self.wfile.write(buf)
+                audio_left -= len(buf)
+
+            rate = args.kbps * 1000 / 8
+            start = time.monotonic()
+            sent = 0
+            # where the programme is at, the burst before it
+            pos = int((time.time() - args.delay) * rate - args.burst * 1024) % len(data)
+            stalled = False
+            try:
+                while True:
+                    elapsed = time.monotonic() - start
+                    if args.drop_after and elapsed >= args.drop_after:
+                        self.log_message('dropping the connection')
+                        return
+                    if args.stall_after and args.stall_after <= elapsed < args.stall_after + args.stall_for:
+                        if not stalled:
+                            self.log_message('stalling for %.1f s', args.stall_for)
+                            stalled = True
+                        time.sleep(0.05)
+                        continue
+
+                    # what should have gone out by now, counting the stall as time off
+                    if stalled:
+                        elapsed -= args.stall_for
+                    due = args.burst * 1024 + elapsed * rate - sent
+                    if due < args.chunk:
+                        time.sleep(args.chunk / rate / 4)
+                        continue
+
+                    n = min(int(due), len(data) - pos)
+                    write(data[pos:pos + n])
+                    sent += n
+                    pos = (pos + n) % len(data)
+            except (BrokenPipeError, ConnectionResetError):
+                self.log_message('client went away after %d bytes', sent)
+
+    class Server(socketserver.ThreadingMixIn, http.server.HTTPServer):
+        daemon_threads = True
+        allow_reuse_address = True
+
+    with Server(('', args.port), Handler) as server:
+        print(f'Serving {args.file} at {args.kbps} kbps on port {args.port}')
+        server.serve_forever()
+
+
+if __name__ == '__main__':
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('file', help='mp3 file to serve, looped')
+    parser.add_argument('--port', type=int, default=8000)
+    parser.add_argument('--kbps', type=int, default=128, help="the file's bitrate, to pace it (default: 128)")
+    parser.add_argument('--burst', type=int, default=64, help='KB sent right away on connect (default: 64)')
+    parser.add_argument('--delay', type=float, default=0, help='seconds behind the programme, as a mirror (default: 0)')
+    parser.add_argument('--chunk', type=int, default=1024, help='bytes written at a time (default: 1024)')
+    parser.add_argument('--stall-after', type=float, default=0, help='seconds into each connection to stall at')
+    parser.add_argument('--stall-for', type=float, default=10, help='how long to stall for (default: 10)')
+    parser.add_argument('--drop-after', type=float, default=0, help='seconds into each connection to drop it at')
+    parser.add_argument('--metaint', type=int, default=16000, help='ICY metadata interval, 0 for none (default: 16000)')
+    parser.add_argument('--title', default='Test stream', help='ICY title, numbered as it changes')
+    args = parser.parse_args()
+
+    with open(args.file, 'rb') as f:
+        serve(args, f.read())